@@ -13,8 +13,40 @@ public class SourceSelector : MonoBehaviour
     SpoutReceiver _receiver;
 
     List<string> _sourceNames = new List<string>();
+    List<string> _lastSourceNames = new List<string>();
+    List<string> _options = new List<string>();
+    string _lastSelection;
+    int _lastGeneration = -1;
+    float _lastScanTime;
     bool _disableCallback;
 
+    // Interval of the re-enumeration for the Spout applications that don't
+    // update the generation number of the source list
+    const float ScanInterval = 1;
+
+    bool CheckGenerationChanged()
+    {
+        var generation = SpoutManager.sourceListGeneration;
+        var time = Time.unscaledTime;
+
+        // Enumerate every frame when the generation number isn't available.
+        if (generation >= 0 && generation == _lastGeneration &&
+            time - _lastScanTime < ScanInterval) return false;
+
+        _lastGeneration = generation;
+        _lastScanTime = time;
+        return true;
+    }
+
+    bool CheckSourceListChanged()
+    {
+        if (_receiver.sourceName != _lastSelection) return true;
+        if (_sourceNames.Count != _lastSourceNames.Count) return true;
+        for (var i = 0; i < _sourceNames.Count; i++)
+            if (_sourceNames[i] != _lastSourceNames[i]) return true;
+        return false;
+    }
+
     void Start()
     {
         _receiver = GetComponent<SpoutReceiver>();
@@ -26,16 +58,26 @@ void Update()
         // objects while the menu is opened. Stop updating it while visible.
         if (_dropdown.transform.childCount > 3) return;
 
-        // Retrieve the Spout source names.
-        SpoutManager.GetSourceNames(_sourceNames);
+        // Retrieve the Spout source names only when the list has been
+        // changed (the names come sorted).
+        if (CheckGenerationChanged()) SpoutManager.GetSourceNames(_sourceNames);
+
+        // Nothing to do when nothing has been changed.
+        if (!CheckSourceListChanged()) return;
+
+        _lastSourceNames.Clear();
+        _lastSourceNames.AddRange(_sourceNames);
+        _lastSelection = _receiver.sourceName;
 
         // Update the current selection.
-        var index = _sourceNames.IndexOf(_receiver.sourceName);
+        _options.Clear();
+        _options.AddRange(_sourceNames);
+        var index = _options.IndexOf(_receiver.sourceName);
         if (index < 0)
         {
-            // Append the current name to the list when it's not found.
-            index = _sourceNames.Count;
-            _sourceNames.Add(_receiver.sourceName);
+            // Append the current name to the options when it's not found.
+            index = _options.Count;
+            _options.Add(_receiver.sourceName);
         }
 
         // We don't like to receive callback while editing options.
@@ -43,7 +85,7 @@ void Update()
 
         // Update the menu options.
         _dropdown.ClearOptions();
-        _dropdown.AddOptions(_sourceNames);
+        _dropdown.AddOptions(_options);
         _dropdown.value = index;
         _dropdown.RefreshShownValue();
 
@@ -54,6 +96,6 @@ void Update()
     public void OnChangeValue(int value)
     {
         if (_disableCallback) return;
-        _receiver.sourceName = _sourceNames[value];
+        _receiver.sourceName = _options[value];
     }
 }
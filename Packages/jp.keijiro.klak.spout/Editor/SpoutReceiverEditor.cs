@@ -11,9 +11,11 @@ namespace Klak.Spout
     sealed class SpoutReceiverEditor : Editor
     {
         SerializedProperty _sourceName;
+        SerializedProperty _sourceRegion;
         SerializedProperty _targetTexture;
         SerializedProperty _targetRenderer;
         SerializedProperty _targetMaterialProperty;
+        SerializedProperty _directMode;
 
         static double _prevRepaintTime;
 
@@ -63,9 +65,11 @@ void OnSelectSource(object name)
         void OnEnable()
         {
             _sourceName = serializedObject.FindProperty("_sourceName");
+            _sourceRegion = serializedObject.FindProperty("_sourceRegion");
             _targetTexture = serializedObject.FindProperty("_targetTexture");
             _targetRenderer = serializedObject.FindProperty("_targetRenderer");
             _targetMaterialProperty = serializedObject.FindProperty("_targetMaterialProperty");
+            _directMode = serializedObject.FindProperty("_directMode");
 
             EditorApplication.update += CheckRepaint;
         }
@@ -93,6 +97,9 @@ public override void OnInspectorGUI()
 
             EditorGUILayout.EndHorizontal();
 
+            // Atlas region name
+            EditorGUILayout.PropertyField(_sourceRegion);
+
             // Target texture/renderer
             EditorGUILayout.PropertyField(_targetTexture);
             EditorGUILayout.PropertyField(_targetRenderer);
@@ -110,6 +117,8 @@ public override void OnInspectorGUI()
                 MaterialPropertySelector.DropdownList(_targetRenderer, _targetMaterialProperty);
             }
 
+            EditorGUILayout.PropertyField(_directMode);
+
             EditorGUI.indentLevel--;
 
             serializedObject.ApplyModifiedProperties();
@@ -11,12 +11,26 @@ namespace Klak.Spout
     sealed class SpoutSenderEditor : Editor
     {
         SerializedProperty _sourceTexture;
+        SerializedProperty _format;
         SerializedProperty _alphaSupport;
+        SerializedProperty _keyedMutex;
+        SerializedProperty _bufferCount;
+        SerializedProperty _mirrorInterval;
+        SerializedProperty _updateMode;
+        SerializedProperty _maxRate;
+        SerializedProperty _frameTimestamps;
 
         void OnEnable()
         {
             _sourceTexture = serializedObject.FindProperty("_sourceTexture");
+            _format = serializedObject.FindProperty("_format");
             _alphaSupport = serializedObject.FindProperty("_alphaSupport");
+            _keyedMutex = serializedObject.FindProperty("_keyedMutex");
+            _bufferCount = serializedObject.FindProperty("_bufferCount");
+            _mirrorInterval = serializedObject.FindProperty("_mirrorInterval");
+            _updateMode = serializedObject.FindProperty("_updateMode");
+            _maxRate = serializedObject.FindProperty("_maxRate");
+            _frameTimestamps = serializedObject.FindProperty("_frameTimestamps");
         }
 
         public override void OnInspectorGUI()
@@ -50,9 +64,39 @@ public override void OnInspectorGUI()
             else
                 EditorGUILayout.PropertyField(_sourceTexture);
 
+            // Format, keyed mutex and buffer options (reconnection is needed
+            // to apply changes)
+            EditorGUI.BeginChangeCheck();
+            EditorGUILayout.PropertyField(_format);
             EditorGUILayout.PropertyField(_alphaSupport);
+            EditorGUILayout.PropertyField(_keyedMutex);
+            EditorGUILayout.PropertyField(_bufferCount);
+            var reconnect = EditorGUI.EndChangeCheck();
+
+            // Mirror interval (only used with multiple buffers)
+            if (_bufferCount.hasMultipleDifferentValues || _bufferCount.intValue > 1)
+            {
+                EditorGUI.indentLevel++;
+                EditorGUILayout.PropertyField(_mirrorInterval);
+                EditorGUI.indentLevel--;
+            }
+
+            // Update policy
+            EditorGUILayout.PropertyField(_updateMode);
+            if (_updateMode.hasMultipleDifferentValues ||
+                _updateMode.enumValueIndex == (int)SpoutUpdateMode.MaxRate)
+            {
+                EditorGUI.indentLevel++;
+                EditorGUILayout.PropertyField(_maxRate);
+                EditorGUI.indentLevel--;
+            }
+
+            EditorGUILayout.PropertyField(_frameTimestamps);
 
             serializedObject.ApplyModifiedProperties();
+
+            if (reconnect)
+                foreach (SpoutSender sender in targets) sender.RequestReconnect();
         }
     }
 }
@@ -14,6 +14,8 @@ Shader "Hidden/Spout/Blit"
 
     sampler2D _MainTex;
     fixed _ClearAlpha;
+    half _LinearSource;
+    float4 _SourceRect; // UV offset and scale (the top-left origin)
 
     v2f_img vert_yflip(appdata_img v)
     {
@@ -23,6 +25,16 @@ Shader "Hidden/Spout/Blit"
         return o;
     }
 
+    // The source rectangle is applied after flipping, as it's given with
+    // the top-left origin.
+    v2f_img vert_receiver(appdata_img v)
+    {
+        v2f_img o;
+        o.pos = UnityObjectToClipPos(v.vertex);
+        o.uv = _SourceRect.xy + float2(v.texcoord.x, 1 - v.texcoord.y) * _SourceRect.zw;
+        return o;
+    }
+
     fixed4 frag_sender(v2f_img i) : SV_Target
     {
         fixed4 col = tex2D(_MainTex, i.uv);
@@ -30,11 +42,13 @@ Shader "Hidden/Spout/Blit"
         return col;
     }
 
-    fixed4 frag_receiver(v2f_img i) : SV_Target
+    half4 frag_receiver(v2f_img i) : SV_Target
     {
-        fixed4 col = tex2D(_MainTex, i.uv);
+        half4 col = tex2D(_MainTex, i.uv);
         #if !defined(UNITY_COLORSPACE_GAMMA)
-        col.rgb = GammaToLinearSpace(col.rgb);
+        if (_LinearSource < 0.5) col.rgb = GammaToLinearSpace(col.rgb);
+        #else
+        if (_LinearSource > 0.5) col.rgb = LinearToGammaSpace(col.rgb);
         #endif
         return col;
     }
@@ -54,7 +68,7 @@ Shader "Hidden/Spout/Blit"
         Pass
         {
             CGPROGRAM
-            #pragma vertex vert_yflip
+            #pragma vertex vert_receiver
             #pragma fragment frag_receiver
             #pragma multi_compile _ UNITY_COLORSPACE_GAMMA
             ENDCG
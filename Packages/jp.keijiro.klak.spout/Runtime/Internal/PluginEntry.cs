@@ -8,14 +8,16 @@ namespace Klak.Spout
 {
     static class PluginEntry
     {
-        internal enum Event { Update, Dispose }
+        internal enum Event { Update, Dispose, Present, Lock, Unlock, Send, Flush, Readback, Receive, SendAtlas, Snapshot, SendCopy }
 
         #if UNITY_STANDALONE_WIN && !UNITY_EDITOR_OSX
 
         internal static bool IsAvailable {
             get {
-                return SystemInfo.graphicsDeviceType ==
-                    UnityEngine.Rendering.GraphicsDeviceType.Direct3D11;
+                var type = SystemInfo.graphicsDeviceType;
+                return type == UnityEngine.Rendering.GraphicsDeviceType.Direct3D11 ||
+                       type == UnityEngine.Rendering.GraphicsDeviceType.Direct3D12 ||
+                       type == UnityEngine.Rendering.GraphicsDeviceType.Vulkan;
             }
         }
 
@@ -23,23 +25,140 @@ internal enum Event { Update, Dispose }
         internal static extern System.IntPtr GetRenderEventFunc();
 
         [DllImport("KlakSpout")]
-        internal static extern System.IntPtr CreateSender(string name, int width, int height);
+        internal static extern System.IntPtr CreateSender(string name, int width, int height, int format, [MarshalAs(UnmanagedType.Bool)] bool keyedMutex, int bufferCount);
+
+        [DllImport("KlakSpout")]
+        internal static extern System.IntPtr CreateAtlasSender(string name, int width, int height, int format, [MarshalAs(UnmanagedType.Bool)] bool keyedMutex);
 
         [DllImport("KlakSpout")]
         internal static extern System.IntPtr CreateReceiver(string name);
 
+        [DllImport("KlakSpout")]
+        internal static extern int SubmitEventBatch(int[] events, System.IntPtr[] objects, int count);
+
+        [DllImport("KlakSpout")]
+        internal static extern System.IntPtr GetEventQueuePosition();
+
+        [DllImport("KlakSpout")]
+        internal static extern int GetPendingDisposals();
+
         [DllImport("KlakSpout")]
         internal static extern System.IntPtr GetTexturePointer(System.IntPtr ptr);
 
+        [DllImport("KlakSpout")]
+        internal static extern System.IntPtr GetSrgbTexturePointer(System.IntPtr ptr);
+
         [DllImport("KlakSpout")]
         internal static extern int GetTextureWidth(System.IntPtr ptr);
 
         [DllImport("KlakSpout")]
         internal static extern int GetTextureHeight(System.IntPtr ptr);
 
+        [DllImport("KlakSpout")]
+        internal static extern int GetTextureFormat(System.IntPtr ptr);
+
         [DllImport("KlakSpout")] [return: MarshalAs(UnmanagedType.Bool)]
         internal static extern bool CheckValid(System.IntPtr ptr);
 
+        [DllImport("KlakSpout", EntryPoint = "IsNativeSendAvailable")]
+        [return: MarshalAs(UnmanagedType.Bool)]
+        static extern bool _IsNativeSendAvailable();
+
+        internal static bool IsNativeSendAvailable {
+            get { return _IsNativeSendAvailable(); }
+        }
+
+        [DllImport("KlakSpout", EntryPoint = "IsBridgeMode")]
+        [return: MarshalAs(UnmanagedType.Bool)]
+        static extern bool _IsBridgeMode();
+
+        // Bridge mode: The plugin uses its own D3D11 device, and the frames
+        // are exchanged with Unity via the interop surfaces on the GPU, or
+        // via the CPU when they're unavailable (D3D12 and Vulkan).
+        internal static bool IsBridgeMode {
+            get { return _IsBridgeMode(); }
+        }
+
+        [DllImport("KlakSpout")] [return: MarshalAs(UnmanagedType.Bool)]
+        internal static extern bool HasInteropSurface(System.IntPtr ptr);
+
+        [DllImport("KlakSpout")]
+        internal static extern void SetInteropSource(System.IntPtr ptr, System.IntPtr texture);
+
+        [DllImport("KlakSpout")]
+        internal static extern void UploadSourcePixels(System.IntPtr ptr, byte[] data, int size);
+
+        [DllImport("KlakSpout")]
+        internal static extern void SetSourceTexture(System.IntPtr ptr, System.IntPtr texture, int flags);
+
+        [DllImport("KlakSpout")]
+        internal static extern void SetTimestampMode(System.IntPtr ptr, bool enable);
+
+        [DllImport("KlakSpout")]
+        internal static extern void SetMirrorInterval(System.IntPtr ptr, int interval);
+
+        [DllImport("KlakSpout", EntryPoint = "IsNativeReceiveAvailable")]
+        [return: MarshalAs(UnmanagedType.Bool)]
+        static extern bool _IsNativeReceiveAvailable();
+
+        internal static bool IsNativeReceiveAvailable {
+            get { return _IsNativeReceiveAvailable(); }
+        }
+
+        [DllImport("KlakSpout")]
+        internal static extern void SetTargetTexture(System.IntPtr ptr, System.IntPtr texture, int flags);
+
+        [DllImport("KlakSpout")]
+        internal static extern void SetAtlasRegion(System.IntPtr ptr, int index, string name, int x, int y, int width, int height);
+
+        [DllImport("KlakSpout")]
+        internal static extern void SetAtlasSource(System.IntPtr ptr, int index, System.IntPtr texture, int flags);
+
+        [DllImport("KlakSpout")] [return: MarshalAs(UnmanagedType.Bool)]
+        internal static extern bool FindAtlasRegion(System.IntPtr ptr, string name, int[] rect);
+
+        [DllImport("KlakSpout")]
+        internal static extern void SetSourceRegion(System.IntPtr ptr, int x, int y, int width, int height);
+
+        [DllImport("KlakSpout")] [return: MarshalAs(UnmanagedType.Bool)]
+        internal static extern bool HasKeyedMutex(System.IntPtr ptr);
+
+        [DllImport("KlakSpout")]
+        internal static extern int GetFrameCount(System.IntPtr ptr);
+
+        [DllImport("KlakSpout")]
+        internal static extern void SetReadbackBuffer(System.IntPtr ptr, System.IntPtr buffer, int size);
+
+        [DllImport("KlakSpout")]
+        internal static extern int GetReadbackSize(System.IntPtr ptr);
+
+        [DllImport("KlakSpout")]
+        internal static extern int LockReadbackBuffer(System.IntPtr ptr);
+
+        [DllImport("KlakSpout")]
+        internal static extern void UnlockReadbackBuffer(System.IntPtr ptr);
+
+        [DllImport("KlakSpout")]
+        internal static extern void ConvertRgb10a2Pixels(byte[] dst, System.IntPtr src, int width, int height);
+
+        [DllImport("KlakSpout")]
+        internal static extern void GetStats(System.IntPtr ptr, out SpoutStats stats);
+
+        [DllImport("KlakSpout")] [return: MarshalAs(UnmanagedType.Bool)]
+        internal static extern bool IsCpuTransport(System.IntPtr ptr);
+
+        [DllImport("KlakSpout")]
+        internal static extern int GetAdapterCount();
+
+        [DllImport("KlakSpout")] [return: MarshalAs(UnmanagedType.Bool)]
+        internal static extern bool GetAdapterName(int index, System.Text.StringBuilder buffer, int length);
+
+        [DllImport("KlakSpout")]
+        internal static extern int GetDeviceAdapter();
+
+        [DllImport("KlakSpout")]
+        internal static extern int GetSharedObjectAdapter(string name);
+
         [DllImport("KlakSpout")]
         internal static extern int ScanSharedObjects();
 
@@ -52,6 +171,12 @@ internal static string GetSharedObjectNameString(int index)
             return ptr != System.IntPtr.Zero ? Marshal.PtrToStringAnsi(ptr) : null;
         }
 
+        [DllImport("KlakSpout")]
+        internal static extern int EnumerateSharedObjects(byte[] names, int[] attributes, int capacity);
+
+        [DllImport("KlakSpout")]
+        internal static extern int GetSharedObjectGeneration();
+
         #else
 
         internal static bool IsAvailable { get { return false; } }
@@ -59,30 +184,132 @@ internal static string GetSharedObjectNameString(int index)
         internal static System.IntPtr GetRenderEventFunc()
         { return System.IntPtr.Zero; }
 
-        internal static System.IntPtr CreateSender(string name, int width, int height)
+        internal static System.IntPtr CreateSender(string name, int width, int height, int format, bool keyedMutex, int bufferCount)
+        { return System.IntPtr.Zero; }
+
+        internal static System.IntPtr CreateAtlasSender(string name, int width, int height, int format, bool keyedMutex)
         { return System.IntPtr.Zero; }
 
         internal static System.IntPtr CreateReceiver(string name)
         { return System.IntPtr.Zero; }
 
+        internal static int SubmitEventBatch(int[] events, System.IntPtr[] objects, int count)
+        { return 0; }
+
+        internal static System.IntPtr GetEventQueuePosition()
+        { return System.IntPtr.Zero; }
+
+        internal static int GetPendingDisposals()
+        { return 0; }
+
         internal static System.IntPtr GetTexturePointer(System.IntPtr ptr)
         { return System.IntPtr.Zero; }
 
+        internal static System.IntPtr GetSrgbTexturePointer(System.IntPtr ptr)
+        { return System.IntPtr.Zero; }
+
         internal static int GetTextureWidth(System.IntPtr ptr)
         { return 0; }
 
         internal static int GetTextureHeight(System.IntPtr ptr)
         { return 0; }
 
+        internal static int GetTextureFormat(System.IntPtr ptr)
+        { return 0; }
+
         internal static bool CheckValid(System.IntPtr ptr)
         { return false; }
 
+        internal static bool IsNativeSendAvailable { get { return false; } }
+
+        internal static bool IsBridgeMode { get { return false; } }
+
+        internal static bool HasInteropSurface(System.IntPtr ptr)
+        { return false; }
+
+        internal static void SetInteropSource(System.IntPtr ptr, System.IntPtr texture)
+        { }
+
+        internal static void UploadSourcePixels(System.IntPtr ptr, byte[] data, int size)
+        { }
+
+        internal static void SetSourceTexture(System.IntPtr ptr, System.IntPtr texture, int flags)
+        { }
+
+        internal static void SetTimestampMode(System.IntPtr ptr, bool enable)
+        { }
+
+        internal static void SetMirrorInterval(System.IntPtr ptr, int interval)
+        { }
+
+        internal static bool IsNativeReceiveAvailable { get { return false; } }
+
+        internal static void SetTargetTexture(System.IntPtr ptr, System.IntPtr texture, int flags)
+        { }
+
+        internal static void SetAtlasRegion(System.IntPtr ptr, int index, string name, int x, int y, int width, int height)
+        { }
+
+        internal static void SetAtlasSource(System.IntPtr ptr, int index, System.IntPtr texture, int flags)
+        { }
+
+        internal static bool FindAtlasRegion(System.IntPtr ptr, string name, int[] rect)
+        { return false; }
+
+        internal static void SetSourceRegion(System.IntPtr ptr, int x, int y, int width, int height)
+        { }
+
+        internal static bool HasKeyedMutex(System.IntPtr ptr)
+        { return false; }
+
+        internal static int GetFrameCount(System.IntPtr ptr)
+        { return 0; }
+
+        internal static void SetReadbackBuffer(System.IntPtr ptr, System.IntPtr buffer, int size)
+        { }
+
+        internal static int GetReadbackSize(System.IntPtr ptr)
+        { return 0; }
+
+        internal static int LockReadbackBuffer(System.IntPtr ptr)
+        { return -1; }
+
+        internal static void UnlockReadbackBuffer(System.IntPtr ptr)
+        { }
+
+        internal static void ConvertRgb10a2Pixels(byte[] dst, System.IntPtr src, int width, int height)
+        { }
+
+        internal static void GetStats(System.IntPtr ptr, out SpoutStats stats)
+        { stats = default(SpoutStats); }
+
+        internal static bool IsCpuTransport(System.IntPtr ptr)
+        { return false; }
+
+        internal static int GetAdapterCount()
+        { return 0; }
+
+        internal static bool GetAdapterName(int index, System.Text.StringBuilder buffer, int length)
+        { return false; }
+
+        internal static int GetDeviceAdapter()
+        { return -1; }
+
+        internal static int GetSharedObjectAdapter(string name)
+        { return -1; }
+
         internal static int ScanSharedObjects()
         { return 0; }
 
         internal static string GetSharedObjectNameString(int index)
         { return null; }
 
+        internal static int EnumerateSharedObjects(byte[] names, int[] attributes, int capacity)
+        { return 0; }
+
+        internal static int GetSharedObjectGeneration()
+        { return -1; }
+
         #endif
     }
 }
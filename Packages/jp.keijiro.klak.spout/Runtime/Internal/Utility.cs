@@ -2,7 +2,10 @@
 // https://github.com/keijiro/KlakSpout
 
 using UnityEngine;
+using UnityEngine.LowLevel;
+using UnityEngine.PlayerLoop;
 using UnityEngine.Rendering;
+using System.Collections.Generic;
 
 namespace Klak.Spout
 {
@@ -23,6 +26,15 @@ internal static void Destroy(Object obj)
 
         internal static void
             IssuePluginEvent(PluginEntry.Event pluginEvent, System.IntPtr ptr)
+        {
+            // Push the batched events first, so that the plugin receives the
+            // events in the issue order.
+            FlushPluginEvents();
+            IssuePluginEventNow(pluginEvent, ptr);
+        }
+
+        static void
+            IssuePluginEventNow(PluginEntry.Event pluginEvent, System.IntPtr ptr)
         {
             if (_commandBuffer == null) _commandBuffer = new CommandBuffer();
 
@@ -34,5 +46,233 @@ internal static void
 
             _commandBuffer.Clear();
         }
+
+        // Batched plugin event submission
+        // In play mode, the events that don't interleave with Unity's
+        // commands (Update, Dispose, the deferred sends, etc.) are accumulated
+        // and pushed into the plugin's command queue at once at the beginning
+        // of PostLateUpdate, then a single flush event is issued.
+        // Other events are issued immediately as they're order-sensitive with
+        // respect to Unity's own rendering commands. An immediate event
+        // pushes the pending batch before it, so that it never overtakes the
+        // events queued before it (e.g. the Update event of the same frame).
+
+        static int[] _batchEvents = new int[64];
+        static System.IntPtr[] _batchObjects = new System.IntPtr[64];
+        static int _batchCount;
+        static bool _batchInstalled;
+        static bool _quitting;
+
+        struct PluginEventFlush {}
+
+        internal static void
+            QueuePluginEvent(PluginEntry.Event pluginEvent, System.IntPtr ptr)
+        {
+            // Immediate submission in edit mode and on quit, where the
+            // player loop may not run anymore.
+            if (!Application.isPlaying || _quitting)
+            {
+                IssuePluginEvent(pluginEvent, ptr);
+                return;
+            }
+
+            if (!_batchInstalled) InstallBatchFlush();
+
+            if (_batchCount == _batchEvents.Length)
+            {
+                System.Array.Resize(ref _batchEvents, _batchCount * 2);
+                System.Array.Resize(ref _batchObjects, _batchCount * 2);
+            }
+
+            _batchEvents[_batchCount] = (int)pluginEvent;
+            _batchObjects[_batchCount] = ptr;
+            _batchCount++;
+        }
+
+        // Reset the states on entering play mode without domain reload.
+        [RuntimeInitializeOnLoadMethod(RuntimeInitializeLoadType.SubsystemRegistration)]
+        static void ResetBatchState()
+        {
+            _batchCount = 0;
+            _batchInstalled = false;
+            _quitting = false;
+        }
+
+        static void FlushPluginEvents()
+        {
+            if (_batchCount == 0)
+            {
+                FlushDisposals();
+                return;
+            }
+
+            var accepted = PluginEntry.SubmitEventBatch
+                (_batchEvents, _batchObjects, _batchCount);
+
+            // Reset the count first, as the events below go through the
+            // immediate path.
+            var count = _batchCount;
+            _batchCount = 0;
+
+            if (accepted > 0)
+                IssuePluginEventNow(PluginEntry.Event.Flush,
+                                    PluginEntry.GetEventQueuePosition());
+
+            // Issue the rest individually when the queue is full.
+            for (var i = accepted; i < count; i++)
+                IssuePluginEventNow((PluginEntry.Event)_batchEvents[i], _batchObjects[i]);
+        }
+
+        // The plugin destroys the disposed objects a few at a time in the
+        // flush events. Keep issuing the event while there are objects left,
+        // as no other event may come after the last object is disposed.
+        static void FlushDisposals()
+        {
+            if (PluginEntry.GetPendingDisposals() == 0) return;
+            IssuePluginEventNow(PluginEntry.Event.Flush,
+                                PluginEntry.GetEventQueuePosition());
+        }
+
+        #if UNITY_EDITOR
+
+        // The player loop flush isn't installed in edit mode, where the
+        // events are issued individually.
+        [UnityEditor.InitializeOnLoadMethod]
+        static void InstallEditorDisposalFlush()
+        {
+            UnityEditor.EditorApplication.update += () =>
+            {
+                if (!Application.isPlaying) FlushDisposals();
+            };
+        }
+
+        #endif
+
+        static void InstallBatchFlush()
+        {
+            var loop = PlayerLoop.GetCurrentPlayerLoop();
+
+            for (var i = 0; i < loop.subSystemList.Length; i++)
+            {
+                if (loop.subSystemList[i].type != typeof(PostLateUpdate)) continue;
+
+                // Remove the one installed before the last domain reload.
+                var systems = new List<PlayerLoopSystem>
+                    (loop.subSystemList[i].subSystemList);
+                systems.RemoveAll(s => s.type != null &&
+                    s.type.FullName == typeof(PluginEventFlush).FullName);
+
+                systems.Insert(0, new PlayerLoopSystem {
+                    type = typeof(PluginEventFlush),
+                    updateDelegate = FlushPluginEvents
+                });
+
+                loop.subSystemList[i].subSystemList = systems.ToArray();
+            }
+
+            PlayerLoop.SetPlayerLoop(loop);
+
+            // Application.quitting is also invoked on exiting play mode.
+            Application.quitting -= OnQuitting;
+            Application.quitting += OnQuitting;
+
+            _batchInstalled = true;
+        }
+
+        static void OnQuitting()
+        {
+            FlushPluginEvents();
+            _quitting = true;
+        }
+
+        // DXGI format values used in the shared textures
+        const int DXGI_FORMAT_R16G16B16A16_FLOAT = 10;
+        const int DXGI_FORMAT_R10G10B10A2_UNORM = 24;
+        const int DXGI_FORMAT_R8G8B8A8_UNORM = 28;
+        const int DXGI_FORMAT_B8G8R8A8_UNORM = 87;
+
+        internal static int ToDxgiFormat(SpoutFormat format)
+        {
+            switch (format)
+            {
+                case SpoutFormat.BGRA32: return DXGI_FORMAT_B8G8R8A8_UNORM;
+                case SpoutFormat.RGBAHalf: return DXGI_FORMAT_R16G16B16A16_FLOAT;
+                case SpoutFormat.RGB10A2: return DXGI_FORMAT_R10G10B10A2_UNORM;
+                default: return DXGI_FORMAT_R8G8B8A8_UNORM;
+            }
+        }
+
+        // Texture format that is used to wrap a shared texture. RGB10A2 has
+        // no equivalent, so it's wrapped as ARGB32; it's only sampled and
+        // never copied, so the format description doesn't matter there.
+        internal static TextureFormat ToTextureFormat(int dxgiFormat)
+        {
+            switch (dxgiFormat)
+            {
+                case DXGI_FORMAT_B8G8R8A8_UNORM: return TextureFormat.BGRA32;
+                case DXGI_FORMAT_R16G16B16A16_FLOAT: return TextureFormat.RGBAHalf;
+                default: return TextureFormat.ARGB32;
+            }
+        }
+
+        // Texture format that has the same memory layout as the shared
+        // texture, used when the pixels are copied via the CPU.
+        internal static bool TryGetRawTextureFormat(int dxgiFormat, out TextureFormat format)
+        {
+            switch (dxgiFormat)
+            {
+                case DXGI_FORMAT_R8G8B8A8_UNORM: format = TextureFormat.RGBA32; return true;
+                case DXGI_FORMAT_B8G8R8A8_UNORM: format = TextureFormat.BGRA32; return true;
+                case DXGI_FORMAT_R16G16B16A16_FLOAT: format = TextureFormat.RGBAHalf; return true;
+                default: format = TextureFormat.RGBA32; return false;
+            }
+        }
+
+        // Render texture format that has the same memory layout as the shared
+        // texture, used when Unity's device copies it into the interop
+        // surface (bridge mode).
+        internal static bool TryGetInteropTextureFormat(int dxgiFormat, out RenderTextureFormat format)
+        {
+            switch (dxgiFormat)
+            {
+                case DXGI_FORMAT_R8G8B8A8_UNORM: format = RenderTextureFormat.ARGB32; return true;
+                case DXGI_FORMAT_B8G8R8A8_UNORM: format = RenderTextureFormat.BGRA32; return true;
+                case DXGI_FORMAT_R16G16B16A16_FLOAT: format = RenderTextureFormat.ARGBHalf; return true;
+                case DXGI_FORMAT_R10G10B10A2_UNORM: format = RenderTextureFormat.ARGB2101010; return true;
+                default: format = RenderTextureFormat.ARGB32; return false;
+            }
+        }
+
+        // Texture format used to upload the read back pixels (bridge mode).
+        // RGB10A2 has no equivalent, so it's converted into RGBA32.
+        internal static bool TryGetUploadTextureFormat(int dxgiFormat, out TextureFormat format)
+        {
+            if (dxgiFormat == DXGI_FORMAT_R10G10B10A2_UNORM)
+            {
+                format = TextureFormat.RGBA32;
+                return true;
+            }
+            return TryGetRawTextureFormat(dxgiFormat, out format);
+        }
+
+        // Float formats store linear values. The others store
+        // gamma-encoded values as Spout applications expect.
+        internal static bool IsLinearFormat(int dxgiFormat)
+        {
+            return dxgiFormat == DXGI_FORMAT_R16G16B16A16_FLOAT;
+        }
+
+        // RGB10A2 pixels have to be converted before uploading.
+        internal static bool IsRgb10a2Format(int dxgiFormat)
+        {
+            return dxgiFormat == DXGI_FORMAT_R10G10B10A2_UNORM;
+        }
+
+        // High precision formats should be received without quantization.
+        internal static bool IsHighPrecisionFormat(int dxgiFormat)
+        {
+            return dxgiFormat == DXGI_FORMAT_R16G16B16A16_FLOAT ||
+                   dxgiFormat == DXGI_FORMAT_R10G10B10A2_UNORM;
+        }
     }
 }
@@ -0,0 +1,267 @@
+// KlakSpout - Spout video frame sharing plugin for Unity
+// https://github.com/keijiro/KlakSpout
+
+using UnityEngine;
+
+namespace Klak.Spout
+{
+    // Atlas sender: Packs multiple source textures into the grid cells of a
+    // single shared texture, and publishes the cells as named regions. The
+    // receivers select one of them with the sourceRegion property.
+    // It needs the native send path (D3D11).
+    [ExecuteInEditMode]
+    [AddComponentMenu("Klak/Spout/Spout Atlas Sender")]
+    public sealed class SpoutAtlasSender : MonoBehaviour
+    {
+        #region Source settings
+
+        [System.Serializable]
+        public struct Source
+        {
+            public string name;
+            public RenderTexture texture;
+        }
+
+        // Sources are placed in the cells in the row-major order. The ones
+        // that don't fit in the grid are ignored.
+        [SerializeField] Source[] _sources = new Source[0];
+
+        public Source[] sources {
+            get { return _sources; }
+            set { _sources = value; }
+        }
+
+        #endregion
+
+        #region Layout settings
+
+        [SerializeField] Vector2Int _cellSize = new Vector2Int(256, 256);
+
+        public Vector2Int cellSize {
+            get { return _cellSize; }
+            set {
+                value = Vector2Int.Max(value, Vector2Int.one);
+                if (_cellSize == value) return;
+                _cellSize = value;
+                RequestReconnect();
+            }
+        }
+
+        [SerializeField] Vector2Int _gridSize = new Vector2Int(8, 4);
+
+        public Vector2Int gridSize {
+            get { return _gridSize; }
+            set {
+                value = Vector2Int.Max(value, Vector2Int.one);
+                if (_gridSize == value) return;
+                _gridSize = value;
+                RequestReconnect();
+            }
+        }
+
+        #endregion
+
+        #region Format options
+
+        [SerializeField] SpoutFormat _format;
+
+        public SpoutFormat format {
+            get { return _format; }
+            set {
+                if (_format == value) return;
+                _format = value;
+                RequestReconnect();
+            }
+        }
+
+        [SerializeField] bool _alphaSupport;
+
+        public bool alphaSupport {
+            get { return _alphaSupport; }
+            set { _alphaSupport = value; }
+        }
+
+        #endregion
+
+        #region Private members
+
+        // Plugin-side region limit (SPOUT_ATLAS_MAX)
+        const int MaxRegions = 128;
+
+        System.IntPtr _plugin;
+
+        // Region states given to the plugin, used for only sending changes
+        // GetNativeTexturePtr may stall the main thread, so we only call it
+        // when the source texture has been changed.
+        string[] _regionNames = new string[MaxRegions];
+        RenderTexture[] _regionTextures = new RenderTexture[MaxRegions];
+        System.IntPtr[] _regionPointers = new System.IntPtr[MaxRegions];
+        Vector2Int[] _regionSizes = new Vector2Int[MaxRegions];
+        bool[] _regionCreated = new bool[MaxRegions];
+        int[] _regionFlags = new int[MaxRegions];
+        int _regionCount;
+
+        int CellCount {
+            get { return Mathf.Min(_gridSize.x * _gridSize.y, MaxRegions); }
+        }
+
+        // Region name update (it republishes the atlas map)
+        void UpdateRegionName(int index, string name)
+        {
+            if (name == _regionNames[index]) return;
+
+            var w = _cellSize.x;
+            var h = _cellSize.y;
+            var x = (index % _gridSize.x) * w;
+            var y = (index / _gridSize.x) * h;
+
+            if (string.IsNullOrEmpty(name))
+                PluginEntry.SetAtlasRegion(_plugin, index, null, 0, 0, 0, 0);
+            else
+                PluginEntry.SetAtlasRegion(_plugin, index, name, x, y, w, h);
+
+            _regionNames[index] = name;
+        }
+
+        // Region source update
+        void UpdateRegionSource(int index, RenderTexture texture)
+        {
+            var ptr = _regionPointers[index];
+            var created = texture != null && texture.IsCreated();
+
+            // A released texture has no native texture, and it gets a new one
+            // when it's created again.
+            if (!created)
+            {
+                ptr = System.IntPtr.Zero;
+            }
+            else if (ptr == System.IntPtr.Zero ||
+                     texture != _regionTextures[index] ||
+                     texture.width != _regionSizes[index].x ||
+                     texture.height != _regionSizes[index].y ||
+                     !_regionCreated[index])
+            {
+                ptr = texture.GetNativeTexturePtr();
+            }
+
+            // Conversion flags (same as SpoutSender)
+            var flags = _alphaSupport ? 0 : 1;
+            if (texture != null)
+            {
+                var linearSource = QualitySettings.activeColorSpace == ColorSpace.Linear && !texture.sRGB;
+                if (Util.IsLinearFormat(PluginEntry.GetTextureFormat(_plugin)))
+                {
+                    if (!linearSource) flags |= 4;
+                }
+                else
+                {
+                    if (linearSource) flags |= 2;
+                }
+            }
+
+            if (ptr == _regionPointers[index] && flags == _regionFlags[index] &&
+                texture == _regionTextures[index]) return;
+
+            PluginEntry.SetAtlasSource(_plugin, index, ptr, flags);
+
+            _regionTextures[index] = texture;
+            _regionPointers[index] = ptr;
+            _regionCreated[index] = created;
+            _regionSizes[index] = texture != null ?
+                new Vector2Int(texture.width, texture.height) : Vector2Int.zero;
+            _regionFlags[index] = flags;
+        }
+
+        void ResetRegionCache()
+        {
+            System.Array.Clear(_regionNames, 0, MaxRegions);
+            System.Array.Clear(_regionTextures, 0, MaxRegions);
+            System.Array.Clear(_regionPointers, 0, MaxRegions);
+            System.Array.Clear(_regionSizes, 0, MaxRegions);
+            System.Array.Clear(_regionCreated, 0, MaxRegions);
+            System.Array.Clear(_regionFlags, 0, MaxRegions);
+            _regionCount = 0;
+        }
+
+        #endregion
+
+        #region Statistics
+
+        // Retrieve the statistics of the plugin object. Returns false when
+        // it's not created yet.
+        public bool GetStats(out SpoutStats stats)
+        {
+            stats = default(SpoutStats);
+            if (_plugin == System.IntPtr.Zero) return false;
+            PluginEntry.GetStats(_plugin, out stats);
+            return true;
+        }
+
+        #endregion
+
+        #region Internal members
+
+        internal void RequestReconnect()
+        {
+            OnDisable();
+        }
+
+        #endregion
+
+        #region MonoBehaviour implementation
+
+        void OnDisable()
+        {
+            if (_plugin != System.IntPtr.Zero)
+            {
+                Util.QueuePluginEvent(PluginEntry.Event.Dispose, _plugin);
+                _plugin = System.IntPtr.Zero;
+            }
+
+            ResetRegionCache();
+        }
+
+        void Update()
+        {
+            // The atlas is only drawn with the native blitter.
+            if (!PluginEntry.IsNativeSendAvailable) return;
+
+            // Plugin lazy initialization
+            if (_plugin == System.IntPtr.Zero)
+            {
+                _plugin = PluginEntry.CreateAtlasSender(
+                    name, _cellSize.x * _gridSize.x, _cellSize.y * _gridSize.y,
+                    Util.ToDxgiFormat(_format), false
+                );
+                if (_plugin == System.IntPtr.Zero) return; // Spout may not be ready.
+            }
+
+            // Update the plugin internal state.
+            Util.QueuePluginEvent(PluginEntry.Event.Update, _plugin);
+
+            // Region updates
+            var count = _sources != null ? Mathf.Min(_sources.Length, CellCount) : 0;
+
+            for (var i = 0; i < count; i++)
+            {
+                UpdateRegionName(i, _sources[i].name);
+                UpdateRegionSource(i, _sources[i].texture);
+            }
+
+            // Remove the regions that are no longer used.
+            for (var i = count; i < _regionCount; i++)
+            {
+                UpdateRegionName(i, null);
+                UpdateRegionSource(i, null);
+            }
+
+            _regionCount = count;
+
+            // Draw all the regions in a single event, batched after the update
+            // event.
+            Util.QueuePluginEvent(PluginEntry.Event.SendAtlas, _plugin);
+        }
+
+        #endregion
+    }
+}
@@ -3,19 +3,66 @@
 
 using UnityEngine;
 using System.Collections.Generic;
+using System.Runtime.InteropServices;
 
 namespace Klak.Spout
 {
+    // Spout source information
+    public struct SpoutSourceInfo
+    {
+        public string name;
+        public int width;
+        public int height;
+        public int format; // DXGI_FORMAT value (zero for DX9 senders)
+    }
+
+    // Per-sender/receiver statistics retrieved from the plugin
+    // The counters are accumulated since the creation of the plugin object
+    // (reconnection resets them). Times are in microseconds. The layout
+    // matches Stats::Snapshot in the plugin.
+    [StructLayout(LayoutKind.Sequential)]
+    public struct SpoutStats
+    {
+        public long activationAttempts;
+        public long activations;
+        public long lockCount;        // keyed mutex acquisitions
+        public long lockTimeouts;
+        public long lockWaitTime;     // total
+        public long infoTimeouts;     // sender info map lock timeouts
+        public long framesSent;
+        public long framesReceived;
+        public long updateCount;
+        public long updateTime;       // total (render thread CPU time)
+        public long updateTimeMax;
+        public long gpuCount;
+        public long gpuTime;          // total (copy/conversion GPU time)
+        public long gpuTimeLast;
+        public long latencyCount;     // timestamped frames consumed
+        public long latencyTime;      // total (sender copy to receiver use)
+        public long latencyLast;
+        public long latencyMax;
+    }
+
     public static class SpoutManager
     {
+        #region Public methods
+
+        // Generation number of the source list. It changes when a source is
+        // added or removed, so callers can skip re-enumeration while it stays
+        // the same. Returns -1 when it's not available. Note that Spout
+        // applications that don't support it may change the list without
+        // updating the generation number.
+        public static int sourceListGeneration {
+            get { return PluginEntry.GetSharedObjectGeneration(); }
+        }
+
         // Scan available Spout sources and return their names via a newly
-        // allocated string array.
+        // allocated string array. The names are sorted in ordinal order.
         public static string[] GetSourceNames()
         {
-            var count = PluginEntry.ScanSharedObjects();
+            var count = Enumerate();
             var names = new string [count];
-            for (var i = 0; i < count; i++)
-                names[i] = PluginEntry.GetSharedObjectNameString(i);
+            System.Array.Copy(_nameCache, names, count);
             return names;
         }
 
@@ -24,9 +71,125 @@ public static string[] GetSourceNames()
         public static void GetSourceNames(ICollection<string> store)
         {
             store.Clear();
-            var count = PluginEntry.ScanSharedObjects();
+            var count = Enumerate();
+            for (var i = 0; i < count; i++) store.Add(_nameCache[i]);
+        }
+
+        // Scan available Spout sources and store their information into the
+        // given collection object.
+        public static void GetSources(ICollection<SpoutSourceInfo> store)
+        {
+            store.Clear();
+            var count = Enumerate();
+            for (var i = 0; i < count; i++)
+                store.Add(new SpoutSourceInfo {
+                    name = _nameCache[i],
+                    width = _attributes[i * 3 + 0],
+                    height = _attributes[i * 3 + 1],
+                    format = _attributes[i * 3 + 2]
+                });
+        }
+
+        #endregion
+
+        #region Adapter query
+
+        // Names of the graphics adapters in the system. The indices are the
+        // ones used in deviceAdapterIndex and GetSourceAdapterIndex.
+        public static string[] GetAdapterNames()
+        {
+            var count = PluginEntry.GetAdapterCount();
+            var names = new string [count];
+            var buffer = new System.Text.StringBuilder(NameLength);
+            for (var i = 0; i < count; i++)
+                if (PluginEntry.GetAdapterName(i, buffer, buffer.Capacity))
+                    names[i] = buffer.ToString();
+            return names;
+        }
+
+        // Index of the adapter that Unity renders with (-1 if unknown)
+        public static int deviceAdapterIndex {
+            get { return PluginEntry.GetDeviceAdapter(); }
+        }
+
+        // Index of the adapter that a source renders with. Returns -1 when
+        // unknown; only KlakSpout senders tell it. A source on another
+        // adapter is received via the slower CPU fallback transport.
+        public static int GetSourceAdapterIndex(string name)
+        {
+            return PluginEntry.GetSharedObjectAdapter(name);
+        }
+
+        #endregion
+
+        #region Bulk enumeration
+
+        // The names are retrieved into a byte buffer in one call. Strings are
+        // only decoded for the slots that have been changed since the last
+        // enumeration, so that it doesn't allocate in steady state.
+
+        const int NameLength = 256; // SpoutMaxSenderNameLen
+        const int InitialCapacity = 16;
+
+        static byte[] _names = new byte[InitialCapacity * NameLength];
+        static byte[] _lastNames = new byte[InitialCapacity * NameLength];
+        static int[] _attributes = new int[InitialCapacity * 3];
+        static string[] _nameCache = new string[InitialCapacity];
+
+        static int Enumerate()
+        {
+            var capacity = _nameCache.Length;
+            var count = PluginEntry.EnumerateSharedObjects(_names, _attributes, capacity);
+
+            // Expand the buffers and retry when they're too small.
+            if (count > capacity)
+            {
+                capacity = count;
+                System.Array.Resize(ref _names, capacity * NameLength);
+                System.Array.Resize(ref _lastNames, capacity * NameLength);
+                System.Array.Resize(ref _attributes, capacity * 3);
+                System.Array.Resize(ref _nameCache, capacity);
+                count = Mathf.Min(capacity,
+                    PluginEntry.EnumerateSharedObjects(_names, _attributes, capacity));
+            }
+
+            // Name cache update
             for (var i = 0; i < count; i++)
-                store.Add(PluginEntry.GetSharedObjectNameString(i));
+            {
+                var offset = i * NameLength;
+                if (_nameCache[i] != null && CompareSlot(offset)) continue;
+                _nameCache[i] = DecodeSlot(offset);
+                System.Buffer.BlockCopy(_names, offset, _lastNames, offset, NameLength);
+            }
+
+            return count;
         }
+
+        static bool CompareSlot(int offset)
+        {
+            for (var i = offset; i < offset + NameLength; i++)
+            {
+                var c = _names[i];
+                if (c != _lastNames[i]) return false;
+                if (c == 0) break;
+            }
+            return true;
+        }
+
+        static string DecodeSlot(int offset)
+        {
+            var handle = GCHandle.Alloc(_names, GCHandleType.Pinned);
+            try
+            {
+                var ptr = handle.AddrOfPinnedObject() + offset;
+                return Marshal.PtrToStringAnsi(ptr);
+            }
+            finally
+            {
+                handle.Free();
+            }
+        }
+
+        #endregion
     }
 }
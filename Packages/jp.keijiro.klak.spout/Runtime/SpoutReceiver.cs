@@ -2,6 +2,8 @@
 // https://github.com/keijiro/KlakSpout
 
 using UnityEngine;
+using UnityEngine.Experimental.Rendering;
+using System.Runtime.InteropServices;
 
 namespace Klak.Spout
 {
@@ -22,6 +24,15 @@ public sealed class SpoutReceiver : MonoBehaviour
             }
         }
 
+        // Name of the region to receive from an atlas sender (empty for the
+        // whole frame)
+        [SerializeField] string _sourceRegion;
+
+        public string sourceRegion {
+            get { return _sourceRegion; }
+            set { _sourceRegion = value; }
+        }
+
         #endregion
 
         #region Target settings
@@ -47,14 +58,108 @@ public sealed class SpoutReceiver : MonoBehaviour
             set { _targetMaterialProperty = value; }
         }
 
+        // Bind the shared texture to the target renderer without conversion
+        // when possible. The Y flip and the source region are applied with the
+        // scale/offset (_ST) of the material property instead.
+        [SerializeField] bool _directMode;
+
+        public bool directMode {
+            get { return _directMode; }
+            set { _directMode = value; }
+        }
+
         #endregion
 
         #region Runtime properties
 
         RenderTexture _receivedTexture;
 
+        // In the direct mode, it returns the shared texture that is upside
+        // down and contains the whole frame.
         public Texture receivedTexture {
-            get { return _targetTexture != null ? _targetTexture : _receivedTexture; }
+            get {
+                if (_targetTexture != null) return _targetTexture;
+                return _directTexture != null ? _directTexture : _receivedTexture;
+            }
+        }
+
+        // True while receiving via the CPU fallback transport, which is used
+        // when the sender is on another adapter.
+        public bool isCpuTransport {
+            get {
+                return _plugin != System.IntPtr.Zero &&
+                    PluginEntry.IsCpuTransport(_plugin);
+            }
+        }
+
+        #endregion
+
+        #region CPU readback
+
+        byte[] _readbackBuffer;
+        GCHandle _readbackHandle;
+        bool _readbackLocked;
+
+        // Required size of the readback buffer (zero when not connected)
+        public int readbackBufferSize {
+            get {
+                return _plugin != System.IntPtr.Zero ?
+                    PluginEntry.GetReadbackSize(_plugin) : 0;
+            }
+        }
+
+        // Set the buffer for the asynchronous CPU readback (null to stop).
+        // Received frames are copied into it a few frames later, as tightly
+        // packed rows in the shared texture format (top row first). The
+        // buffer is pinned until it's replaced or the receiver is destroyed.
+        public void SetReadbackBuffer(byte[] buffer)
+        {
+            if (buffer == _readbackBuffer) return;
+
+            // Detach the current buffer before unpinning it.
+            DetachReadbackBuffer();
+            if (_readbackHandle.IsAllocated) _readbackHandle.Free();
+
+            _readbackBuffer = buffer;
+            if (buffer != null)
+                _readbackHandle = GCHandle.Alloc(buffer, GCHandleType.Pinned);
+
+            AttachReadbackBuffer();
+        }
+
+        // Try locking the readback buffer for reading. It fails while the
+        // plugin is writing a frame into it. The frame number increases with
+        // every frame written into the buffer; zero means no frame yet.
+        public bool TryLockReadbackBuffer(out int frame)
+        {
+            frame = 0;
+            if (_plugin == System.IntPtr.Zero || _readbackBuffer == null) return false;
+            if (_readbackLocked) return false;
+            frame = PluginEntry.LockReadbackBuffer(_plugin);
+            _readbackLocked = frame >= 0;
+            return _readbackLocked;
+        }
+
+        // Unlock the readback buffer locked with TryLockReadbackBuffer.
+        public void UnlockReadbackBuffer()
+        {
+            if (!_readbackLocked) return;
+            PluginEntry.UnlockReadbackBuffer(_plugin);
+            _readbackLocked = false;
+        }
+
+        void AttachReadbackBuffer()
+        {
+            if (_plugin == System.IntPtr.Zero || _readbackBuffer == null) return;
+            PluginEntry.SetReadbackBuffer(_plugin,
+                _readbackHandle.AddrOfPinnedObject(), _readbackBuffer.Length);
+        }
+
+        void DetachReadbackBuffer()
+        {
+            if (_plugin == System.IntPtr.Zero) return;
+            UnlockReadbackBuffer();
+            PluginEntry.SetReadbackBuffer(_plugin, System.IntPtr.Zero, 0);
         }
 
         #endregion
@@ -64,9 +169,358 @@ public sealed class SpoutReceiver : MonoBehaviour
         System.IntPtr _plugin;
         Texture2D _sharedTexture;
         System.IntPtr _sharedTexturePointer;
+        int _sharedTextureFormat;
         Material _blitMaterial;
         MaterialPropertyBlock _propertyBlock;
 
+        // Frame count and destinations of the last conversion, used to skip
+        // redundant conversions while the sender has no new frame.
+        int _lastFrameCount;
+        RenderTexture _lastTargetTexture;
+        Renderer _lastTargetRenderer;
+        string _lastTargetMaterialProperty;
+        string _lastSourceRegion;
+
+        // Region rectangle buffer used in the atlas lookup
+        static int[] _regionBuffer = new int[4];
+
+        // Readback frame number of the last upload, and the conversion buffer
+        // for RGB10A2 frames (bridge mode)
+        int _bridgeFrame;
+        byte[] _bridgeBuffer;
+
+        // The shared texture is the upload texture of the bridge mode, rather
+        // than the external texture.
+        bool _bridgeTexture;
+
+        // Texture bound in the direct mode (null while converting), the sRGB
+        // view wrapper used for it, and the renderer and the property that
+        // have the overridden scale/offset
+        Texture _directTexture;
+        Texture2D _srgbTexture;
+        System.IntPtr _srgbTexturePointer;
+        Renderer _directRenderer;
+        string _directProperty;
+
+        // Native texture pointer cache of the conversion destination
+        RenderTexture _targetCache;
+        System.IntPtr _targetPointer;
+        int _targetWidth, _targetHeight;
+
+        // Target texture and flags given to the plugin
+        System.IntPtr _targetGiven;
+        int _targetFlags;
+
+        bool CheckNewFrame()
+        {
+            var frameCount = PluginEntry.GetFrameCount(_plugin);
+
+            // Zero means that the sender doesn't tell frame counts.
+            var isNew = frameCount == 0 ||
+                        frameCount != _lastFrameCount ||
+                        _targetTexture != _lastTargetTexture ||
+                        _targetRenderer != _lastTargetRenderer ||
+                        _targetMaterialProperty != _lastTargetMaterialProperty ||
+                        _sourceRegion != _lastSourceRegion;
+
+            _lastFrameCount = frameCount;
+            _lastTargetTexture = _targetTexture;
+            _lastTargetRenderer = _targetRenderer;
+            _lastTargetMaterialProperty = _targetMaterialProperty;
+            _lastSourceRegion = _sourceRegion;
+
+            // Always update in edit mode where we can't track changes.
+            return isNew || !Application.isPlaying;
+        }
+
+        // Shared texture update: Wrap the shared texture with an external
+        // texture. Returns false when the sender has no new frame.
+        bool UpdateSharedTexture()
+        {
+            // Texture information retrieval
+            var ptr = PluginEntry.GetTexturePointer(_plugin);
+            var width = PluginEntry.GetTextureWidth(_plugin);
+            var height = PluginEntry.GetTextureHeight(_plugin);
+            var format = PluginEntry.GetTextureFormat(_plugin);
+
+            // Resource validity check
+            if (_sharedTexture != null)
+            {
+                if (ptr == System.IntPtr.Zero ||
+                    width != _sharedTexture.width ||
+                    height != _sharedTexture.height ||
+                    format != _sharedTextureFormat)
+                {
+                    // Not match: Destroy to get refreshed.
+                    Util.Destroy(_sharedTexture);
+                    _sharedTexture = null;
+                }
+                else if (ptr != _sharedTexturePointer)
+                {
+                    // Only the texture has been switched (ring buffer mode).
+                    _sharedTexture.UpdateExternalTexture(ptr);
+                    _sharedTexturePointer = ptr;
+                }
+            }
+
+            // Shared texture lazy (re)initialization
+            if (_sharedTexture == null && ptr != System.IntPtr.Zero)
+            {
+                _sharedTexture = Texture2D.CreateExternalTexture(
+                    width, height, Util.ToTextureFormat(format), false, false, ptr
+                );
+                _sharedTexture.hideFlags = HideFlags.DontSave;
+                _sharedTexturePointer = ptr;
+                _sharedTextureFormat = format;
+
+                // Force the conversion for the new texture.
+                _lastFrameCount = 0;
+            }
+
+            // Nothing to do when the sender hasn't produced a new frame.
+            return _sharedTexture == null || CheckNewFrame();
+        }
+
+        // Bridge mode update: Upload the frame that the plugin has read back
+        // into a texture. Returns false when there is no new frame.
+        bool UpdateBridgeTexture()
+        {
+            var width = PluginEntry.GetTextureWidth(_plugin);
+            var height = PluginEntry.GetTextureHeight(_plugin);
+            var format = PluginEntry.GetTextureFormat(_plugin);
+
+            TextureFormat textureFormat;
+            if (width <= 0 || height <= 0 ||
+                !Util.TryGetUploadTextureFormat(format, out textureFormat)) return false;
+
+            // Readback buffer lazy initialization (shared with the buffer
+            // given via SetReadbackBuffer)
+            var size = PluginEntry.GetReadbackSize(_plugin);
+            if (_readbackBuffer == null || _readbackBuffer.Length < size)
+                SetReadbackBuffer(new byte[size]);
+
+            // Resource validity check
+            if (_sharedTexture != null &&
+                (width != _sharedTexture.width ||
+                 height != _sharedTexture.height ||
+                 format != _sharedTextureFormat))
+            {
+                Util.Destroy(_sharedTexture);
+                _sharedTexture = null;
+            }
+
+            // Texture lazy (re)initialization
+            // It's linear as the values are decoded in the blit shader.
+            if (_sharedTexture == null)
+            {
+                _sharedTexture = new Texture2D(width, height, textureFormat, false, true);
+                _sharedTexture.hideFlags = HideFlags.DontSave;
+                _sharedTextureFormat = format;
+                _bridgeFrame = 0;
+            }
+
+            // Upload the latest frame in the readback buffer.
+            int frame;
+            if (!TryLockReadbackBuffer(out frame)) return false;
+
+            var uploaded = frame > 0 && frame != _bridgeFrame;
+            if (uploaded && Util.IsRgb10a2Format(format))
+            {
+                // The readback buffer keeps the raw pixels, so RGB10A2 is
+                // converted into a separate buffer for the upload.
+                if (_bridgeBuffer == null || _bridgeBuffer.Length != size)
+                    _bridgeBuffer = new byte[size];
+                PluginEntry.ConvertRgb10a2Pixels
+                    (_bridgeBuffer, _readbackHandle.AddrOfPinnedObject(), width, height);
+                _sharedTexture.LoadRawTextureData(_bridgeBuffer);
+            }
+            else if (uploaded)
+            {
+                _sharedTexture.LoadRawTextureData
+                    (_readbackHandle.AddrOfPinnedObject(), size);
+            }
+
+            UnlockReadbackBuffer();
+
+            if (uploaded)
+            {
+                _sharedTexture.Apply(false);
+                _bridgeFrame = frame;
+            }
+
+            // CheckNewFrame is evaluated anyway to track the target changes.
+            return CheckNewFrame() | uploaded;
+        }
+
+        // Source region retrieval: The whole shared texture, or the named
+        // region in the atlas map of the sender. Returns false when the
+        // region is not found.
+        bool TryGetSourceRegion(out RectInt region)
+        {
+            region = new RectInt(0, 0, _sharedTexture.width, _sharedTexture.height);
+            if (string.IsNullOrEmpty(_sourceRegion)) return true;
+            if (!PluginEntry.FindAtlasRegion(_plugin, _sourceRegion, _regionBuffer)) return false;
+            region = new RectInt(_regionBuffer[0], _regionBuffer[1], _regionBuffer[2], _regionBuffer[3]);
+            return true;
+        }
+
+        // Native path: The plugin converts the shared texture into the
+        // destination with a compute shader on the render thread.
+        void ReceiveWithCompute(RenderTexture destination, RectInt region)
+        {
+            // Destination texture pointer update
+            // GetNativeTexturePtr may stall the main thread, so we only call
+            // it when the destination has been changed. A released
+            // destination is created again with a new native texture.
+            if (_targetPointer == System.IntPtr.Zero ||
+                !destination.IsCreated() ||
+                destination != _targetCache ||
+                destination.width != _targetWidth ||
+                destination.height != _targetHeight)
+            {
+                if (!destination.IsCreated()) destination.Create();
+                _targetPointer = destination.GetNativeTexturePtr();
+                _targetCache = destination;
+                _targetWidth = destination.width;
+                _targetHeight = destination.height;
+            }
+
+            // Conversion flags: The destination is written without hardware
+            // sRGB conversion, so an sRGB destination gets the shared texels
+            // as they are when they're gamma-encoded (the common case).
+            var encoded = QualitySettings.activeColorSpace == ColorSpace.Gamma ||
+                GraphicsFormatUtility.IsSRGBFormat(destination.graphicsFormat);
+            var linear = Util.IsLinearFormat(_sharedTextureFormat);
+            var flags = encoded ? (linear ? 2 : 0) : (linear ? 0 : 4);
+
+            // The keyed mutex is handled in the plugin. The event is batched
+            // after the update event of this frame, as it doesn't interleave
+            // with Unity's commands.
+            // The target is only given to the plugin when it's changed, as the
+            // plugin holds a reference to it.
+            if (_targetPointer != _targetGiven || flags != _targetFlags)
+            {
+                PluginEntry.SetTargetTexture(_plugin, _targetPointer, flags);
+                _targetGiven = _targetPointer;
+                _targetFlags = flags;
+            }
+
+            PluginEntry.SetSourceRegion(_plugin, region.x, region.y, region.width, region.height);
+            Util.QueuePluginEvent(PluginEntry.Event.Receive, _plugin);
+        }
+
+        // Fallback path: Blit with the shader.
+        void ReceiveWithBlitShader(RenderTexture destination, RectInt region, bool sync)
+        {
+            // Blit shader lazy initialization
+            if (_blitMaterial == null)
+            {
+                _blitMaterial = new Material(Shader.Find("Hidden/Spout/Blit"));
+                _blitMaterial.hideFlags = HideFlags.DontSave;
+            }
+
+            // Float formats store linear values that need no decoding.
+            var linear = Util.IsLinearFormat(_sharedTextureFormat);
+            _blitMaterial.SetFloat("_LinearSource", linear ? 1 : 0);
+
+            // Source region in UV (the top-left origin)
+            var w = _sharedTexture.width;
+            var h = _sharedTexture.height;
+            _blitMaterial.SetVector("_SourceRect", new Vector4(
+                (float)region.x / w, (float)region.y / h,
+                (float)region.width / w, (float)region.height / h));
+
+            // Keyed mutex sync (only when the sender uses it): The shared
+            // texture is a snapshot that the plugin copies under the lock. It
+            // keeps the last complete frame when the lock times out. The
+            // interop surface (bridge mode) is copied in the same way.
+            // Otherwise the event only records the frame as consumed (for the
+            // latency statistics), so it's batched.
+            if (sync && (PluginEntry.HasKeyedMutex(_plugin) || PluginEntry.HasInteropSurface(_plugin)))
+                Util.IssuePluginEvent(PluginEntry.Event.Snapshot, _plugin);
+            else if (sync)
+                Util.QueuePluginEvent(PluginEntry.Event.Snapshot, _plugin);
+
+            // Blit the shared texture to the destination.
+            Graphics.Blit(_sharedTexture, destination, _blitMaterial, 1);
+        }
+
+        // Direct mode check: The renderer has to sample the texels in the
+        // color space of the project, so gamma-encoded frames need the sRGB
+        // view in linear color space. The keyed mutex can't be held while
+        // the renderer samples the texture.
+        bool CanReceiveDirect()
+        {
+            if (!_directMode || _targetTexture != null || _targetRenderer == null) return false;
+            if (PluginEntry.IsBridgeMode || PluginEntry.HasKeyedMutex(_plugin)) return false;
+            var linear = Util.IsLinearFormat(_sharedTextureFormat);
+            if (QualitySettings.activeColorSpace == ColorSpace.Gamma) return !linear;
+            return linear || PluginEntry.GetSrgbTexturePointer(_plugin) != System.IntPtr.Zero;
+        }
+
+        // Direct mode texture update: The shared texture itself, or its sRGB
+        // view wrapped with another external texture.
+        Texture UpdateDirectTexture()
+        {
+            if (QualitySettings.activeColorSpace == ColorSpace.Gamma ||
+                Util.IsLinearFormat(_sharedTextureFormat)) return _sharedTexture;
+
+            var ptr = PluginEntry.GetSrgbTexturePointer(_plugin);
+
+            if (_srgbTexture != null &&
+                (_srgbTexture.width != _sharedTexture.width ||
+                 _srgbTexture.height != _sharedTexture.height ||
+                 _srgbTexture.format != _sharedTexture.format))
+            {
+                Util.Destroy(_srgbTexture);
+                _srgbTexture = null;
+            }
+
+            if (_srgbTexture == null)
+            {
+                _srgbTexture = Texture2D.CreateExternalTexture(
+                    _sharedTexture.width, _sharedTexture.height,
+                    _sharedTexture.format, false, false, ptr
+                );
+                _srgbTexture.hideFlags = HideFlags.DontSave;
+            }
+            else if (ptr != _srgbTexturePointer)
+            {
+                _srgbTexture.UpdateExternalTexture(ptr);
+            }
+
+            _srgbTexturePointer = ptr;
+            return _srgbTexture;
+        }
+
+        // Destroy the previously allocated receiver texture only when the
+        // specifications have been changed, so that reconnection doesn't
+        // reallocate it.
+        void ValidateReceivedTexture(int width, int height, int format)
+        {
+            if (_receivedTexture == null) return;
+            if (_receivedTexture.width == width &&
+                _receivedTexture.height == height &&
+                Util.IsHighPrecisionFormat(format) ==
+                    (_receivedTexture.format == RenderTextureFormat.ARGBHalf)) return;
+            Util.Destroy(_receivedTexture);
+            _receivedTexture = null;
+        }
+
+        #endregion
+
+        #region Statistics
+
+        // Retrieve the statistics of the plugin object. Returns false when
+        // it's not created yet.
+        public bool GetStats(out SpoutStats stats)
+        {
+            stats = default(SpoutStats);
+            if (_plugin == System.IntPtr.Zero) return false;
+            PluginEntry.GetStats(_plugin, out stats);
+            return true;
+        }
+
         #endregion
 
         #region Internal members
@@ -84,17 +538,30 @@ void OnDisable()
         {
             if (_plugin != System.IntPtr.Zero)
             {
-                Util.IssuePluginEvent(PluginEntry.Event.Dispose, _plugin);
+                DetachReadbackBuffer();
+                Util.QueuePluginEvent(PluginEntry.Event.Dispose, _plugin);
                 _plugin = System.IntPtr.Zero;
             }
 
+            // The direct mode texture is destroyed below.
+            ResetDirectRenderer();
+
             Util.Destroy(_sharedTexture);
+            Util.Destroy(_srgbTexture);
+            _directTexture = null;
+
+            _targetCache = null;
+            _targetPointer = System.IntPtr.Zero;
+            _targetGiven = System.IntPtr.Zero;
         }
 
         void OnDestroy()
         {
             Util.Destroy(_blitMaterial);
             Util.Destroy(_receivedTexture);
+            Util.Destroy(_srgbTexture);
+            if (_readbackHandle.IsAllocated) _readbackHandle.Free();
+            _readbackBuffer = null;
         }
 
         void Update()
@@ -103,7 +570,8 @@ void Update()
             // connection is now invalid.
             if (_plugin != System.IntPtr.Zero && !PluginEntry.CheckValid(_plugin))
             {
-                Util.IssuePluginEvent(PluginEntry.Event.Dispose, _plugin);
+                DetachReadbackBuffer();
+                Util.QueuePluginEvent(PluginEntry.Event.Dispose, _plugin);
                 _plugin = System.IntPtr.Zero;
             }
 
@@ -112,85 +580,126 @@ void Update()
             {
                 _plugin = PluginEntry.CreateReceiver(_sourceName);
                 if (_plugin == System.IntPtr.Zero) return; // Spout may not be ready.
+                AttachReadbackBuffer();
             }
 
-            Util.IssuePluginEvent(PluginEntry.Event.Update, _plugin);
+            Util.QueuePluginEvent(PluginEntry.Event.Update, _plugin);
 
-            // Texture information retrieval
-            var ptr = PluginEntry.GetTexturePointer(_plugin);
-            var width = PluginEntry.GetTextureWidth(_plugin);
-            var height = PluginEntry.GetTextureHeight(_plugin);
+            // CPU readback request (retrieved asynchronously)
+            if (_readbackBuffer != null)
+                Util.QueuePluginEvent(PluginEntry.Event.Readback, _plugin);
 
-            // Resource validity check
-            if (_sharedTexture != null)
+            // Shared texture update
+            // With the interop surface, the bridge mode wraps the local
+            // texture of Unity's device as the shared texture. The texture is
+            // recreated when it's switched, as the surface is only known
+            // after activation.
+            var bridge = PluginEntry.IsBridgeMode && !PluginEntry.HasInteropSurface(_plugin);
+            if (bridge != _bridgeTexture)
             {
-                if (ptr != _sharedTexturePointer ||
-                    width != _sharedTexture.width ||
-                    height != _sharedTexture.height)
-                {
-                    // Not match: Destroy to get refreshed.
-                    Util.Destroy(_sharedTexture);
-                    _sharedTexture = null;
-                }
+                Util.Destroy(_sharedTexture);
+                _sharedTexture = null;
+                _bridgeTexture = bridge;
             }
+            if (!(bridge ? UpdateBridgeTexture() : UpdateSharedTexture())) return;
 
-            // Shared texture lazy (re)initialization
-            if (_sharedTexture == null && ptr != System.IntPtr.Zero)
+            // Texture format conversion
+            RectInt region;
+            _directTexture = null;
+            if (_sharedTexture != null && TryGetSourceRegion(out region))
             {
-                _sharedTexture = Texture2D.CreateExternalTexture(
-                    width, height, TextureFormat.ARGB32, false, false, ptr
-                );
-                _sharedTexture.hideFlags = HideFlags.DontSave;
-                _sharedTexturePointer = ptr;
-
-                // Destroy the previously allocated receiver texture to
-                // refresh specifications.
-                Util.Destroy(_receivedTexture);
-                _receivedTexture = null;
-            }
-
-            // Texture format conversion with the blit shader
-            if (_sharedTexture != null)
-            {
-                // Blit shader lazy initialization
-                if (_blitMaterial == null)
+                if (CanReceiveDirect())
                 {
-                    _blitMaterial = new Material(Shader.Find("Hidden/Spout/Blit"));
-                    _blitMaterial.hideFlags = HideFlags.DontSave;
+                    // Direct mode: Bind the shared texture without conversion.
+                    // The snapshot event records the frame as consumed.
+                    _directTexture = UpdateDirectTexture();
+                    SetRendererTexture(_directTexture, region);
+                    Util.QueuePluginEvent(PluginEntry.Event.Snapshot, _plugin);
+                    return;
                 }
 
-                if (_targetTexture != null)
+                ValidateReceivedTexture(region.width, region.height, _sharedTextureFormat);
+
+                // Receiver texture lazy initialization
+                // It's made UAV-capable for the native conversion.
+                if (_targetTexture == null && _receivedTexture == null)
                 {
-                    // Blit the shared texture to the target texture.
-                    Graphics.Blit(_sharedTexture, _targetTexture, _blitMaterial, 1);
+                    var rtFormat = Util.IsHighPrecisionFormat(_sharedTextureFormat) ?
+                        RenderTextureFormat.ARGBHalf : RenderTextureFormat.Default;
+                    _receivedTexture = new RenderTexture
+                        (region.width, region.height, 0, rtFormat);
+                    _receivedTexture.hideFlags = HideFlags.DontSave;
+                    _receivedTexture.enableRandomWrite = !bridge && PluginEntry.IsNativeReceiveAvailable;
                 }
+
+                var destination = _targetTexture != null ? _targetTexture : _receivedTexture;
+
+                if (!bridge && PluginEntry.IsNativeReceiveAvailable && destination.enableRandomWrite)
+                    ReceiveWithCompute(destination, region);
                 else
-                {
-                    // Receiver texture lazy initialization
-                    if (_receivedTexture == null)
-                    {
-                        _receivedTexture = new RenderTexture
-                            (_sharedTexture.width, _sharedTexture.height, 0);
-                        _receivedTexture.hideFlags = HideFlags.DontSave;
-                    }
-
-                    // Blit the shared texture to the receiver texture.
-                    Graphics.Blit(_sharedTexture, _receivedTexture, _blitMaterial, 1);
-                }
+                    ReceiveWithBlitShader(destination, region, !bridge);
             }
 
             // Renderer override
             if (_targetRenderer != null && receivedTexture != null)
-            {
-                // Material property block lazy initialization
-                if (_propertyBlock == null)
-                    _propertyBlock = new MaterialPropertyBlock();
+                SetRendererTexture(receivedTexture, null);
+        }
+
+        // Set the texture to the target renderer with the material property
+        // block. In the direct mode (with the region given), it also sets the
+        // scale/offset to flip the texture vertically and crop the region.
+        // It's restored from the material when leaving the direct mode.
+        void SetRendererTexture(Texture texture, RectInt? region)
+        {
+            // Leave the direct mode (also on the previous target renderer).
+            if (region == null || _directRenderer != _targetRenderer ||
+                _directProperty != _targetMaterialProperty)
+                ResetDirectRenderer();
+
+            // Material property block lazy initialization
+            if (_propertyBlock == null)
+                _propertyBlock = new MaterialPropertyBlock();
+
+            // Read-modify-write
+            _targetRenderer.GetPropertyBlock(_propertyBlock);
+            _propertyBlock.SetTexture(_targetMaterialProperty, texture);
 
-                // Read-modify-write
-                _targetRenderer.GetPropertyBlock(_propertyBlock);
-                _propertyBlock.SetTexture(_targetMaterialProperty, receivedTexture);
-                _targetRenderer.SetPropertyBlock(_propertyBlock);
+            if (region != null)
+            {
+                var r = region.Value;
+                var w = (float)texture.width;
+                var h = (float)texture.height;
+                _propertyBlock.SetVector(_targetMaterialProperty + "_ST", new Vector4(
+                    r.width / w, -r.height / h, r.x / w, (r.y + r.height) / h));
+                _directRenderer = _targetRenderer;
+                _directProperty = _targetMaterialProperty;
             }
+
+            _targetRenderer.SetPropertyBlock(_propertyBlock);
+        }
+
+        // Restore the texture and the scale/offset of the renderer in the
+        // direct mode from its material. The texture is replaced too, as the
+        // direct mode one is destroyed with the connection.
+        void ResetDirectRenderer()
+        {
+            // The renderer may have been destroyed.
+            var renderer = _directRenderer;
+            _directRenderer = null;
+            if (renderer == null) return;
+
+            var stName = _directProperty + "_ST";
+            var material = renderer.sharedMaterial;
+            var hasTexture = material != null && material.HasProperty(_directProperty);
+
+            var texture = hasTexture ? material.GetTexture(_directProperty) : null;
+            var st = material != null && material.HasProperty(stName) ?
+                material.GetVector(stName) : new Vector4(1, 1, 0, 0);
+
+            renderer.GetPropertyBlock(_propertyBlock);
+            _propertyBlock.SetTexture(_directProperty, texture != null ? texture : Texture2D.blackTexture);
+            _propertyBlock.SetVector(stName, st);
+            renderer.SetPropertyBlock(_propertyBlock);
         }
 
         #if UNITY_EDITOR
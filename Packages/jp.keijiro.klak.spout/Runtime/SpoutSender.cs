@@ -2,9 +2,19 @@
 // https://github.com/keijiro/KlakSpout
 
 using UnityEngine;
+using UnityEngine.Rendering;
 
 namespace Klak.Spout
 {
+    // Shared texture formats
+    public enum SpoutFormat { RGBA32, BGRA32, RGBAHalf, RGB10A2 }
+
+    // Sender update policies
+    // EveryFrame: Send every frame.
+    // OnDemand: Send only when requested with SpoutSender.Publish.
+    // MaxRate: Send every frame but not more often than the given rate.
+    public enum SpoutUpdateMode { EveryFrame, OnDemand, MaxRate }
+
     [ExecuteInEditMode]
     [AddComponentMenu("Klak/Spout/Spout Sender")]
     public sealed class SpoutSender : MonoBehaviour
@@ -22,6 +32,17 @@ public sealed class SpoutSender : MonoBehaviour
 
         #region Format options
 
+        [SerializeField] SpoutFormat _format;
+
+        public SpoutFormat format {
+            get { return _format; }
+            set {
+                if (_format == value) return;
+                _format = value;
+                RequestReconnect();
+            }
+        }
+
         [SerializeField] bool _alphaSupport;
 
         public bool alphaSupport {
@@ -31,59 +52,417 @@ public sealed class SpoutSender : MonoBehaviour
 
         #endregion
 
+        #region Synchronization options
+
+        [SerializeField] bool _keyedMutex;
+
+        public bool keyedMutex {
+            get { return _keyedMutex; }
+            set {
+                if (_keyedMutex == value) return;
+                _keyedMutex = value;
+                RequestReconnect();
+            }
+        }
+
+        [SerializeField, Range(1, 3)] int _bufferCount = 1;
+
+        public int bufferCount {
+            get { return _bufferCount; }
+            set {
+                value = Mathf.Clamp(value, 1, 3);
+                if (_bufferCount == value) return;
+                _bufferCount = value;
+                RequestReconnect();
+            }
+        }
+
+        // Interval (in frames) of the copies into the main shared texture
+        // with multiple buffers. Zero stops them, which is only fine when all
+        // the receivers are Spout Receiver components.
+        [SerializeField, Range(0, 8)] int _mirrorInterval = 1;
+
+        public int mirrorInterval {
+            get { return _mirrorInterval; }
+            set { _mirrorInterval = Mathf.Clamp(value, 0, 8); }
+        }
+
+        #endregion
+
+        #region Update options
+
+        [SerializeField] SpoutUpdateMode _updateMode;
+
+        public SpoutUpdateMode updateMode {
+            get { return _updateMode; }
+            set { _updateMode = value; }
+        }
+
+        // Frames per second in the MaxRate mode
+        [SerializeField] float _maxRate = 30;
+
+        public float maxRate {
+            get { return _maxRate; }
+            set { _maxRate = Mathf.Max(value, 0.01f); }
+        }
+
+        // Request sending the current frame of the source. It's needed in the
+        // OnDemand mode; the other modes ignore it. The frame is sent in the
+        // next update (render texture mode) or rendering (camera capture).
+        public void Publish()
+        {
+            _publishRequested = true;
+        }
+
+        #endregion
+
+        #region Diagnostic options
+
+        // Embed the copy time of each frame in the sender info, so that
+        // receivers can measure the latency (see SpoutStats).
+        [SerializeField] bool _frameTimestamps;
+
+        public bool frameTimestamps {
+            get { return _frameTimestamps; }
+            set { _frameTimestamps = value; }
+        }
+
+        #endregion
+
         #region Private members
 
         System.IntPtr _plugin;
-        Texture2D _sharedTexture;
         Material _blitMaterial;
 
-        void SendRenderTexture(RenderTexture source)
+        // Intermediate render texture used in the fallback and interop paths
+        RenderTexture _copyTexture;
+        System.IntPtr _copyPointer;
+
+        // Native texture pointer cache
+        // GetNativeTexturePtr may stall the main thread, so we only call it
+        // when the source texture has been changed (or released/recreated).
+        RenderTexture _sourceCache;
+        System.IntPtr _sourcePointer;
+        int _sourceWidth, _sourceHeight;
+        bool _sourceCreated;
+
+        // Source texture, flags, timestamp mode and mirror interval given to
+        // the plugin
+        System.IntPtr _sourceGiven;
+        int _sourceFlags;
+        bool _timestampsGiven;
+        int _mirrorGiven;
+
+        // Pixel buffer used in the bridge mode
+        byte[] _uploadBuffer;
+
+        // Update policy state
+        bool _publishRequested;
+        float _nextSendTime;
+
+        // Apply the update policy. Idle senders skip the blit/copy entirely,
+        // and receivers see no new frame as the plugin only counts the frames
+        // that are actually copied. A new connection always gets a frame:
+        // The plugin drops the frames sent before the activation (the shared
+        // texture isn't published yet), so every frame is sent until then,
+        // and the publish request is kept pending.
+        bool CheckUpdatePolicy()
+        {
+            if (_plugin == System.IntPtr.Zero ||
+                PluginEntry.GetTexturePointer(_plugin) == System.IntPtr.Zero) return true;
+
+            switch (_updateMode)
+            {
+                case SpoutUpdateMode.OnDemand:
+                    if (!_publishRequested) return false;
+                    _publishRequested = false;
+                    return true;
+
+                case SpoutUpdateMode.MaxRate:
+                    var time = Time.realtimeSinceStartup;
+                    if (time < _nextSendTime) return false;
+                    // Keep the pace without accumulating delays.
+                    var interval = 1 / Mathf.Max(_maxRate, 0.01f);
+                    _nextSendTime = Mathf.Max(_nextSendTime + interval, time);
+                    return true;
+
+                default:
+                    return true;
+            }
+        }
+
+        // The deferred flag is set in the render texture mode, where the
+        // source isn't a temporary texture that is only valid in the current
+        // callback. The native send is queued with the other events then.
+        void SendRenderTexture(RenderTexture source, bool deferred)
         {
             // Plugin lazy initialization
             if (_plugin == System.IntPtr.Zero)
             {
-                _plugin = PluginEntry.CreateSender(name, source.width, source.height);
+                // The fallback path only supports RGBA32 as it copies an
+                // ARGB32 render texture into the shared texture. The bridge
+                // path supports the formats that can be read back to the CPU.
+                // Neither of them supports the ring buffers.
+                var native = PluginEntry.IsNativeSendAvailable;
+                var bridge = PluginEntry.IsBridgeMode;
+                var format = native ? _format :
+                    (bridge && _format != SpoutFormat.RGB10A2 ? _format : SpoutFormat.RGBA32);
+                _plugin = PluginEntry.CreateSender(
+                    name, source.width, source.height,
+                    Util.ToDxgiFormat(format), _keyedMutex,
+                    native ? _bufferCount : 1
+                );
                 if (_plugin == System.IntPtr.Zero) return; // Spout may not be ready.
+                _timestampsGiven = false;
+                _mirrorGiven = 1;
+            }
+
+            if (_frameTimestamps != _timestampsGiven)
+            {
+                PluginEntry.SetTimestampMode(_plugin, _frameTimestamps);
+                _timestampsGiven = _frameTimestamps;
+            }
+
+            if (_mirrorInterval != _mirrorGiven)
+            {
+                PluginEntry.SetMirrorInterval(_plugin, _mirrorInterval);
+                _mirrorGiven = _mirrorInterval;
+            }
+
+            if (PluginEntry.IsNativeSendAvailable)
+                SendWithNativeBlit(source, deferred);
+            else if (PluginEntry.IsBridgeMode && PluginEntry.HasInteropSurface(_plugin))
+                SendWithInterop(source);
+            else if (PluginEntry.IsBridgeMode)
+                SendWithReadback(source);
+            else
+                SendWithBlitShader(source);
+        }
+
+        // Intermediate render texture (re)allocation
+        // It's kept (rather than a temporary one), as the plugin reads it
+        // later on the render thread.
+        void UpdateCopyTexture(int width, int height, RenderTextureFormat format)
+        {
+            if (_copyTexture != null &&
+                (_copyTexture.width != width || _copyTexture.height != height ||
+                 _copyTexture.format != format || !_copyTexture.IsCreated()))
+            {
+                Util.Destroy(_copyTexture);
+                _copyTexture = null;
+            }
+
+            if (_copyTexture == null)
+            {
+                _copyTexture = new RenderTexture(width, height, 0, format);
+                _copyTexture.hideFlags = HideFlags.DontSave;
+                _copyTexture.Create();
+                _copyPointer = _copyTexture.GetNativeTexturePtr();
             }
+        }
 
-            // Shared texture lazy initialization
-            if (_sharedTexture == null)
+        // Zero-copy path: The plugin draws the source texture directly into
+        // the shared texture on the render thread.
+        void SendWithNativeBlit(RenderTexture source, bool deferred)
+        {
+            // Source texture pointer update
+            // A released render texture has no native texture, and it gets a
+            // new one when it's created again.
+            var created = source.IsCreated();
+            if (_sourcePointer == System.IntPtr.Zero ||
+                source != _sourceCache ||
+                source.width != _sourceWidth ||
+                source.height != _sourceHeight ||
+                created != _sourceCreated)
             {
-                var ptr = PluginEntry.GetTexturePointer(_plugin);
-                if (ptr != System.IntPtr.Zero)
-                {
-                    _sharedTexture = Texture2D.CreateExternalTexture(
-                        PluginEntry.GetTextureWidth(_plugin),
-                        PluginEntry.GetTextureHeight(_plugin),
-                        TextureFormat.ARGB32, false, false, ptr
-                    );
-                    _sharedTexture.hideFlags = HideFlags.DontSave;
-                }
+                _sourcePointer = created ? source.GetNativeTexturePtr() : System.IntPtr.Zero;
+                _sourceCache = source;
+                _sourceWidth = source.width;
+                _sourceHeight = source.height;
+                _sourceCreated = created;
             }
 
-            // Shared texture update
-            if (_sharedTexture != null)
+            // Conversion flags: The source texels are read without hardware
+            // sRGB conversion, so we have to encode them in sRGB when they're
+            // given in linear, or decode them when the shared texture stores
+            // linear values (float formats) and they're given in sRGB.
+            var flags = _alphaSupport ? 0 : 1;
+            var linearSource = QualitySettings.activeColorSpace == ColorSpace.Linear && !source.sRGB;
+            if (Util.IsLinearFormat(PluginEntry.GetTextureFormat(_plugin)))
+            {
+                if (!linearSource) flags |= 4;
+            }
+            else
             {
-                // Blit shader lazy initialization
-                if (_blitMaterial == null)
-                {
-                    _blitMaterial = new Material(Shader.Find("Hidden/Spout/Blit"));
-                    _blitMaterial.hideFlags = HideFlags.DontSave;
-                }
+                if (linearSource) flags |= 2;
+            }
 
-                // Blit shader parameters
-                _blitMaterial.SetFloat("_ClearAlpha", _alphaSupport ? 0 : 1);
+            // The source is only given to the plugin when it's changed.
+            if (_sourcePointer != _sourceGiven || flags != _sourceFlags)
+            {
+                PluginEntry.SetSourceTexture(_plugin, _sourcePointer, flags);
+                _sourceGiven = _sourcePointer;
+                _sourceFlags = flags;
+            }
 
-                // We can't directly blit to the shared texture (as it lacks
-                // render buffer functionality), so we temporarily allocate a
-                // render texture as a middleman, blit the source to it, then
-                // copy it to the shared texture using the CopyTexture API.
-                var tempRT = RenderTexture.GetTemporary
-                    (_sharedTexture.width, _sharedTexture.height);
-                Graphics.Blit(source, tempRT, _blitMaterial, 0);
-                Graphics.CopyTexture(tempRT, _sharedTexture);
-                RenderTexture.ReleaseTemporary(tempRT);
+            if (deferred)
+                Util.QueuePluginEvent(PluginEntry.Event.Send, _plugin);
+            else
+                Util.IssuePluginEvent(PluginEntry.Event.Send, _plugin);
+        }
+
+        // Fallback path: Blit with the shader and copy via an intermediate
+        // render texture. Used when the native blitter is unavailable.
+        void SendWithBlitShader(RenderTexture source)
+        {
+            if (PluginEntry.GetTexturePointer(_plugin) == System.IntPtr.Zero) return;
+
+            var width = PluginEntry.GetTextureWidth(_plugin);
+            var height = PluginEntry.GetTextureHeight(_plugin);
+
+            // We can't directly blit to the shared texture (as it lacks
+            // render buffer functionality), so we blit the source to a
+            // render texture as a middleman, then let the plugin copy it to
+            // the shared texture. The plugin does the copy under the keyed
+            // mutex and drops the frame on timeout.
+            UpdateCopyTexture(width, height, RenderTextureFormat.ARGB32);
+
+            // Blit shader lazy initialization
+            if (_blitMaterial == null)
+            {
+                _blitMaterial = new Material(Shader.Find("Hidden/Spout/Blit"));
+                _blitMaterial.hideFlags = HideFlags.DontSave;
             }
+
+            // Blit shader parameters
+            _blitMaterial.SetFloat("_ClearAlpha", _alphaSupport ? 0 : 1);
+
+            Graphics.Blit(source, _copyTexture, _blitMaterial, 0);
+
+            // The middleman is only given to the plugin when it's changed.
+            if (_copyPointer != _sourceGiven)
+            {
+                PluginEntry.SetSourceTexture(_plugin, _copyPointer, 0);
+                _sourceGiven = _copyPointer;
+            }
+
+            // Copy and notify receivers of the new frame.
+            Util.IssuePluginEvent(PluginEntry.Event.SendCopy, _plugin);
+        }
+
+        // Interop path: Blit with the shader into a render texture with the
+        // layout of the shared texture, then let the plugin copy it into the
+        // shared texture via the interop surface on the GPU (bridge mode).
+        // The event is issued immediately, as the plugin reads the render
+        // texture on the render thread.
+        void SendWithInterop(RenderTexture source)
+        {
+            var width = PluginEntry.GetTextureWidth(_plugin);
+            var height = PluginEntry.GetTextureHeight(_plugin);
+            var format = PluginEntry.GetTextureFormat(_plugin);
+
+            RenderTextureFormat rtFormat;
+            if (PluginEntry.GetTexturePointer(_plugin) == System.IntPtr.Zero ||
+                !Util.TryGetInteropTextureFormat(format, out rtFormat)) return;
+
+            UpdateCopyTexture(width, height, rtFormat);
+
+            // Blit shader lazy initialization
+            if (_blitMaterial == null)
+            {
+                _blitMaterial = new Material(Shader.Find("Hidden/Spout/Blit"));
+                _blitMaterial.hideFlags = HideFlags.DontSave;
+            }
+
+            _blitMaterial.SetFloat("_ClearAlpha", _alphaSupport ? 0 : 1);
+
+            Graphics.Blit(source, _copyTexture, _blitMaterial, 0);
+
+            // The render texture is only given to the plugin when it's changed.
+            if (_copyPointer != _sourceGiven)
+            {
+                PluginEntry.SetInteropSource(_plugin, _copyPointer);
+                _sourceGiven = _copyPointer;
+            }
+
+            Util.IssuePluginEvent(PluginEntry.Event.SendCopy, _plugin);
+        }
+
+        // Bridge path: Blit with the shader, read it back to the CPU
+        // asynchronously, then let the plugin upload it into the shared
+        // texture. Used when the plugin can't share textures with Unity, even
+        // via the interop surface.
+        void SendWithReadback(RenderTexture source)
+        {
+            var width = PluginEntry.GetTextureWidth(_plugin);
+            var height = PluginEntry.GetTextureHeight(_plugin);
+            var format = PluginEntry.GetTextureFormat(_plugin);
+
+            TextureFormat readFormat;
+            if (PluginEntry.GetTexturePointer(_plugin) == System.IntPtr.Zero ||
+                !Util.TryGetRawTextureFormat(format, out readFormat)) return;
+
+            // Blit shader lazy initialization
+            if (_blitMaterial == null)
+            {
+                _blitMaterial = new Material(Shader.Find("Hidden/Spout/Blit"));
+                _blitMaterial.hideFlags = HideFlags.DontSave;
+            }
+
+            _blitMaterial.SetFloat("_ClearAlpha", _alphaSupport ? 0 : 1);
+
+            // The intermediate render texture has the same memory layout as
+            // the one used in the fallback path, so the pixels can be copied
+            // as they are.
+            var rtFormat = Util.IsLinearFormat(format) ?
+                RenderTextureFormat.ARGBHalf : RenderTextureFormat.ARGB32;
+            var tempRT = RenderTexture.GetTemporary(width, height, 0, rtFormat);
+            Graphics.Blit(source, tempRT, _blitMaterial, 0);
+
+            var plugin = _plugin;
+            AsyncGPUReadback.Request(tempRT, 0, readFormat,
+                                     request => OnReadback(request, plugin));
+
+            RenderTexture.ReleaseTemporary(tempRT);
+        }
+
+        void OnReadback(AsyncGPUReadbackRequest request, System.IntPtr plugin)
+        {
+            // Discard the frames requested before reconnection.
+            if (request.hasError || plugin != _plugin) return;
+
+            var data = request.GetData<byte>();
+            if (_uploadBuffer == null || _uploadBuffer.Length != data.Length)
+                _uploadBuffer = new byte[data.Length];
+            data.CopyTo(_uploadBuffer);
+
+            PluginEntry.UploadSourcePixels(_plugin, _uploadBuffer, _uploadBuffer.Length);
+
+            // The pixels are uploaded in the present event.
+            Util.IssuePluginEvent(PluginEntry.Event.Present, _plugin);
+        }
+
+        #endregion
+
+        #region Statistics
+
+        // Retrieve the statistics of the plugin object. Returns false when
+        // it's not created yet.
+        public bool GetStats(out SpoutStats stats)
+        {
+            stats = default(SpoutStats);
+            if (_plugin == System.IntPtr.Zero) return false;
+            PluginEntry.GetStats(_plugin, out stats);
+            return true;
+        }
+
+        #endregion
+
+        #region Internal members
+
+        internal void RequestReconnect()
+        {
+            OnDisable();
         }
 
         #endregion
@@ -94,11 +473,17 @@ void OnDisable()
         {
             if (_plugin != System.IntPtr.Zero)
             {
-                Util.IssuePluginEvent(PluginEntry.Event.Dispose, _plugin);
+                Util.QueuePluginEvent(PluginEntry.Event.Dispose, _plugin);
                 _plugin = System.IntPtr.Zero;
             }
 
-            Util.Destroy(_sharedTexture);
+            Util.Destroy(_copyTexture);
+            _copyTexture = null;
+
+            _sourceCache = null;
+            _sourcePointer = System.IntPtr.Zero;
+            _sourceGiven = System.IntPtr.Zero;
+            _nextSendTime = 0;
         }
 
         void OnDestroy()
@@ -110,17 +495,17 @@ void Update()
         {
             // Update the plugin internal state.
             if (_plugin != System.IntPtr.Zero)
-                Util.IssuePluginEvent(PluginEntry.Event.Update, _plugin);
+                Util.QueuePluginEvent(PluginEntry.Event.Update, _plugin);
 
             // Render texture mode update
-            if (GetComponent<Camera>() == null && _sourceTexture != null)
-                SendRenderTexture(_sourceTexture);
+            if (GetComponent<Camera>() == null && _sourceTexture != null && CheckUpdatePolicy())
+                SendRenderTexture(_sourceTexture, true);
         }
 
         void OnRenderImage(RenderTexture source, RenderTexture destination)
         {
             // Camera capture mode update
-            SendRenderTexture(source);
+            if (CheckUpdatePolicy()) SendRenderTexture(source, false);
 
             // Thru blit
             Graphics.Blit(source, destination);
@@ -1,7 +1,12 @@
 #include "KlakSpoutSharedObject.h"
+#include "KlakSpoutCommandQueue.h"
+#include "KlakSpoutDisposer.h"
+#include "KlakSpoutInteropD3D12.h"
+#include "KlakSpoutInteropVulkan.h"
 #include "Unity/IUnityGraphics.h"
 #include "Unity/IUnityGraphicsD3D11.h"
-#include <mutex>
+#include <cstring>
+#include <vector>
 
 namespace
 {
@@ -9,22 +14,167 @@ namespace
     IUnityInterfaces* unity_;
 
     // Temporary storage for shared Spout object list
-    std::set<std::string> shared_object_names_;
+    std::vector<std::string> shared_object_names_;
 
-    // Local mutex object used to prevent race conditions between the main
-    // thread and the render thread. This should be locked at the following
-    // points:
-    // - OnRenderEvent (this is the only point called from the render thread)
-    // - Plugin function that calls SharedObject or Spout API functions.
-    std::mutex lock_;
+    // Sender name list accessor used for scanning on the main thread
+    // It's separated from the render thread one to avoid sharing its state.
+    std::unique_ptr<spoutSenderNames> scanner_;
+
+    spoutSenderNames* GetScanner()
+    {
+        auto& g = klakspout::Globals::get();
+        if (!g.isReady()) return nullptr;
+
+        // Lazy initialization
+        if (!scanner_)
+        {
+            scanner_ = std::make_unique<spoutSenderNames>();
+            scanner_->SetMaxSenders(g.sender_names_->GetMaxSenders());
+        }
+
+        return scanner_.get();
+    }
+
+    // Blitter used in the native send
+    std::unique_ptr<klakspout::Blitter> blitter_;
+
+    // Command queue used for sending batched render events from the main
+    // thread. There is no lock between the main thread and the render
+    // thread: SharedObjects are only modified on the render thread, and the
+    // main thread reads their published state.
+    klakspout::CommandQueue queue_;
+
+    // Deferred disposal of the objects
+    // The number of the objects destroyed at the end of a frame is limited
+    // to keep the render thread time flat.
+    klakspout::Disposer disposer_;
+    constexpr size_t disposals_per_frame_ = 4;
+
+    // Global object initialization with a D3D11 device
+    void InitializeGlobals(ID3D11Device* device, bool bridge)
+    {
+        auto& g = klakspout::Globals::get();
+
+        g.d3d11_ = device;
+        g.bridge_ = bridge;
+
+        // Adapter of the device, published in the sender info
+        g.adapter_luid_ = {};
+        g.spout_->GetDeviceAdapterLuid(g.d3d11_, g.adapter_luid_);
+
+        g.sender_names_ = std::make_unique<spoutSenderNames>();
+
+        // Apply the max sender registry value.
+        DWORD max_senders;
+        if (g.spout_->ReadDwordFromRegistry(&max_senders, "Software\\Leading Edge\\Spout", "MaxSenders"))
+            g.sender_names_->SetMaxSenders(max_senders);
+
+        // Pending objects look up their names whenever the sender list
+        // changes, so use the versioned directory to make it cheap.
+        g.sender_names_->SetVersionedDirectory(true);
+
+        // Start watching the sender list for pending objects.
+        g.discovery_ = std::make_unique<klakspout::DiscoveryWatcher>(g.sender_names_->GetMaxSenders());
+
+        // Texture pool initialization
+        g.texture_pool_ = std::make_unique<klakspout::TexturePool>(g.d3d11_, *g.spout_);
+
+        // The native blitter draws Unity's textures, so it's only available
+        // with Unity's own device.
+        if (!bridge) blitter_ = std::make_unique<klakspout::Blitter>(g.d3d11_);
+    }
+
+    // Global object finalization
+    void FinalizeGlobals()
+    {
+        auto& g = klakspout::Globals::get();
+
+        // Destroy the objects waiting for disposal.
+        disposer_.collectAll();
+
+        // Finalize the blitter and release the pooled textures.
+        blitter_.reset();
+        g.texture_pool_.reset();
+
+        // Stop the discovery watcher.
+        g.discovery_.reset();
+
+        // Release the interop objects on Unity's device.
+        g.interop_.reset();
+
+        // Release our own device in the bridge mode.
+        if (g.bridge_ && g.d3d11_) g.d3d11_->Release();
+
+        // Invalidate the D3D11 interface.
+        g.d3d11_ = nullptr;
+        g.bridge_ = false;
+
+        // Finalize the Spout globals.
+        g.spout_.reset();
+        g.sender_names_.reset();
+    }
+
+    // Interop backend initialization (bridge mode)
+    // Returns null when the renderer doesn't support it. Our device is
+    // created on the adapter of Unity's device then, as the shared handles
+    // can't be opened on another adapter.
+    std::unique_ptr<klakspout::Interop> CreateInterop(UnityGfxRenderer renderer)
+    {
+        auto& g = klakspout::Globals::get();
+
+        if (renderer == kUnityGfxRendererD3D12)
+        {
+            auto d3d12 = unity_->Get<IUnityGraphicsD3D12v6>();
+            if (!d3d12 || !d3d12->GetDevice()) return nullptr;
+
+            auto luid = d3d12->GetDevice()->GetAdapterLuid();
+            g.spout_->SetAdapter(g.spout_->FindAdapter(luid));
+
+            // The send copy and snapshot events access Unity's queue.
+            auto interop = std::make_unique<klakspout::InteropD3D12>(d3d12);
+            interop->configureEvent(10);
+            interop->configureEvent(11);
+            return interop;
+        }
+
+        if (renderer == kUnityGfxRendererVulkan)
+        {
+            auto vulkan = unity_->Get<IUnityGraphicsVulkan>();
+            if (!vulkan) return nullptr;
+
+            // Null when the device extensions haven't been enabled.
+            auto interop = klakspout::InteropVulkan::create(vulkan);
+            if (!interop) return nullptr;
+
+            LUID luid;
+            if (interop->getAdapterLuid(luid))
+                g.spout_->SetAdapter(g.spout_->FindAdapter(luid));
+
+            interop->configureEvent(10);
+            interop->configureEvent(11);
+            return interop;
+        }
+
+        return nullptr;
+    }
 
     // Unity device event callback
     void UNITY_INTERFACE_API OnGraphicsDeviceEvent(UnityGfxDeviceEventType event_type)
     {
         assert(unity_);
 
-        // Do nothing if it's not the D3D11 renderer.
-        if (unity_->Get<IUnityGraphics>()->GetRenderer() != kUnityGfxRendererD3D11) return;
+        // Bridge mode: With the D3D12 and Vulkan renderers, we create our
+        // own D3D11 device for Spout, as Unity's device can't open Spout's
+        // shared handles (they're not NT handles). The frames are exchanged
+        // with Unity's device via the interop surfaces (NT handles), or via
+        // the CPU when the interop is unavailable. Both renderers use the
+        // D3D-style texture layout (the top row first), so the same
+        // readback/upload path works for them.
+        auto renderer = unity_->Get<IUnityGraphics>()->GetRenderer();
+        auto bridge = renderer == kUnityGfxRendererD3D12 || renderer == kUnityGfxRendererVulkan;
+
+        // Do nothing if it's not a supported renderer.
+        if (renderer != kUnityGfxRendererD3D11 && !bridge) return;
 
         DEBUG_LOG("OnGraphicsDeviceEvent (%d)", event_type);
 
@@ -32,49 +182,125 @@ namespace
 
         if (event_type == kUnityGfxDeviceEventInitialize)
         {
-            // Retrieve the D3D11 interface.
-            g.d3d11_ = unity_->Get<IUnityGraphicsD3D11>()->GetDevice();
-
-            // Initialize the Spout global objects.
             g.spout_ = std::make_unique<spoutDirectX>();
-            g.sender_names_ = std::make_unique<spoutSenderNames>();
 
-            // Apply the max sender registry value.
-            DWORD max_senders;
-            if (g.spout_->ReadDwordFromRegistry(&max_senders, "Software\\Leading Edge\\Spout", "MaxSenders"))
-                g.sender_names_->SetMaxSenders(max_senders);
+            // Retrieve the D3D11 interface, or create our own one.
+            if (bridge) g.interop_ = CreateInterop(renderer);
+            auto device = bridge ?
+                g.spout_->CreateDX11device() : unity_->Get<IUnityGraphicsD3D11>()->GetDevice();
+
+            if (!device)
+            {
+                DEBUG_LOG("D3D11 device unavailable (%d)", renderer);
+                g.interop_.reset();
+                g.spout_.reset();
+                return;
+            }
+
+            InitializeGlobals(device, bridge);
         }
         else if (event_type == kUnityGfxDeviceEventShutdown)
         {
-            // Invalidate the D3D11 interface.
-            g.d3d11_ = nullptr;
-
-            // Finalize the Spout globals.
-            g.spout_.reset();
-            g.sender_names_.reset();
+            FinalizeGlobals();
         }
     }
 
-    // Unity render event callbacks
-    void UNITY_INTERFACE_API OnRenderEvent(int event_id, void* data)
+    // Render event handler
+    void ProcessRenderEvent(int event_id, void* data)
     {
-        // Do nothing if the D3D11 interface is not available. This only
-        // happens on Editor. It may leak some resoruces but we can't do
-        // anything about them.
-        if (!klakspout::Globals::get().isReady()) return;
+        auto* pobj = reinterpret_cast<klakspout::SharedObject*>(data);
 
-        std::lock_guard<std::mutex> guard(lock_);
+        // Dispose event: Consecutive disposals are coalesced, and the names
+        // are released before processing anything else.
+        if (event_id == 1)
+        {
+            disposer_.defer(pobj);
+            return;
+        }
 
-        auto* pobj = reinterpret_cast<klakspout::SharedObject*>(data);
+        disposer_.releaseNames();
 
         if (event_id == 0) // Update event
         {
-            if (!pobj->isActive()) pobj->activate();
+            pobj->update();
+            disposer_.collectIdle(disposals_per_frame_);
+        }
+        else if (event_id == 2) // Present event
+        {
+            pobj->present();
+        }
+        else if (event_id == 3) // Lock event
+        {
+            pobj->lock();
         }
-        else if (event_id == 1) // Dispose event
+        else if (event_id == 4) // Unlock event
         {
-            delete pobj;
+            pobj->unlock();
         }
+        else if (event_id == 5) // Send event
+        {
+            ID3D11DeviceContext* context;
+            klakspout::Globals::get().d3d11_->GetImmediateContext(&context);
+            pobj->send(context, *blitter_);
+            context->Release();
+        }
+        else if (event_id == 6) // Flush event
+        {
+            // The data is the queue position at the time of issue.
+            auto end = static_cast<std::uint32_t>(reinterpret_cast<std::uintptr_t>(data));
+            queue_.drain(end, ProcessRenderEvent);
+
+            // This is the end of the frame's events.
+            disposer_.collect(disposals_per_frame_);
+            auto& g = klakspout::Globals::get();
+            if (g.interop_) g.interop_->collect();
+        }
+        else if (event_id == 7) // Readback event
+        {
+            ID3D11DeviceContext* context;
+            klakspout::Globals::get().d3d11_->GetImmediateContext(&context);
+            pobj->readback(context);
+            context->Release();
+        }
+        else if (event_id == 8) // Receive event
+        {
+            ID3D11DeviceContext* context;
+            klakspout::Globals::get().d3d11_->GetImmediateContext(&context);
+            pobj->receive(context, *blitter_);
+            context->Release();
+        }
+        else if (event_id == 9) // Send atlas event
+        {
+            ID3D11DeviceContext* context;
+            klakspout::Globals::get().d3d11_->GetImmediateContext(&context);
+            pobj->sendAtlas(context, *blitter_);
+            context->Release();
+        }
+        else if (event_id == 10) // Snapshot event
+        {
+            ID3D11DeviceContext* context;
+            klakspout::Globals::get().d3d11_->GetImmediateContext(&context);
+            pobj->takeSnapshot(context);
+            context->Release();
+        }
+        else if (event_id == 11) // Send copy event
+        {
+            ID3D11DeviceContext* context;
+            klakspout::Globals::get().d3d11_->GetImmediateContext(&context);
+            pobj->sendCopy(context);
+            context->Release();
+        }
+    }
+
+    // Unity render event callbacks
+    void UNITY_INTERFACE_API OnRenderEvent(int event_id, void* data)
+    {
+        // Do nothing if the D3D11 interface is not available. This only
+        // happens on Editor. It may leak some resoruces but we can't do
+        // anything about them.
+        if (!klakspout::Globals::get().isReady()) return;
+
+        ProcessRenderEvent(event_id, data);
     }
 }
 
@@ -93,6 +319,12 @@ extern "C" void UNITY_INTERFACE_EXPORT UNITY_INTERFACE_API UnityPluginLoad(IUnit
     freopen_s(&pConsole, "CONOUT$", "wb", stdout);
     #endif
 
+    // Enable the interop extensions on the Vulkan device. It only works when
+    // the plugin is loaded before the device creation (preloaded).
+    auto vulkan = unity_->Get<IUnityGraphicsVulkan>();
+    if (vulkan && !klakspout::InteropVulkan::interceptInitialization(vulkan))
+        DEBUG_LOG("Vulkan initialization hook unavailable (%d)", 0);
+
     // Register the custom callback, then manually invoke the initialization event once.
     unity_->Get<IUnityGraphics>()->RegisterDeviceEventCallback(OnGraphicsDeviceEvent);
     OnGraphicsDeviceEvent(kUnityGfxDeviceEventInitialize);
@@ -115,10 +347,23 @@ extern "C" UnityRenderingEventAndData UNITY_INTERFACE_EXPORT GetRenderEventFunc(
 // Native plugin implementation
 //
 
-extern "C" void UNITY_INTERFACE_EXPORT * CreateSender(const char* name, int width, int height)
+extern "C" void UNITY_INTERFACE_EXPORT * CreateSender(const char* name, int width, int height, int format, int keyed_mutex, int buffer_count)
 {
     if (!klakspout::Globals::get().isReady()) return nullptr;
-    return new klakspout::SharedObject(klakspout::SharedObject::Type::sender, name != nullptr ? name : "", width, height);
+    return new klakspout::SharedObject(
+        klakspout::SharedObject::Type::sender, name != nullptr ? name : "",
+        width, height, static_cast<DXGI_FORMAT>(format), keyed_mutex != 0, buffer_count
+    );
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT * CreateAtlasSender(const char* name, int width, int height, int format, int keyed_mutex)
+{
+    // Atlas senders are drawn with the native blitter only.
+    if (!klakspout::Globals::get().isReady() || !blitter_ || !blitter_->isAvailable()) return nullptr;
+    return new klakspout::SharedObject(
+        klakspout::SharedObject::Type::sender, name != nullptr ? name : "",
+        width, height, static_cast<DXGI_FORMAT>(format), keyed_mutex != 0, 1, true
+    );
 }
 
 extern "C" void UNITY_INTERFACE_EXPORT * CreateReceiver(const char* name)
@@ -127,49 +372,318 @@ extern "C" void UNITY_INTERFACE_EXPORT * CreateReceiver(const char* name)
     return new klakspout::SharedObject(klakspout::SharedObject::Type::receiver, name != nullptr ? name : "");
 }
 
+extern "C" int UNITY_INTERFACE_EXPORT SubmitEventBatch(const int* events, void* const* objects, int count)
+{
+    // Returns the number of the accepted events. The rest should be
+    // issued individually by the caller.
+    auto i = 0;
+    while (i < count && queue_.push(events[i], objects[i])) i++;
+    return i;
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT * GetEventQueuePosition()
+{
+    return reinterpret_cast<void*>(static_cast<std::uintptr_t>(queue_.position()));
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT GetPendingDisposals()
+{
+    // The disposed objects are only collected in the render events, so the
+    // caller keeps issuing the flush event while this is not zero.
+    return static_cast<int>(disposer_.pending());
+}
+
 extern "C" void UNITY_INTERFACE_EXPORT * GetTexturePointer(void* ptr)
 {
-    return reinterpret_cast<const klakspout::SharedObject*>(ptr)->d3d11_resource_view_;
+    // Receivers with the interop surface give the local texture of Unity's
+    // device instead of the view of the shared texture.
+    auto& state = reinterpret_cast<const klakspout::SharedObject*>(ptr)->published_;
+    auto view = state.resource_view.load(std::memory_order_acquire);
+    auto native = state.native_texture.load(std::memory_order_relaxed);
+    return view && native ? native : view;
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT * GetSrgbTexturePointer(void* ptr)
+{
+    // Null when the shared texture can't be viewed in sRGB.
+    return reinterpret_cast<const klakspout::SharedObject*>(ptr)->published_.srgb_view.load(std::memory_order_relaxed);
 }
 
 extern "C" int UNITY_INTERFACE_EXPORT GetTextureWidth(void* ptr)
 {
-    return reinterpret_cast<const klakspout::SharedObject*>(ptr)->width_;
+    return reinterpret_cast<const klakspout::SharedObject*>(ptr)->published_.width.load(std::memory_order_relaxed);
 }
 
 extern "C" int UNITY_INTERFACE_EXPORT GetTextureHeight(void* ptr)
 {
-    return reinterpret_cast<const klakspout::SharedObject*>(ptr)->height_;
+    return reinterpret_cast<const klakspout::SharedObject*>(ptr)->published_.height.load(std::memory_order_relaxed);
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT GetTextureFormat(void* ptr)
+{
+    return reinterpret_cast<const klakspout::SharedObject*>(ptr)->published_.format.load(std::memory_order_relaxed);
 }
 
 extern "C" int UNITY_INTERFACE_EXPORT CheckValid(void* ptr)
 {
-    std::lock_guard<std::mutex> guard(lock_);
-    return reinterpret_cast<const klakspout::SharedObject*>(ptr)->isValid();
+    // The validation itself is done in the update event on the render thread.
+    return reinterpret_cast<const klakspout::SharedObject*>(ptr)->published_.valid.load(std::memory_order_acquire);
 }
 
-extern "C" int UNITY_INTERFACE_EXPORT ScanSharedObjects()
+extern "C" int UNITY_INTERFACE_EXPORT IsBridgeMode()
+{
+    auto& g = klakspout::Globals::get();
+    return g.isReady() && g.bridge_;
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT HasInteropSurface(void* ptr)
+{
+    // The frames are exchanged with Unity's device on the GPU (bridge mode).
+    return reinterpret_cast<const klakspout::SharedObject*>(ptr)->published_.interop.load(std::memory_order_relaxed);
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT SetInteropSource(void* ptr, void* texture)
+{
+    // Unity's native texture with the same size and format as the shared
+    // texture, copied in the next send copy event
+    reinterpret_cast<klakspout::SharedObject*>(ptr)->setInteropSource(texture);
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT UploadSourcePixels(void* ptr, const void* data, int size)
+{
+    // Tightly packed rows in the shared texture format (top row first)
+    // They're uploaded on the next present event.
+    reinterpret_cast<klakspout::SharedObject*>(ptr)->upload_.write(data, size);
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT IsNativeSendAvailable()
+{
+    return blitter_ && blitter_->isAvailable();
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT SetSourceTexture(void* ptr, void* texture, int flags)
+{
+    auto pobj = reinterpret_cast<klakspout::SharedObject*>(ptr);
+    pobj->setSourceTexture(reinterpret_cast<ID3D11Texture2D*>(texture), flags);
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT SetTimestampMode(void* ptr, int enable)
+{
+    reinterpret_cast<klakspout::SharedObject*>(ptr)->setTimestampMode(enable != 0);
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT SetMirrorInterval(void* ptr, int interval)
+{
+    reinterpret_cast<klakspout::SharedObject*>(ptr)->setMirrorInterval(interval);
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT IsNativeReceiveAvailable()
+{
+    return blitter_ && blitter_->isComputeAvailable();
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT SetTargetTexture(void* ptr, void* texture, int flags)
+{
+    auto pobj = reinterpret_cast<klakspout::SharedObject*>(ptr);
+    pobj->setTargetTexture(reinterpret_cast<ID3D11Texture2D*>(texture), flags);
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT SetAtlasRegion(void* ptr, int index, const char* name, int x, int y, int width, int height)
+{
+    // A null name or an empty rectangle removes the region.
+    auto pobj = reinterpret_cast<klakspout::SharedObject*>(ptr);
+    pobj->setAtlasRegion(index, name, { x, y, width, height });
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT SetAtlasSource(void* ptr, int index, void* texture, int flags)
+{
+    auto pobj = reinterpret_cast<klakspout::SharedObject*>(ptr);
+    pobj->setAtlasSource(index, reinterpret_cast<ID3D11Texture2D*>(texture), flags);
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT FindAtlasRegion(void* ptr, const char* name, int* rect)
+{
+    // Stores the region rectangle (x, y, width, height) in texels with the
+    // top-left origin. Returns false when the region is not found.
+    klakspout::AtlasRect found;
+    auto pobj = reinterpret_cast<klakspout::SharedObject*>(ptr);
+    if (!pobj->findAtlasRegion(name, found)) return false;
+    rect[0] = found.x;
+    rect[1] = found.y;
+    rect[2] = found.width;
+    rect[3] = found.height;
+    return true;
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT SetSourceRegion(void* ptr, int x, int y, int width, int height)
+{
+    // An empty rectangle selects the whole texture.
+    auto pobj = reinterpret_cast<klakspout::SharedObject*>(ptr);
+    pobj->setSourceRect({ x, y, width, height });
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT HasKeyedMutex(void* ptr)
+{
+    return reinterpret_cast<const klakspout::SharedObject*>(ptr)->hasKeyedMutex();
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT GetFrameCount(void* ptr)
+{
+    return reinterpret_cast<const klakspout::SharedObject*>(ptr)->getFrameCount();
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT SetReadbackBuffer(void* ptr, void* buffer, int size)
+{
+    // The previous buffer is never written after this returns, so the
+    // caller can unpin it.
+    reinterpret_cast<klakspout::SharedObject*>(ptr)->readback_.setBuffer(buffer, size);
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT GetReadbackSize(void* ptr)
+{
+    // Required buffer size for the current texture (tightly packed rows)
+    auto& state = reinterpret_cast<const klakspout::SharedObject*>(ptr)->published_;
+    auto format = static_cast<DXGI_FORMAT>(state.format.load(std::memory_order_relaxed));
+    auto size = state.width.load(std::memory_order_relaxed) * state.height.load(std::memory_order_relaxed);
+    return size > 0 ? size * klakspout::StagingRing::bytesPerPixel(format) : 0;
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT LockReadbackBuffer(void* ptr)
+{
+    // Returns the frame serial number in the buffer, or -1 when it's busy.
+    return reinterpret_cast<klakspout::SharedObject*>(ptr)->readback_.lockBuffer();
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT UnlockReadbackBuffer(void* ptr)
+{
+    reinterpret_cast<klakspout::SharedObject*>(ptr)->readback_.unlockBuffer();
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT ConvertRgb10a2Pixels(void* dst, const void* src, int width, int height)
+{
+    // R10G10B10A2 to R8G8B8A8 (tightly packed rows), used to upload the read
+    // back frames in the bridge mode
+    klakspout::RowKernels::convertRgb10a2(dst, width * 4, src, width * 4, width, height);
+}
+
+extern "C" void UNITY_INTERFACE_EXPORT GetStats(void* ptr, klakspout::Stats::Snapshot* stats)
+{
+    // The counters are always available, also in the release build.
+    reinterpret_cast<const klakspout::SharedObject*>(ptr)->stats_.snapshot(*stats);
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT IsCpuTransport(void* ptr)
+{
+    return reinterpret_cast<const klakspout::SharedObject*>(ptr)->published_.cpu_transport.load(std::memory_order_relaxed);
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT GetAdapterCount()
+{
+    auto& g = klakspout::Globals::get();
+    return g.isReady() ? g.spout_->GetNumAdapters() : 0;
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT GetAdapterName(int index, char* buffer, int length)
 {
     auto& g = klakspout::Globals::get();
-    if (!g.isReady()) return 0;
-    std::lock_guard<std::mutex> guard(lock_);
-    shared_object_names_.clear();
-    g.sender_names_->GetSenderNames(&shared_object_names_);
+    return g.isReady() && g.spout_->GetAdapterName(index, buffer, length);
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT GetDeviceAdapter()
+{
+    // Index of the adapter that Unity renders with (-1 if unknown)
+    auto& g = klakspout::Globals::get();
+    return g.isReady() ? g.spout_->FindAdapter(g.adapter_luid_) : -1;
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT GetSharedObjectAdapter(const char* name)
+{
+    // Index of the adapter that the sender renders with. Returns -1 when
+    // unknown (the sender doesn't tell it or the sender is not found).
+    auto& g = klakspout::Globals::get();
+    if (!g.isReady() || !name) return -1;
+
+    SpoutSharedMemory mem;
+    if (!mem.Open(name)) return -1;
+
+    auto ext = spoutSenderNames::getSharedInfoExt(mem);
+    if (!ext || (ext->adapterLuidLow == 0 && ext->adapterLuidHigh == 0)) return -1;
+
+    LUID luid = { ext->adapterLuidLow, ext->adapterLuidHigh };
+    return g.spout_->FindAdapter(luid);
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT ScanSharedObjects()
+{
+    auto scanner = GetScanner();
+    if (!scanner) return 0;
+
+    std::set<std::string> names;
+    scanner->GetSenderNames(&names);
+    shared_object_names_.assign(names.begin(), names.end());
     return static_cast<int>(shared_object_names_.size());
 }
 
 extern "C" const void UNITY_INTERFACE_EXPORT * GetSharedObjectName(int index)
 {
-    auto count = 0;
-    for (auto& name : shared_object_names_)
+    if (index < 0 || index >= static_cast<int>(shared_object_names_.size())) return nullptr;
+    return shared_object_names_[index].c_str();
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT EnumerateSharedObjects(char* names, int* attributes, int capacity)
+{
+    // Bulk enumeration: Fills the caller's buffers with the names
+    // (SpoutMaxSenderNameLen bytes for each) and the attributes (width,
+    // height and format for each), then returns the total number of the
+    // senders, which can be larger than the capacity.
+    // The names are sorted as the ones from ScanSharedObjects, as the name
+    // list gives them in slot order, which changes when a sender leaves a
+    // hole and another one fills it. When the capacity is too small, only
+    // the ones that fit are sorted.
+    auto scanner = GetScanner();
+    if (!scanner) return 0;
+
+    auto count = scanner->GetSenderNameList(names, capacity);
+    auto filled = count < capacity ? count : capacity;
+
+    // Insertion sort: There are only a few senders at most.
+    for (auto i = 1; i < filled; i++)
+    {
+        char name[SpoutMaxSenderNameLen];
+        std::memcpy(name, names + i * SpoutMaxSenderNameLen, SpoutMaxSenderNameLen);
+
+        auto j = i;
+        for (; j > 0 && std::strcmp(names + (j - 1) * SpoutMaxSenderNameLen, name) > 0; j--)
+            std::memcpy(names + j * SpoutMaxSenderNameLen,
+                        names + (j - 1) * SpoutMaxSenderNameLen, SpoutMaxSenderNameLen);
+
+        if (j != i) std::memcpy(names + j * SpoutMaxSenderNameLen, name, SpoutMaxSenderNameLen);
+    }
+
+    for (auto i = 0; i < filled; i++)
     {
-        if (count++ == index)
+        SharedTextureInfo info;
+        auto* attr = attributes + i * 3;
+        if (scanner->getSharedInfo(names + i * SpoutMaxSenderNameLen, &info))
         {
-            // Return the name via a static string object.
-            static std::string temp;
-            temp = name;
-            return temp.c_str();
+            attr[0] = info.width;
+            attr[1] = info.height;
+            attr[2] = info.format;
+        }
+        else
+        {
+            attr[0] = attr[1] = attr[2] = 0;
         }
     }
-    return nullptr;
+
+    return count;
+}
+
+extern "C" int UNITY_INTERFACE_EXPORT GetSharedObjectGeneration()
+{
+    // Returns -1 when the generation counter is not available.
+    auto scanner = GetScanner();
+    LONG generation;
+    if (!scanner || !scanner->GetSenderSetGeneration(generation)) return -1;
+    return generation & 0x7fffffff;
 }
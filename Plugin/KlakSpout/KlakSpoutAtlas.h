@@ -0,0 +1,242 @@
+#pragma once
+
+#include "KlakSpoutGlobals.h"
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace klakspout
+{
+    // Atlas region rectangle in texels (the top-left origin)
+    // It can be packed into 64 bits (16 bits for each element), so that it can
+    // be passed between the threads with a single atomic variable.
+    struct AtlasRect
+    {
+        int x, y, width, height;
+
+        bool isEmpty() const
+        {
+            return width <= 0 || height <= 0;
+        }
+
+        std::uint64_t pack() const
+        {
+            return (static_cast<std::uint64_t>(x & 0xffff) << 48) |
+                   (static_cast<std::uint64_t>(y & 0xffff) << 32) |
+                   (static_cast<std::uint64_t>(width & 0xffff) << 16) |
+                    static_cast<std::uint64_t>(height & 0xffff);
+        }
+
+        static AtlasRect unpack(std::uint64_t v)
+        {
+            return {
+                static_cast<int>((v >> 48) & 0xffff), static_cast<int>((v >> 32) & 0xffff),
+                static_cast<int>((v >> 16) & 0xffff), static_cast<int>(v & 0xffff)
+            };
+        }
+    };
+
+    // Atlas map: Sender side
+    // Publishes the region table of an atlas sender. Only used from the
+    // render thread.
+    class AtlasTable final
+    {
+    public:
+
+        AtlasTable() : header_(nullptr)
+        {
+        }
+
+        ~AtlasTable()
+        {
+            close();
+        }
+
+        // Prohibit use of copy operators
+        AtlasTable(AtlasTable&) = delete;
+        AtlasTable& operator = (const AtlasTable&) = delete;
+
+        // Rewrite the region table. Entries with empty rectangles are
+        // published as unused ones.
+        bool publish(const std::string& name, const char (*names)[SPOUT_ATLAS_NAME_LEN], const AtlasRect* rects, int count)
+        {
+            if (!open(name)) return false;
+
+            auto entries = reinterpret_cast<SharedAtlasRegion*>(header_ + 1);
+            auto last = header_->count;
+
+            InterlockedIncrement(&header_->sequence); // odd - writing
+
+            for (auto i = 0; i < count; i++)
+            {
+                auto& entry = entries[i];
+                auto& rect = rects[i];
+                auto used = !rect.isEmpty() && names[i][0] != 0;
+                std::memcpy(entry.name, names[i], SPOUT_ATLAS_NAME_LEN);
+                entry.name[SPOUT_ATLAS_NAME_LEN - 1] = 0;
+                entry.x = used ? rect.x : 0;
+                entry.y = used ? rect.y : 0;
+                entry.width = used ? rect.width : 0;
+                entry.height = used ? rect.height : 0;
+            }
+
+            // Clear the entries left by the previous table.
+            for (auto i = static_cast<unsigned int>(count); i < last && i < SPOUT_ATLAS_MAX; i++)
+                std::memset(&entries[i], 0, sizeof(SharedAtlasRegion));
+
+            header_->count = count;
+            InterlockedIncrement(&header_->generation);
+
+            InterlockedIncrement(&header_->sequence); // even - done
+            return true;
+        }
+
+        // Close the atlas map.
+        void close()
+        {
+            map_.Close();
+            header_ = nullptr;
+        }
+
+    private:
+
+        SpoutSharedMemory map_;
+        SharedAtlasHeader* header_;
+
+        // Open (or create) the atlas map. The map has a fixed size, so the
+        // one left by a previous sender with the same name is reused.
+        bool open(const std::string& name)
+        {
+            if (header_) return true;
+
+            auto size = static_cast<int>(sizeof(SharedAtlasHeader) + sizeof(SharedAtlasRegion) * SPOUT_ATLAS_MAX);
+            auto res = map_.Create((name + SPOUT_ATLAS_SUFFIX).c_str(), size);
+            if (res == SPOUT_CREATE_FAILED)
+            {
+                DEBUG_LOG("Atlas map creation failed (%s)", name.c_str());
+                return false;
+            }
+
+            header_ = reinterpret_cast<SharedAtlasHeader*>(map_.Buffer());
+
+            // Initialize the header. The sequence number is kept even in
+            // case that the previous sender died in the middle of writing.
+            // The magic number is written last so that receivers don't use a
+            // half-initialized header.
+            if (InterlockedCompareExchange(&header_->sequence, 0, 0) & 1)
+                InterlockedIncrement(&header_->sequence);
+            if (header_->magic != SPOUT_ATLAS_MAGIC)
+            {
+                header_->count = 0;
+                InterlockedExchange(reinterpret_cast<volatile LONG*>(&header_->magic), SPOUT_ATLAS_MAGIC);
+            }
+
+            return true;
+        }
+    };
+
+    // Atlas map: Receiver side
+    // Looks up a named region in the table of an atlas sender. The result is
+    // cached while the table stays the same. Only used from the main thread.
+    class AtlasLookup final
+    {
+    public:
+
+        AtlasLookup()
+            : header_(nullptr), retry_time_(0), generation_(0),
+              found_(false), rect_()
+        {
+        }
+
+        // Prohibit use of copy operators
+        AtlasLookup(AtlasLookup&) = delete;
+        AtlasLookup& operator = (const AtlasLookup&) = delete;
+
+        // Find the region with the given name. Returns false when it's not
+        // found or the sender doesn't have the atlas map.
+        bool find(const std::string& name, const char* region, AtlasRect& rect)
+        {
+            if (!open(name) || !region) return false;
+
+            auto magic = InterlockedCompareExchange(reinterpret_cast<volatile LONG*>(&header_->magic), 0, 0);
+            if (magic != SPOUT_ATLAS_MAGIC) return false;
+
+            // Cached result
+            auto generation = InterlockedCompareExchange(&header_->generation, 0, 0);
+            if (generation == generation_ && region_ == region)
+            {
+                rect = rect_;
+                return found_;
+            }
+
+            // Seqlock read: Retry while the sender is rewriting the table.
+            for (auto i = 0; i < SPOUT_SEQLOCK_RETRIES; i++)
+            {
+                auto seq = InterlockedCompareExchange(&header_->sequence, 0, 0);
+                if (seq & 1) { YieldProcessor(); continue; }
+
+                AtlasRect found = {};
+                auto res = search(region, found);
+
+                if (InterlockedCompareExchange(&header_->sequence, 0, 0) != seq) continue;
+
+                generation_ = InterlockedCompareExchange(&header_->generation, 0, 0);
+                region_ = region;
+                found_ = res;
+                rect_ = found;
+
+                rect = found;
+                return res;
+            }
+
+            return false;
+        }
+
+    private:
+
+        SpoutSharedMemory map_;
+        const SharedAtlasHeader* header_;
+        DWORD retry_time_;
+
+        // Cached result
+        LONG generation_;
+        std::string region_;
+        bool found_;
+        AtlasRect rect_;
+
+        // Open the atlas map. The map may not exist (non-atlas senders), so
+        // it's only retried at the directory refresh interval.
+        bool open(const std::string& name)
+        {
+            if (header_) return true;
+
+            auto time = GetTickCount();
+            if (retry_time_ != 0 && time - retry_time_ < SPOUT_DIRECTORY_REFRESH) return false;
+            retry_time_ = time | 1;
+
+            if (!map_.Open((name + SPOUT_ATLAS_SUFFIX).c_str())) return false;
+            header_ = reinterpret_cast<const SharedAtlasHeader*>(map_.Buffer());
+            return true;
+        }
+
+        // Linear search in the region table
+        bool search(const char* region, AtlasRect& rect) const
+        {
+            auto entries = reinterpret_cast<const SharedAtlasRegion*>(header_ + 1);
+            auto count = header_->count < SPOUT_ATLAS_MAX ? header_->count : SPOUT_ATLAS_MAX;
+
+            for (auto i = 0u; i < count; i++)
+            {
+                auto& entry = entries[i];
+                if (entry.width == 0 || std::strncmp(entry.name, region, SPOUT_ATLAS_NAME_LEN) != 0) continue;
+                rect = {
+                    static_cast<int>(entry.x), static_cast<int>(entry.y),
+                    static_cast<int>(entry.width), static_cast<int>(entry.height)
+                };
+                return true;
+            }
+
+            return false;
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,464 @@
+#pragma once
+
+#include "KlakSpoutGlobals.h"
+#include <cstring>
+#include <d3dcompiler.h>
+
+namespace klakspout
+{
+    // Render-thread blitter used for copying textures into shared textures
+    // with the Y-flip and the alpha/color conversion applied. It also has a
+    // compute shader version that writes into UAVs, used for converting
+    // received frames without a draw call.
+    // It saves and restores the pipeline states that it touches, so that
+    // Unity's state cache stays consistent.
+    class Blitter final
+    {
+    public:
+
+        // Conversion flags
+        enum Flags { clear_alpha = 1, encode_srgb = 2, decode_srgb = 4 };
+
+        Blitter(ID3D11Device* device)
+            : vertex_shader_(nullptr), pixel_shader_(nullptr),
+              compute_shader_(nullptr), sampler_(nullptr), constants_(nullptr)
+        {
+            if (!compileShaders(device)) { release(); return; }
+
+            // Bilinear sampler (in case that the dimensions don't match)
+            D3D11_SAMPLER_DESC sd = {};
+            sd.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+            sd.AddressU = sd.AddressV = sd.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+            sd.ComparisonFunc = D3D11_COMPARISON_NEVER;
+            sd.MaxLOD = D3D11_FLOAT32_MAX;
+            if (FAILED(device->CreateSamplerState(&sd, &sampler_))) { release(); return; }
+
+            // Constant buffer for the conversion parameters
+            D3D11_BUFFER_DESC bd = {};
+            bd.ByteWidth = sizeof(Constants);
+            bd.Usage = D3D11_USAGE_DEFAULT;
+            bd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+            if (FAILED(device->CreateBuffer(&bd, nullptr, &constants_))) { release(); return; }
+        }
+
+        ~Blitter()
+        {
+            release();
+        }
+
+        // Prohibit use of default constructor and copy operators
+        Blitter() = delete;
+        Blitter(Blitter&) = delete;
+        Blitter& operator = (const Blitter&) = delete;
+
+        // Check if the blitter has been successfully initialized.
+        bool isAvailable() const
+        {
+            return constants_;
+        }
+
+        // Check if the compute shader version is available. It needs the
+        // feature level 11.0.
+        bool isComputeAvailable() const
+        {
+            return isAvailable() && compute_shader_;
+        }
+
+        // Region of a source view drawn in drawRegions() (in texels)
+        struct Region
+        {
+            ID3D11ShaderResourceView* source;
+            int x, y, width, height;
+            int flags;
+        };
+
+        // Convert the source view into the destination UAV with the compute
+        // shader. The destination is filled entirely (the source is scaled).
+        // The source rectangle is given in UV (offset and scale, the top-left
+        // origin), and the whole source is used when it's null.
+        void dispatch(
+            ID3D11DeviceContext* context,
+            ID3D11ShaderResourceView* source, ID3D11UnorderedAccessView* destination,
+            int width, int height, int flags, const float* source_rect = nullptr
+        )
+        {
+            if (!isComputeAvailable()) return;
+
+            ComputeStateBackup backup(context);
+
+            auto consts = makeConstants(flags);
+            if (source_rect) std::memcpy(consts.source_rect, source_rect, sizeof(consts.source_rect));
+            context->UpdateSubresource(constants_, 0, nullptr, &consts, 0, 0);
+
+            context->CSSetShader(compute_shader_, nullptr, 0);
+            context->CSSetShaderResources(0, 1, &source);
+            context->CSSetSamplers(0, 1, &sampler_);
+            context->CSSetConstantBuffers(0, 1, &constants_);
+            context->CSSetUnorderedAccessViews(0, 1, &destination, nullptr);
+
+            context->Dispatch((width + 7) / 8, (height + 7) / 8, 1);
+
+            // Unbind the views before restoring.
+            ID3D11ShaderResourceView* null_srv = nullptr;
+            ID3D11UnorderedAccessView* null_uav = nullptr;
+            context->CSSetShaderResources(0, 1, &null_srv);
+            context->CSSetUnorderedAccessViews(0, 1, &null_uav, nullptr);
+        }
+
+        // Draw the source view into the destination view with conversion.
+        void draw(
+            ID3D11DeviceContext* context,
+            ID3D11ShaderResourceView* source, ID3D11RenderTargetView* destination,
+            int width, int height, int flags
+        )
+        {
+            const Region region = { source, 0, 0, width, height, flags };
+            drawRegions(context, destination, &region, 1);
+        }
+
+        // Draw the source views into the regions of the destination view. It
+        // sets up the pipeline only once, so it's cheaper than drawing them
+        // one by one (used for the atlas senders).
+        void drawRegions(
+            ID3D11DeviceContext* context, ID3D11RenderTargetView* destination,
+            const Region* regions, int count
+        )
+        {
+            if (!isAvailable() || count <= 0) return;
+
+            StateBackup backup(context);
+
+            context->IASetInputLayout(nullptr);
+            context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            context->VSSetShader(vertex_shader_, nullptr, 0);
+            context->GSSetShader(nullptr, nullptr, 0);
+            context->HSSetShader(nullptr, nullptr, 0);
+            context->DSSetShader(nullptr, nullptr, 0);
+            context->PSSetShader(pixel_shader_, nullptr, 0);
+            context->PSSetSamplers(0, 1, &sampler_);
+            context->PSSetConstantBuffers(0, 1, &constants_);
+            context->RSSetState(nullptr);
+            context->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+            context->OMSetDepthStencilState(nullptr, 0);
+            context->OMSetRenderTargets(1, &destination, nullptr);
+
+            auto last_flags = -1;
+
+            for (auto i = 0; i < count; i++)
+            {
+                auto& r = regions[i];
+
+                // The constant buffer is only updated when the flags change.
+                if (r.flags != last_flags)
+                {
+                    auto consts = makeConstants(r.flags);
+                    context->UpdateSubresource(constants_, 0, nullptr, &consts, 0, 0);
+                    last_flags = r.flags;
+                }
+
+                D3D11_VIEWPORT vp = {
+                    static_cast<float>(r.x), static_cast<float>(r.y),
+                    static_cast<float>(r.width), static_cast<float>(r.height), 0, 1
+                };
+
+                context->RSSetViewports(1, &vp);
+                context->PSSetShaderResources(0, 1, &r.source);
+
+                // Full screen triangle (clipped by the viewport)
+                context->Draw(3, 0);
+            }
+
+            // Unbind the views before restoring.
+            ID3D11ShaderResourceView* null_srv = nullptr;
+            context->PSSetShaderResources(0, 1, &null_srv);
+            context->OMSetRenderTargets(0, nullptr, nullptr);
+        }
+
+    private:
+
+        struct Constants
+        {
+            float clear_alpha;
+            float encode_srgb;
+            float decode_srgb;
+            float padding;
+            float source_rect[4];
+        };
+
+        static Constants makeConstants(int flags)
+        {
+            return {
+                (flags & clear_alpha) ? 1.0f : 0.0f,
+                (flags & encode_srgb) ? 1.0f : 0.0f,
+                (flags & decode_srgb) ? 1.0f : 0.0f,
+                0, { 0, 0, 1, 1 }
+            };
+        }
+
+        ID3D11VertexShader* vertex_shader_;
+        ID3D11PixelShader* pixel_shader_;
+        ID3D11ComputeShader* compute_shader_;
+        ID3D11SamplerState* sampler_;
+        ID3D11Buffer* constants_;
+
+        // Release the D3D11 objects.
+        void release()
+        {
+            if (vertex_shader_) { vertex_shader_->Release(); vertex_shader_ = nullptr; }
+            if (pixel_shader_) { pixel_shader_->Release(); pixel_shader_ = nullptr; }
+            if (compute_shader_) { compute_shader_->Release(); compute_shader_ = nullptr; }
+            if (sampler_) { sampler_->Release(); sampler_ = nullptr; }
+            if (constants_) { constants_->Release(); constants_ = nullptr; }
+        }
+
+        // Shader source code
+        // The vertex shader generates a full screen triangle that samples the
+        // source upside down, as the sender pass in Blit.shader does.
+        static const char* shaderSource()
+        {
+            return R"(
+            Texture2D _MainTex : register(t0);
+            SamplerState _Sampler : register(s0);
+
+            cbuffer Params : register(b0)
+            {
+                float _ClearAlpha;
+                float _EncodeSRGB;
+                float _DecodeSRGB;
+                float4 _SourceRect; // compute shader only
+            };
+
+            void VertexMain(uint vid : SV_VertexID,
+                            out float4 position : SV_Position,
+                            out float2 uv : TEXCOORD0)
+            {
+                float2 p = float2((vid << 1) & 2, vid & 2);
+                position = float4(p.x * 2 - 1, 1 - p.y * 2, 0, 1);
+                uv = float2(p.x, 1 - p.y);
+            }
+
+            float3 LinearToSRGB(float3 c)
+            {
+                c = saturate(c);
+                return c <= 0.0031308 ? c * 12.92 : 1.055 * pow(c, 1 / 2.4) - 0.055;
+            }
+
+            float3 SRGBToLinear(float3 c)
+            {
+                c = saturate(c);
+                return c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4);
+            }
+
+            float4 Convert(float4 col)
+            {
+                if (_EncodeSRGB > 0) col.rgb = LinearToSRGB(col.rgb);
+                if (_DecodeSRGB > 0) col.rgb = SRGBToLinear(col.rgb);
+                col.a = saturate(col.a + _ClearAlpha);
+                return col;
+            }
+
+            float4 PixelMain(float4 position : SV_Position,
+                             float2 uv : TEXCOORD0) : SV_Target
+            {
+                return Convert(_MainTex.Sample(_Sampler, uv));
+            }
+
+            #if defined(COMPUTE_SHADER)
+
+            RWTexture2D<float4> _Target : register(u0);
+
+            // Upside-down copy, as the receiver pass in Blit.shader does
+            // The source rectangle is applied after flipping, as it's given
+            // with the top-left origin.
+            [numthreads(8, 8, 1)]
+            void ComputeMain(uint2 id : SV_DispatchThreadID)
+            {
+                uint w, h;
+                _Target.GetDimensions(w, h);
+                if (id.x >= w || id.y >= h) return;
+                float2 uv = (id + 0.5) / float2(w, h);
+                uv = _SourceRect.xy + float2(uv.x, 1 - uv.y) * _SourceRect.zw;
+                _Target[id] = Convert(_MainTex.SampleLevel(_Sampler, uv, 0));
+            }
+
+            #endif
+            )";
+        }
+
+        // Compile the shaders with the system shader compiler. It's loaded
+        // dynamically to avoid making the plugin depend on it at load time.
+        bool compileShaders(ID3D11Device* device)
+        {
+            auto module = LoadLibraryA("d3dcompiler_47.dll");
+            if (!module) return false;
+
+            auto compile = reinterpret_cast<pD3DCompile>(GetProcAddress(module, "D3DCompile"));
+
+            auto source = shaderSource();
+            auto length = std::strlen(source);
+
+            ID3DBlob* vs_blob = nullptr;
+            ID3DBlob* ps_blob = nullptr;
+
+            auto ok = compile != nullptr &&
+                SUCCEEDED(compile(source, length, nullptr, nullptr, nullptr,
+                                  "VertexMain", "vs_4_0", 0, 0, &vs_blob, nullptr)) &&
+                SUCCEEDED(compile(source, length, nullptr, nullptr, nullptr,
+                                  "PixelMain", "ps_4_0", 0, 0, &ps_blob, nullptr));
+
+            if (ok) ok = SUCCEEDED(device->CreateVertexShader(
+                vs_blob->GetBufferPointer(), vs_blob->GetBufferSize(), nullptr, &vertex_shader_));
+
+            if (ok) ok = SUCCEEDED(device->CreatePixelShader(
+                ps_blob->GetBufferPointer(), ps_blob->GetBufferSize(), nullptr, &pixel_shader_));
+
+            if (vs_blob) vs_blob->Release();
+            if (ps_blob) ps_blob->Release();
+
+            // The compute shader is optional (feature level 11.0 only).
+            if (ok && device->GetFeatureLevel() >= D3D_FEATURE_LEVEL_11_0)
+            {
+                const D3D_SHADER_MACRO defines[] = { { "COMPUTE_SHADER", "1" }, { nullptr, nullptr } };
+                ID3DBlob* cs_blob = nullptr;
+
+                if (SUCCEEDED(compile(source, length, nullptr, defines, nullptr,
+                                      "ComputeMain", "cs_5_0", 0, 0, &cs_blob, nullptr)))
+                {
+                    if (FAILED(device->CreateComputeShader(
+                        cs_blob->GetBufferPointer(), cs_blob->GetBufferSize(), nullptr, &compute_shader_)))
+                        compute_shader_ = nullptr;
+                }
+
+                if (cs_blob) cs_blob->Release();
+                if (!compute_shader_) DEBUG_LOG("Shader compilation failed (%s)", "Compute");
+            }
+
+            FreeLibrary(module);
+
+            if (!ok) DEBUG_LOG("Shader compilation failed (%s)", "Blitter");
+            return ok;
+        }
+
+        // Compute pipeline state backup
+        class ComputeStateBackup final
+        {
+        public:
+
+            ComputeStateBackup(ID3D11DeviceContext* context) : context_(context)
+            {
+                context_->CSGetShader(&cs_, nullptr, nullptr);
+                context_->CSGetShaderResources(0, 1, &srv_);
+                context_->CSGetSamplers(0, 1, &sampler_);
+                context_->CSGetConstantBuffers(0, 1, &cb_);
+                context_->CSGetUnorderedAccessViews(0, 1, &uav_);
+            }
+
+            ~ComputeStateBackup()
+            {
+                context_->CSSetShader(cs_, nullptr, 0);
+                context_->CSSetShaderResources(0, 1, &srv_);
+                context_->CSSetSamplers(0, 1, &sampler_);
+                context_->CSSetConstantBuffers(0, 1, &cb_);
+                context_->CSSetUnorderedAccessViews(0, 1, &uav_, nullptr);
+
+                if (cs_) cs_->Release();
+                if (srv_) srv_->Release();
+                if (sampler_) sampler_->Release();
+                if (cb_) cb_->Release();
+                if (uav_) uav_->Release();
+            }
+
+        private:
+
+            ID3D11DeviceContext* context_;
+            ID3D11ComputeShader* cs_;
+            ID3D11ShaderResourceView* srv_;
+            ID3D11SamplerState* sampler_;
+            ID3D11Buffer* cb_;
+            ID3D11UnorderedAccessView* uav_;
+        };
+
+        // Pipeline state backup: Saves the states on construction and
+        // restores them on destruction.
+        class StateBackup final
+        {
+        public:
+
+            StateBackup(ID3D11DeviceContext* context) : context_(context)
+            {
+                context_->IAGetInputLayout(&input_layout_);
+                context_->IAGetPrimitiveTopology(&topology_);
+                context_->VSGetShader(&vs_, nullptr, nullptr);
+                context_->GSGetShader(&gs_, nullptr, nullptr);
+                context_->HSGetShader(&hs_, nullptr, nullptr);
+                context_->DSGetShader(&ds_, nullptr, nullptr);
+                context_->PSGetShader(&ps_, nullptr, nullptr);
+                context_->PSGetShaderResources(0, 1, &ps_srv_);
+                context_->PSGetSamplers(0, 1, &ps_sampler_);
+                context_->PSGetConstantBuffers(0, 1, &ps_cb_);
+                context_->RSGetState(&rs_);
+                viewport_count_ = D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE;
+                context_->RSGetViewports(&viewport_count_, viewports_);
+                context_->OMGetBlendState(&blend_, blend_factor_, &sample_mask_);
+                context_->OMGetDepthStencilState(&depth_, &stencil_ref_);
+                context_->OMGetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, rtvs_, &dsv_);
+            }
+
+            ~StateBackup()
+            {
+                context_->IASetInputLayout(input_layout_);
+                context_->IASetPrimitiveTopology(topology_);
+                context_->VSSetShader(vs_, nullptr, 0);
+                context_->GSSetShader(gs_, nullptr, 0);
+                context_->HSSetShader(hs_, nullptr, 0);
+                context_->DSSetShader(ds_, nullptr, 0);
+                context_->PSSetShader(ps_, nullptr, 0);
+                context_->PSSetShaderResources(0, 1, &ps_srv_);
+                context_->PSSetSamplers(0, 1, &ps_sampler_);
+                context_->PSSetConstantBuffers(0, 1, &ps_cb_);
+                context_->RSSetState(rs_);
+                context_->RSSetViewports(viewport_count_, viewports_);
+                context_->OMSetBlendState(blend_, blend_factor_, sample_mask_);
+                context_->OMSetDepthStencilState(depth_, stencil_ref_);
+                context_->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, rtvs_, dsv_);
+
+                safeRelease(input_layout_);
+                safeRelease(vs_); safeRelease(gs_); safeRelease(hs_);
+                safeRelease(ds_); safeRelease(ps_);
+                safeRelease(ps_srv_); safeRelease(ps_sampler_); safeRelease(ps_cb_);
+                safeRelease(rs_); safeRelease(blend_); safeRelease(depth_);
+                for (auto& rtv : rtvs_) safeRelease(rtv);
+                safeRelease(dsv_);
+            }
+
+        private:
+
+            template <typename T> static void safeRelease(T*& p)
+            {
+                if (p) { p->Release(); p = nullptr; }
+            }
+
+            ID3D11DeviceContext* context_;
+            ID3D11InputLayout* input_layout_;
+            D3D11_PRIMITIVE_TOPOLOGY topology_;
+            ID3D11VertexShader* vs_;
+            ID3D11GeometryShader* gs_;
+            ID3D11HullShader* hs_;
+            ID3D11DomainShader* ds_;
+            ID3D11PixelShader* ps_;
+            ID3D11ShaderResourceView* ps_srv_;
+            ID3D11SamplerState* ps_sampler_;
+            ID3D11Buffer* ps_cb_;
+            ID3D11RasterizerState* rs_;
+            UINT viewport_count_;
+            D3D11_VIEWPORT viewports_[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+            ID3D11BlendState* blend_;
+            FLOAT blend_factor_[4];
+            UINT sample_mask_;
+            ID3D11DepthStencilState* depth_;
+            UINT stencil_ref_;
+            ID3D11RenderTargetView* rtvs_[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+            ID3D11DepthStencilView* dsv_;
+        };
+    };
+}
\ No newline at end of file
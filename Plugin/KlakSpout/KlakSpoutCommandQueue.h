@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace klakspout
+{
+    // Lock-free single-producer single-consumer command queue
+    // The main thread pushes render commands, and the render thread pops
+    // them on a flush event. The flush event carries the producer position
+    // at the time of issue, so that commands pushed in later frames aren't
+    // executed ahead of the render events issued before them.
+    class CommandQueue final
+    {
+    public:
+
+        struct Command
+        {
+            int event_id;
+            void* object;
+        };
+
+        CommandQueue() : write_(0), read_(0) {}
+
+        // Prohibit use of copy operators
+        CommandQueue(CommandQueue&) = delete;
+        CommandQueue& operator = (const CommandQueue&) = delete;
+
+        // Push a command (producer). Returns false when the queue is full.
+        bool push(int event_id, void* object)
+        {
+            auto w = write_.load(std::memory_order_relaxed);
+            if (w - read_.load(std::memory_order_acquire) == capacity_) return false;
+            buffer_[w & (capacity_ - 1)] = Command { event_id, object };
+            write_.store(w + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Current producer position (producer)
+        std::uint32_t position() const
+        {
+            return write_.load(std::memory_order_relaxed);
+        }
+
+        // Pop the commands pushed before the given position (consumer).
+        template <typename F> void drain(std::uint32_t end, F handler)
+        {
+            auto r = read_.load(std::memory_order_relaxed);
+            auto w = write_.load(std::memory_order_acquire);
+
+            // Clamp the end position into the available range.
+            if (static_cast<std::int32_t>(end - w) > 0) end = w;
+
+            while (static_cast<std::int32_t>(end - r) > 0)
+            {
+                auto cmd = buffer_[r & (capacity_ - 1)];
+                read_.store(++r, std::memory_order_release);
+                handler(cmd.event_id, cmd.object);
+            }
+        }
+
+    private:
+
+        static constexpr std::uint32_t capacity_ = 4096; // must be power of two
+
+        Command buffer_[capacity_];
+        std::atomic<std::uint32_t> write_;
+        std::atomic<std::uint32_t> read_;
+    };
+}
\ No newline at end of file
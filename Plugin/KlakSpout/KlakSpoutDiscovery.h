@@ -0,0 +1,284 @@
+#pragma once
+
+#include "KlakSpoutGlobals.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace klakspout
+{
+    // Connection of a shared object watched by the discovery thread
+    // It stamps the heartbeat of a sender, or validates the connection of a
+    // receiver to its sender and publishes the result, so that the render
+    // thread only has to load a flag. It has its own view of the sender info
+    // map (shared with the object's one through the process-wide map cache),
+    // so that the thread can keep using it after the object has let go of
+    // the connection.
+    class Connection final
+    {
+    public:
+
+        enum class Role { sender, receiver };
+
+        Connection(Role role, const std::string& name, int width = 0, int height = 0, HANDLE handle = nullptr)
+          : role_(role), name_(name), width_(width), height_(height), handle_(handle),
+            open_(info_.Open(name.c_str())), valid_(true), info_timeouts_(0)
+        {
+            // Receivers don't keep the map of a sender without the extension
+            // block, as they couldn't tell that it outlives the sender.
+            if (open_ && role_ == Role::receiver && !spoutSenderNames::getSharedInfoExt(info_))
+            {
+                info_.Close();
+                open_ = false;
+            }
+        }
+
+        ~Connection()
+        {
+            close();
+            info_.Close();
+        }
+
+        // Prohibit use of default constructor and copy operators
+        Connection() = delete;
+        Connection(Connection&) = delete;
+        Connection& operator = (const Connection&) = delete;
+
+        // Validation result (always true with senders)
+        bool isValid() const
+        {
+            return valid_.load(std::memory_order_acquire);
+        }
+
+        // Take the number of the sender info timeouts since the last call.
+        long takeInfoTimeouts()
+        {
+            if (info_timeouts_.load(std::memory_order_relaxed) == 0) return 0;
+            return info_timeouts_.exchange(0, std::memory_order_relaxed);
+        }
+
+        // Stamp the heartbeat or validate the connection (discovery thread).
+        void serve(spoutSenderNames& names)
+        {
+            if (role_ == Role::sender)
+            {
+                std::lock_guard<std::mutex> guard(mutex_);
+                if (open_) spoutSenderNames::writeHeartbeat(info_, true);
+                return;
+            }
+
+            // Once invalid, it stays invalid.
+            if (isValid() && !validate(names))
+                valid_.store(false, std::memory_order_release);
+        }
+
+        // Stop the heartbeat and close the map. It only waits for the
+        // discovery thread when it's in the middle of stamping. Receivers
+        // leave the map to the destructor, so they never wait for it.
+        void close()
+        {
+            if (role_ != Role::sender) return;
+            std::lock_guard<std::mutex> guard(mutex_);
+            if (!open_) return;
+            spoutSenderNames::writeHeartbeat(info_, false);
+            info_.Close();
+            open_ = false;
+        }
+
+    private:
+
+        const Role role_;
+        const std::string name_;
+        const int width_, height_;
+        const HANDLE handle_;
+
+        std::mutex mutex_; // only used by senders
+        SpoutSharedMemory info_;
+        bool open_; // must be initialized after info_
+
+        std::atomic<bool> valid_;
+        std::atomic<long> info_timeouts_;
+
+        // Check if the sender is still there with the same texture.
+        bool validate(spoutSenderNames& names)
+        {
+            SharedTextureInfo info;
+
+            if (open_)
+            {
+                // The kept map outlives the sender, so the heartbeat tells
+                // if it's still alive.
+                if (!spoutSenderNames::isSenderAlive(info_)) return false;
+
+                // The seqlock read should only fail while the sender is
+                // rewriting the info. It's not a reason to drop the
+                // connection, so keep it until the next check.
+                if (!spoutSenderNames::tryReadSharedInfo(info_, &info))
+                {
+                    info_timeouts_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            else
+            {
+                // Senders without the extension block: The map is reopened
+                // every time, so that we don't keep it alive.
+                if (!names.FindSenderName(name_.c_str())) return false;
+
+                SpoutSharedMemory mem;
+                if (!mem.Open(name_.c_str())) return false;
+
+                // Failing to read the map means the lock timed out.
+                if (!spoutSenderNames::readSharedInfo(mem, &info))
+                {
+                    info_timeouts_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+
+            auto handle = LongToHandle(static_cast<long>(info.shareHandle));
+            return width_ == static_cast<int>(info.width) &&
+                   height_ == static_cast<int>(info.height) && handle_ == handle;
+        }
+    };
+
+    // Sender discovery watcher
+    // Watches the generation counter of the sender name list on a background
+    // thread and bumps its version number when the list has been changed.
+    // Objects waiting for activation (receivers waiting for their senders,
+    // senders waiting for their names to be released) only retry when the
+    // version changes, so that they cost nothing per frame.
+    // The same thread also serves the watched connections (the sender
+    // heartbeats and the receiver validation).
+    class DiscoveryWatcher final
+    {
+    public:
+
+        DiscoveryWatcher(int max_senders)
+            : max_senders_(max_senders), version_(1), running_(true),
+              connections_dirty_(false), thread_(&DiscoveryWatcher::run, this)
+        {
+        }
+
+        ~DiscoveryWatcher()
+        {
+            {
+                std::lock_guard<std::mutex> guard(mutex_);
+                running_ = false;
+            }
+            wakeup_.notify_all();
+            thread_.join();
+        }
+
+        // Prohibit use of default constructor and copy operators
+        DiscoveryWatcher() = delete;
+        DiscoveryWatcher(DiscoveryWatcher&) = delete;
+        DiscoveryWatcher& operator = (const DiscoveryWatcher&) = delete;
+
+        // Version number of the sender list. It changes when a sender has
+        // appeared or disappeared, and periodically in case of a writer that
+        // doesn't update the generation counter (or a sender that registered
+        // its name before its info).
+        std::uint32_t version() const
+        {
+            return version_.load(std::memory_order_acquire);
+        }
+
+        // Add/remove a connection to be served on the discovery thread.
+        // The thread may still be using a removed one until its next cycle,
+        // which is why they're shared.
+        void watch(const std::shared_ptr<Connection>& connection)
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            connections_.push_back(connection);
+            connections_dirty_ = true;
+        }
+
+        void unwatch(const std::shared_ptr<Connection>& connection)
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+            for (auto i = connections_.begin(); i != connections_.end(); i++)
+            {
+                if (*i != connection) continue;
+                connections_.erase(i);
+                connections_dirty_ = true;
+                break;
+            }
+        }
+
+    private:
+
+        static constexpr int poll_interval_ = 16; // msec
+        static constexpr DWORD heartbeat_ = SPOUT_DIRECTORY_REFRESH; // msec
+        static constexpr DWORD serve_interval_ = 100; // msec
+        static_assert(serve_interval_ <= SPOUT_HEARTBEAT_INTERVAL, "Heartbeats would be too sparse");
+
+        const int max_senders_;
+        std::atomic<std::uint32_t> version_;
+        std::mutex mutex_;
+        std::condition_variable wakeup_;
+        bool running_;
+        std::vector<std::shared_ptr<Connection>> connections_;
+        bool connections_dirty_;
+        std::thread thread_; // must be the last member to be initialized
+
+        void run()
+        {
+            spoutSenderNames names;
+            names.SetMaxSenders(max_senders_);
+            names.SetVersionedDirectory(true); // for the receiver validation
+
+            LONG last_generation = 0;
+            auto has_generation = false;
+            auto last_beat = GetTickCount();
+            auto last_serve = last_beat - serve_interval_;
+
+            // Local copy of the connection list, which is only updated when
+            // the list has been changed
+            std::vector<std::shared_ptr<Connection>> connections;
+
+            std::unique_lock<std::mutex> lock(mutex_);
+
+            while (running_)
+            {
+                if (connections_dirty_)
+                {
+                    connections = connections_;
+                    connections_dirty_ = false;
+                }
+
+                lock.unlock();
+
+                LONG generation;
+                auto available = names.GetSenderSetGeneration(generation);
+                auto now = GetTickCount();
+
+                // Without the counter, notify every time as a fallback.
+                auto changed = !available || !has_generation || generation != last_generation;
+
+                if (changed || now - last_beat >= heartbeat_)
+                {
+                    version_.fetch_add(1, std::memory_order_release);
+                    last_beat = now;
+                }
+
+                last_generation = generation;
+                has_generation = available;
+
+                if (now - last_serve >= serve_interval_)
+                {
+                    for (auto& c : connections) c->serve(names);
+                    last_serve = now;
+                }
+
+                lock.lock();
+                wakeup_.wait_for(lock, std::chrono::milliseconds(poll_interval_), [this] { return !running_; });
+            }
+        }
+    };
+}
\ No newline at end of file
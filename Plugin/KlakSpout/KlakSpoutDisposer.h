@@ -0,0 +1,94 @@
+#pragma once
+
+#include "KlakSpoutSharedObject.h"
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace klakspout
+{
+    // Deferred object disposer
+    // Disposed objects are retired immediately, and their sender names are
+    // released together in a single update of the name list. The objects
+    // themselves (and their D3D11 resources) are destroyed a few at a time at
+    // the end of the following frames, so that disposing many objects at once
+    // (e.g. scene unloading) doesn't make a spike on the render thread. Only
+    // used from the render thread, except for pending().
+    class Disposer final
+    {
+    public:
+
+        Disposer() : pending_(0), last_collect_(0)
+        {
+        }
+
+        // Prohibit use of copy operators
+        Disposer(Disposer&) = delete;
+        Disposer& operator = (const Disposer&) = delete;
+
+        // Queue an object for disposal. Its name is released in the next
+        // releaseNames() call.
+        void defer(SharedObject* obj)
+        {
+            obj->retire(names_);
+            objects_.push_back(obj);
+            pending_.store(objects_.size(), std::memory_order_relaxed);
+        }
+
+        // Number of the objects waiting for destruction. This can be called
+        // from the main thread.
+        size_t pending() const
+        {
+            return pending_.load(std::memory_order_relaxed);
+        }
+
+        // Release the names of the retired senders in one go. It should be
+        // called before any other operation, so that new senders can take
+        // over the names.
+        void releaseNames()
+        {
+            if (names_.empty()) return;
+            auto& g = Globals::get();
+            if (g.sender_names_) g.sender_names_->ReleaseSenderNames(names_);
+            names_.clear();
+        }
+
+        // Destroy up to the given number of the retired objects (at the end
+        // of a frame).
+        void collect(size_t count)
+        {
+            releaseNames();
+
+            count = std::min(count, objects_.size());
+            for (size_t i = 0; i < count; i++) delete objects_[i];
+            objects_.erase(objects_.begin(), objects_.begin() + count);
+            pending_.store(objects_.size(), std::memory_order_relaxed);
+
+            last_collect_ = GetTickCount();
+        }
+
+        // Collect the objects when the end-of-frame calls are missing (e.g.
+        // in edit mode where the events are issued individually).
+        void collectIdle(size_t count)
+        {
+            if (objects_.empty() || GetTickCount() - last_collect_ < idle_interval_) return;
+            collect(count);
+        }
+
+        // Destroy all the retired objects (on shutdown).
+        void collectAll()
+        {
+            collect(objects_.size());
+        }
+
+    private:
+
+        static constexpr DWORD idle_interval_ = 100; // msec
+
+        std::vector<SharedObject*> objects_; // oldest first
+        std::vector<std::string> names_;
+        std::atomic<size_t> pending_;
+        DWORD last_collect_;
+    };
+}
\ No newline at end of file
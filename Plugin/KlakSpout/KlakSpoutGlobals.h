@@ -16,14 +16,23 @@
 
 namespace klakspout
 {
+    class TexturePool;
+    class DiscoveryWatcher;
+    class Interop;
+
     // Singleton class used for storing global variables
     class Globals final
     {
     public:
 
         ID3D11Device* d3d11_;
+        LUID adapter_luid_; // zero when unknown
+        bool bridge_; // The device is ours, not Unity's (bridge mode)
         std::unique_ptr<spoutDirectX> spout_;
         std::unique_ptr<spoutSenderNames> sender_names_;
+        std::unique_ptr<TexturePool> texture_pool_;
+        std::unique_ptr<DiscoveryWatcher> discovery_;
+        std::unique_ptr<Interop> interop_; // bridge mode, optional
 
         static Globals& get()
         {
@@ -0,0 +1,223 @@
+#pragma once
+
+#include "KlakSpoutGlobals.h"
+#include <cstdint>
+#include <memory>
+#include <d3d11_4.h>
+#include <dxgi1_2.h>
+
+namespace klakspout
+{
+    class InteropSurface;
+
+    // Binding of an interop surface to Unity's device
+    // It copies between the surface and Unity's texture on Unity's GPU
+    // queue. Only used from the render thread.
+    class InteropBinding
+    {
+    public:
+
+        virtual ~InteropBinding() = default;
+
+        // Copy the source texture (Unity's native texture) into the surface
+        // (senders). Returns false when nothing has been copied.
+        virtual bool push(void* source) = 0;
+
+        // Copy the surface into the local texture (receivers). Returns false
+        // when nothing has been copied.
+        virtual bool pull() = 0;
+
+        // Local texture that Unity samples (receivers only). It's given to
+        // Texture2D.CreateExternalTexture as the native texture.
+        virtual void* texture() const = 0;
+    };
+
+    // Interop backend for a renderer that can't open Spout's shared textures
+    // (bridge mode)
+    class Interop
+    {
+    public:
+
+        virtual ~Interop() = default;
+
+        // Open the surface on Unity's device. Returns null when failed.
+        virtual std::unique_ptr<InteropBinding> bind(InteropSurface& surface, bool receiver) = 0;
+
+        // Release the objects of the destroyed bindings that Unity's device
+        // has finished using. It's called at the end of every frame.
+        virtual void collect() {}
+    };
+
+    // Interop surface
+    // An intermediate texture on our D3D11 device, shared with Unity's
+    // device via an NT handle, and a shared fence that orders the accesses
+    // from the two devices. Spout's shared textures only have the legacy
+    // handles, which D3D12 and Vulkan can't open, so the frames go through
+    // this texture. The fence value increases with every access from either
+    // side, and each access waits for the previous one. Only used from the
+    // render thread.
+    class InteropSurface final
+    {
+    public:
+
+        InteropSurface()
+          : width_(0), height_(0), format_(DXGI_FORMAT_UNKNOWN),
+            texture_(nullptr), texture_handle_(nullptr),
+            fence_(nullptr), fence_handle_(nullptr), value_(0)
+        {
+        }
+
+        ~InteropSurface()
+        {
+            release();
+        }
+
+        // Prohibit use of copy operators
+        InteropSurface(InteropSurface&) = delete;
+        InteropSurface& operator = (const InteropSurface&) = delete;
+
+        // Create the texture and the fence with the given texture specs.
+        bool create(int width, int height, DXGI_FORMAT format)
+        {
+            auto& g = Globals::get();
+
+            ID3D11Device5* device;
+            auto res = g.d3d11_->QueryInterface(__uuidof(ID3D11Device5), reinterpret_cast<void**>(&device));
+            if (FAILED(res))
+            {
+                DEBUG_LOG("Shared fence unavailable (%x)", res);
+                return false;
+            }
+
+            D3D11_TEXTURE2D_DESC td = {};
+            td.Width = width;
+            td.Height = height;
+            td.MipLevels = 1;
+            td.ArraySize = 1;
+            td.Format = format;
+            td.SampleDesc.Count = 1;
+            td.Usage = D3D11_USAGE_DEFAULT;
+            td.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+            td.MiscFlags = D3D11_RESOURCE_MISC_SHARED | D3D11_RESOURCE_MISC_SHARED_NTHANDLE;
+
+            res = device->CreateTexture2D(&td, nullptr, &texture_);
+            if (SUCCEEDED(res)) res = createTextureHandle();
+            if (SUCCEEDED(res)) res = device->CreateFence(0, D3D11_FENCE_FLAG_SHARED, __uuidof(ID3D11Fence), reinterpret_cast<void**>(&fence_));
+            if (SUCCEEDED(res)) res = fence_->CreateSharedHandle(nullptr, GENERIC_ALL, nullptr, &fence_handle_);
+
+            device->Release();
+
+            if (FAILED(res))
+            {
+                DEBUG_LOG("Interop surface creation failed (%x)", res);
+                release();
+                return false;
+            }
+
+            width_ = width;
+            height_ = height;
+            format_ = format;
+
+            DEBUG_LOG("Interop surface created (%dx%d)", width, height);
+            return true;
+        }
+
+        // Release everything after the pending accesses have been completed.
+        void release()
+        {
+            // Both devices signal the fence, so this also covers the
+            // accesses from Unity's device.
+            if (fence_ && fence_->GetCompletedValue() < value_)
+            {
+                auto event = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+                if (event && SUCCEEDED(fence_->SetEventOnCompletion(value_, event)))
+                    WaitForSingleObject(event, 1000);
+                if (event) CloseHandle(event);
+            }
+
+            binding_.reset();
+
+            if (fence_)
+            {
+                fence_->Release();
+                fence_ = nullptr;
+            }
+
+            if (fence_handle_)
+            {
+                CloseHandle(fence_handle_);
+                fence_handle_ = nullptr;
+            }
+
+            if (texture_handle_)
+            {
+                CloseHandle(texture_handle_);
+                texture_handle_ = nullptr;
+            }
+
+            if (texture_)
+            {
+                texture_->Release();
+                texture_ = nullptr;
+            }
+
+            value_ = 0;
+        }
+
+        // Access from our D3D11 device: The commands wait for the previous
+        // access, and the next access waits for them. They're flushed, so
+        // that the other device doesn't wait for unsubmitted commands.
+        template <typename Commands>
+        void access(ID3D11DeviceContext* context, Commands commands)
+        {
+            ID3D11DeviceContext4* context4;
+            if (FAILED(context->QueryInterface(__uuidof(ID3D11DeviceContext4), reinterpret_cast<void**>(&context4))))
+                return;
+
+            context4->Wait(fence_, value_);
+            commands();
+            context4->Signal(fence_, next());
+            context4->Flush();
+            context4->Release();
+        }
+
+        // Fence value of the last access, which the next access waits for
+        std::uint64_t value() const { return value_; }
+
+        // Advance the fence value for a new access.
+        std::uint64_t next() { return ++value_; }
+
+        int width() const { return width_; }
+        int height() const { return height_; }
+        DXGI_FORMAT format() const { return format_; }
+
+        ID3D11Texture2D* texture() const { return texture_; }
+        HANDLE textureHandle() const { return texture_handle_; }
+        HANDLE fenceHandle() const { return fence_handle_; }
+
+        // Binding to Unity's device
+        std::unique_ptr<InteropBinding> binding_;
+
+    private:
+
+        int width_, height_;
+        DXGI_FORMAT format_;
+        ID3D11Texture2D* texture_;
+        HANDLE texture_handle_;
+        ID3D11Fence* fence_;
+        HANDLE fence_handle_;
+        std::uint64_t value_;
+
+        HRESULT createTextureHandle()
+        {
+            IDXGIResource1* resource;
+            auto res = texture_->QueryInterface(__uuidof(IDXGIResource1), reinterpret_cast<void**>(&resource));
+            if (FAILED(res)) return res;
+            res = resource->CreateSharedHandle(
+                nullptr, DXGI_SHARED_RESOURCE_READ | DXGI_SHARED_RESOURCE_WRITE, nullptr, &texture_handle_
+            );
+            resource->Release();
+            return res;
+        }
+    };
+}
\ No newline at end of file
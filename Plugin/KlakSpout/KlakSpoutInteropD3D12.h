@@ -0,0 +1,276 @@
+#pragma once
+
+#include "KlakSpoutInterop.h"
+#include <d3d12.h>
+#include <vector>
+#include "Unity/IUnityGraphicsD3D12.h"
+
+namespace klakspout
+{
+    // D3D12 interop backend
+    // Unity's device opens the surface and the fence with the NT handles.
+    // The copy commands are recorded into our own command lists and executed
+    // with Unity's graphics queue. The events that use it have to be
+    // configured with configureEvent(), so that Unity has submitted its
+    // commands before them and the queue operations are in the issue order.
+    class InteropD3D12 final : public Interop
+    {
+    public:
+
+        explicit InteropD3D12(IUnityGraphicsD3D12v6* unity) : unity_(unity)
+        {
+        }
+
+        ~InteropD3D12()
+        {
+            // The device is shutting down, so nothing is in use anymore.
+            for (auto& r : retired_) r.object->Release();
+        }
+
+        // Prohibit use of default constructor and copy operators
+        InteropD3D12() = delete;
+        InteropD3D12(InteropD3D12&) = delete;
+        InteropD3D12& operator = (const InteropD3D12&) = delete;
+
+        // Let Unity submit its commands and give us the graphics queue in the
+        // event.
+        void configureEvent(int event_id)
+        {
+            UnityD3D12PluginEventConfig config = {};
+            config.graphicsQueueAccess = kUnityD3D12GraphicsQueueAccess_Allow;
+            config.flags = kUnityD3D12EventConfigFlag_FlushCommandBuffers |
+                           kUnityD3D12EventConfigFlag_SyncWorkerThreads;
+            config.ensureActiveRenderTextureIsBound = false;
+            unity_->ConfigureEvent(event_id, &config);
+        }
+
+        std::unique_ptr<InteropBinding> bind(InteropSurface& surface, bool receiver) override
+        {
+            collect();
+            auto binding = std::make_unique<Binding>(*this, surface);
+            if (!binding->open(receiver)) return nullptr;
+            return binding;
+        }
+
+        void collect() override
+        {
+            auto completed = unity_->GetFrameFence()->GetCompletedValue();
+            for (auto it = retired_.begin(); it != retired_.end();)
+            {
+                if (it->frame > completed) { ++it; continue; }
+                it->object->Release();
+                it = retired_.erase(it);
+            }
+        }
+
+    private:
+
+        // Frames that a retired object is kept for (the main thread may still
+        // sample the local texture until it notices the change)
+        static constexpr UINT64 retire_frames_ = 3;
+
+        // Number of the command lists in flight for each binding
+        static constexpr int slot_count_ = 3;
+
+        struct Retired
+        {
+            IUnknown* object;
+            UINT64 frame;
+        };
+
+        IUnityGraphicsD3D12v6* unity_;
+        std::vector<Retired> retired_;
+
+        // Release an object after Unity has finished the frames using it.
+        void retire(IUnknown* object)
+        {
+            if (!object) return;
+            retired_.push_back({ object, unity_->GetNextFrameFenceValue() + retire_frames_ });
+        }
+
+        // Single surface binding
+        class Binding final : public InteropBinding
+        {
+        public:
+
+            Binding(InteropD3D12& owner, InteropSurface& surface)
+              : owner_(owner), surface_(surface),
+                shared_(nullptr), fence_(nullptr), local_(nullptr), slots_(), next_(0)
+            {
+            }
+
+            ~Binding()
+            {
+                for (auto& s : slots_)
+                {
+                    owner_.retire(s.list);
+                    owner_.retire(s.allocator);
+                }
+                owner_.retire(local_);
+                owner_.retire(fence_);
+                owner_.retire(shared_);
+            }
+
+            // Prohibit use of copy operators
+            Binding(Binding&) = delete;
+            Binding& operator = (const Binding&) = delete;
+
+            bool open(bool receiver)
+            {
+                auto device = owner_.unity_->GetDevice();
+
+                auto res = device->OpenSharedHandle(surface_.textureHandle(), __uuidof(ID3D12Resource), reinterpret_cast<void**>(&shared_));
+                if (SUCCEEDED(res)) res = device->OpenSharedHandle(surface_.fenceHandle(), __uuidof(ID3D12Fence), reinterpret_cast<void**>(&fence_));
+                if (FAILED(res))
+                {
+                    DEBUG_LOG("D3D12 shared handle open failed (%x)", res);
+                    return false;
+                }
+
+                // Local texture that Unity samples (receivers)
+                // It's always left in the shader resource state.
+                if (receiver)
+                {
+                    auto desc = shared_->GetDesc();
+                    desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+                    D3D12_HEAP_PROPERTIES heap = {};
+                    heap.Type = D3D12_HEAP_TYPE_DEFAULT;
+
+                    res = device->CreateCommittedResource(
+                        &heap, D3D12_HEAP_FLAG_NONE, &desc,
+                        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, nullptr,
+                        __uuidof(ID3D12Resource), reinterpret_cast<void**>(&local_)
+                    );
+                    if (FAILED(res))
+                    {
+                        local_ = nullptr;
+                        DEBUG_LOG("D3D12 local texture creation failed (%x)", res);
+                        return false;
+                    }
+                }
+
+                for (auto& s : slots_)
+                {
+                    res = device->CreateCommandAllocator(
+                        D3D12_COMMAND_LIST_TYPE_DIRECT,
+                        __uuidof(ID3D12CommandAllocator), reinterpret_cast<void**>(&s.allocator)
+                    );
+                    if (SUCCEEDED(res)) res = device->CreateCommandList(
+                        0, D3D12_COMMAND_LIST_TYPE_DIRECT, s.allocator, nullptr,
+                        __uuidof(ID3D12GraphicsCommandList), reinterpret_cast<void**>(&s.list)
+                    );
+                    if (FAILED(res))
+                    {
+                        DEBUG_LOG("D3D12 command list creation failed (%x)", res);
+                        return false;
+                    }
+                    s.list->Close();
+                }
+
+                return true;
+            }
+
+            bool push(void* source) override
+            {
+                auto texture = reinterpret_cast<ID3D12Resource*>(source);
+                if (!texture) return false;
+
+                auto list = begin();
+                if (!list) return false;
+
+                // Unity puts the source into the copy state before it.
+                transition(list, shared_, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
+                list->CopyResource(shared_, texture);
+                transition(list, shared_, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON);
+
+                UnityGraphicsD3D12ResourceState state = {
+                    texture, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE
+                };
+                submit(list, &state, 1);
+                return true;
+            }
+
+            bool pull() override
+            {
+                if (!local_) return false;
+
+                auto list = begin();
+                if (!list) return false;
+
+                transition(list, shared_, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_SOURCE);
+                transition(list, local_, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+                list->CopyResource(local_, shared_);
+                transition(list, local_, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+                transition(list, shared_, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COMMON);
+
+                UnityGraphicsD3D12ResourceState state = {
+                    local_, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE
+                };
+                submit(list, &state, 1);
+                return true;
+            }
+
+            void* texture() const override
+            {
+                return local_;
+            }
+
+        private:
+
+            // Command list with its allocator, and the frame fence value
+            // after which they can be reused
+            struct Slot
+            {
+                ID3D12CommandAllocator* allocator = nullptr;
+                ID3D12GraphicsCommandList* list = nullptr;
+                UINT64 frame = 0;
+            };
+
+            InteropD3D12& owner_;
+            InteropSurface& surface_;
+            ID3D12Resource* shared_;
+            ID3D12Fence* fence_;
+            ID3D12Resource* local_;
+            Slot slots_[slot_count_];
+            int next_;
+
+            // Start recording into the next command list. It gives up (drops
+            // the frame) rather than waiting when it's still in flight.
+            ID3D12GraphicsCommandList* begin()
+            {
+                auto& slot = slots_[next_];
+                if (slot.frame > owner_.unity_->GetFrameFence()->GetCompletedValue()) return nullptr;
+                if (FAILED(slot.allocator->Reset())) return nullptr;
+                if (FAILED(slot.list->Reset(slot.allocator, nullptr))) return nullptr;
+                return slot.list;
+            }
+
+            // Execute the list between the waits for the surface fence.
+            void submit(ID3D12GraphicsCommandList* list, UnityGraphicsD3D12ResourceState* states, int count)
+            {
+                auto& unity = *owner_.unity_;
+                auto queue = unity.GetCommandQueue();
+                list->Close();
+                queue->Wait(fence_, surface_.value());
+                slots_[next_].frame = unity.ExecuteCommandList(list, count, states);
+                queue->Signal(fence_, surface_.next());
+                next_ = (next_ + 1) % slot_count_;
+            }
+
+            static void transition(
+                ID3D12GraphicsCommandList* list, ID3D12Resource* resource,
+                D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after
+            )
+            {
+                D3D12_RESOURCE_BARRIER barrier = {};
+                barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+                barrier.Transition.pResource = resource;
+                barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+                barrier.Transition.StateBefore = before;
+                barrier.Transition.StateAfter = after;
+                list->ResourceBarrier(1, &barrier);
+            }
+        };
+    };
+}
\ No newline at end of file
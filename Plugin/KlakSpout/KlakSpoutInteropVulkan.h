@@ -0,0 +1,769 @@
+#pragma once
+
+#include "KlakSpoutInterop.h"
+#include <cstring>
+#include <vector>
+
+#define VK_NO_PROTOTYPES
+#define VK_USE_PLATFORM_WIN32_KHR
+#include "Unity/IUnityGraphicsVulkan.h"
+
+namespace klakspout
+{
+    // Vulkan interop backend
+    // Unity's device imports the surface texture as external memory and the
+    // fence as an external semaphore with the NT handles. The extensions for
+    // them are enabled by hooking the device creation, which needs the
+    // plugin to be loaded before the graphics device initialization. The
+    // copy commands are recorded into our own command buffers and submitted
+    // to Unity's graphics queue. The events that use it have to be
+    // configured with configureEvent(), so that Unity has submitted its
+    // commands before them.
+    class InteropVulkan final : public Interop
+    {
+    public:
+
+        // Install the device creation hook. It has to be called before the
+        // device initialization event.
+        static bool interceptInitialization(IUnityGraphicsVulkan* unity)
+        {
+            return unity->InterceptInitialization(onInitialize, nullptr);
+        }
+
+        // Create the backend with Unity's device. Returns null when the
+        // external memory/semaphore functions are unavailable (e.g. the hook
+        // has been installed too late).
+        static std::unique_ptr<InteropVulkan> create(IUnityGraphicsVulkan* unity)
+        {
+            auto backend = std::unique_ptr<InteropVulkan>(new InteropVulkan(unity));
+            if (!backend->load()) return nullptr;
+            return backend;
+        }
+
+        ~InteropVulkan()
+        {
+            // The device is shutting down, so nothing is in use anymore.
+            for (auto& r : retired_) r.release();
+        }
+
+        // Prohibit use of default constructor and copy operators
+        InteropVulkan() = delete;
+        InteropVulkan(InteropVulkan&) = delete;
+        InteropVulkan& operator = (const InteropVulkan&) = delete;
+
+        // Adapter of Unity's device. Returns false when unknown.
+        bool getAdapterLuid(LUID& luid) const
+        {
+            VkPhysicalDeviceIDProperties id = {};
+            id.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+            VkPhysicalDeviceProperties2 props = {};
+            props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            props.pNext = &id;
+
+            vk_.GetPhysicalDeviceProperties2(instance_.physicalDevice, &props);
+            if (!id.deviceLUIDValid) return false;
+
+            static_assert(sizeof(luid) == VK_LUID_SIZE, "LUID size mismatch");
+            std::memcpy(&luid, id.deviceLUID, sizeof(luid));
+            return true;
+        }
+
+        // Let Unity submit its commands and give us the graphics queue in the
+        // event, outside a render pass.
+        void configureEvent(int event_id)
+        {
+            UnityVulkanPluginEventConfig config = {};
+            config.renderPassPrecondition = kUnityVulkanRenderPass_EnsureOutside;
+            config.graphicsQueueAccess = kUnityVulkanGraphicsQueueAccess_Allow;
+            config.flags = kUnityVulkanEventConfigFlag_FlushCommandBuffers |
+                           kUnityVulkanEventConfigFlag_SyncWorkerThreads;
+            unity_->ConfigureEvent(event_id, &config);
+        }
+
+        std::unique_ptr<InteropBinding> bind(InteropSurface& surface, bool receiver) override
+        {
+            collect();
+            auto binding = std::make_unique<Binding>(*this, surface);
+            if (!binding->open(receiver)) return nullptr;
+            return binding;
+        }
+
+        void collect() override
+        {
+            UnityVulkanRecordingState state;
+            if (!unity_->CommandRecordingState(&state, kUnityVulkanGraphicsQueueAccess_DontCare)) return;
+
+            for (auto it = retired_.begin(); it != retired_.end();)
+            {
+                if (it->frame > state.safeFrameNumber) { ++it; continue; }
+                it->release();
+                it = retired_.erase(it);
+            }
+        }
+
+    private:
+
+        // Frames that a retired object is kept for (the main thread may still
+        // sample the local image until it notices the change)
+        static constexpr unsigned long long retire_frames_ = 3;
+
+        // Number of the command buffers in flight for each binding
+        static constexpr int slot_count_ = 3;
+
+        // Device functions (loaded from Unity's device)
+        struct Functions
+        {
+            PFN_vkGetPhysicalDeviceProperties2 GetPhysicalDeviceProperties2;
+            PFN_vkGetPhysicalDeviceMemoryProperties GetPhysicalDeviceMemoryProperties;
+            PFN_vkCreateImage CreateImage;
+            PFN_vkDestroyImage DestroyImage;
+            PFN_vkGetImageMemoryRequirements GetImageMemoryRequirements;
+            PFN_vkAllocateMemory AllocateMemory;
+            PFN_vkFreeMemory FreeMemory;
+            PFN_vkBindImageMemory BindImageMemory;
+            PFN_vkGetMemoryWin32HandlePropertiesKHR GetMemoryWin32HandlePropertiesKHR;
+            PFN_vkCreateSemaphore CreateSemaphore;
+            PFN_vkDestroySemaphore DestroySemaphore;
+            PFN_vkImportSemaphoreWin32HandleKHR ImportSemaphoreWin32HandleKHR;
+            PFN_vkCreateCommandPool CreateCommandPool;
+            PFN_vkDestroyCommandPool DestroyCommandPool;
+            PFN_vkAllocateCommandBuffers AllocateCommandBuffers;
+            PFN_vkCreateFence CreateFence;
+            PFN_vkDestroyFence DestroyFence;
+            PFN_vkGetFenceStatus GetFenceStatus;
+            PFN_vkResetFences ResetFences;
+            PFN_vkWaitForFences WaitForFences;
+            PFN_vkResetCommandBuffer ResetCommandBuffer;
+            PFN_vkBeginCommandBuffer BeginCommandBuffer;
+            PFN_vkEndCommandBuffer EndCommandBuffer;
+            PFN_vkCmdPipelineBarrier CmdPipelineBarrier;
+            PFN_vkCmdCopyImage CmdCopyImage;
+            PFN_vkQueueSubmit QueueSubmit;
+        };
+
+        // Object released after Unity has finished the frames using it
+        struct Retired
+        {
+            const Functions* vk;
+            VkDevice device;
+            VkImage image;
+            VkDeviceMemory memory;
+            unsigned long long frame;
+
+            void release()
+            {
+                if (image) vk->DestroyImage(device, image, nullptr);
+                if (memory) vk->FreeMemory(device, memory, nullptr);
+            }
+        };
+
+        IUnityGraphicsVulkan* unity_;
+        UnityVulkanInstance instance_;
+        Functions vk_;
+        std::vector<Retired> retired_;
+
+        explicit InteropVulkan(IUnityGraphicsVulkan* unity)
+          : unity_(unity), instance_(unity->Instance()), vk_()
+        {
+        }
+
+        bool load()
+        {
+            auto gipa = instance_.getInstanceProcAddr;
+            auto gdpa = reinterpret_cast<PFN_vkGetDeviceProcAddr>(gipa(instance_.instance, "vkGetDeviceProcAddr"));
+            if (!gdpa) return false;
+
+            #define KLAKSPOUT_VK_INSTANCE(name) \
+                vk_.name = reinterpret_cast<PFN_vk##name>(gipa(instance_.instance, "vk" #name))
+            #define KLAKSPOUT_VK_DEVICE(name) \
+                vk_.name = reinterpret_cast<PFN_vk##name>(gdpa(instance_.device, "vk" #name))
+
+            KLAKSPOUT_VK_INSTANCE(GetPhysicalDeviceProperties2);
+            if (!vk_.GetPhysicalDeviceProperties2)
+                vk_.GetPhysicalDeviceProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>
+                    (gipa(instance_.instance, "vkGetPhysicalDeviceProperties2KHR"));
+            KLAKSPOUT_VK_INSTANCE(GetPhysicalDeviceMemoryProperties);
+            KLAKSPOUT_VK_DEVICE(CreateImage);
+            KLAKSPOUT_VK_DEVICE(DestroyImage);
+            KLAKSPOUT_VK_DEVICE(GetImageMemoryRequirements);
+            KLAKSPOUT_VK_DEVICE(AllocateMemory);
+            KLAKSPOUT_VK_DEVICE(FreeMemory);
+            KLAKSPOUT_VK_DEVICE(BindImageMemory);
+            KLAKSPOUT_VK_DEVICE(GetMemoryWin32HandlePropertiesKHR);
+            KLAKSPOUT_VK_DEVICE(CreateSemaphore);
+            KLAKSPOUT_VK_DEVICE(DestroySemaphore);
+            KLAKSPOUT_VK_DEVICE(ImportSemaphoreWin32HandleKHR);
+            KLAKSPOUT_VK_DEVICE(CreateCommandPool);
+            KLAKSPOUT_VK_DEVICE(DestroyCommandPool);
+            KLAKSPOUT_VK_DEVICE(AllocateCommandBuffers);
+            KLAKSPOUT_VK_DEVICE(CreateFence);
+            KLAKSPOUT_VK_DEVICE(DestroyFence);
+            KLAKSPOUT_VK_DEVICE(GetFenceStatus);
+            KLAKSPOUT_VK_DEVICE(ResetFences);
+            KLAKSPOUT_VK_DEVICE(WaitForFences);
+            KLAKSPOUT_VK_DEVICE(ResetCommandBuffer);
+            KLAKSPOUT_VK_DEVICE(BeginCommandBuffer);
+            KLAKSPOUT_VK_DEVICE(EndCommandBuffer);
+            KLAKSPOUT_VK_DEVICE(CmdPipelineBarrier);
+            KLAKSPOUT_VK_DEVICE(CmdCopyImage);
+            KLAKSPOUT_VK_DEVICE(QueueSubmit);
+
+            #undef KLAKSPOUT_VK_INSTANCE
+            #undef KLAKSPOUT_VK_DEVICE
+
+            // All of them are needed.
+            auto table = reinterpret_cast<void* const*>(&vk_);
+            for (size_t i = 0; i < sizeof(vk_) / sizeof(void*); i++)
+            {
+                if (table[i]) continue;
+                DEBUG_LOG("Vulkan interop functions unavailable (%d)", static_cast<int>(i));
+                return false;
+            }
+
+            return true;
+        }
+
+        // Current frame number of Unity's device, used for retiring objects
+        unsigned long long currentFrame() const
+        {
+            UnityVulkanRecordingState state;
+            if (!unity_->CommandRecordingState(&state, kUnityVulkanGraphicsQueueAccess_DontCare)) return 0;
+            return state.currentFrameNumber;
+        }
+
+        // Find a memory type that is allowed in the bits with the properties.
+        int findMemoryType(uint32_t bits, VkMemoryPropertyFlags flags) const
+        {
+            VkPhysicalDeviceMemoryProperties props;
+            vk_.GetPhysicalDeviceMemoryProperties(instance_.physicalDevice, &props);
+            for (uint32_t i = 0; i < props.memoryTypeCount; i++)
+                if ((bits & (1u << i)) && (props.memoryTypes[i].propertyFlags & flags) == flags) return i;
+            return -1;
+        }
+
+        // Vulkan format with the same memory layout as the DXGI one
+        static VkFormat toVkFormat(DXGI_FORMAT format)
+        {
+            switch (format)
+            {
+            case DXGI_FORMAT_R8G8B8A8_UNORM: return VK_FORMAT_R8G8B8A8_UNORM;
+            case DXGI_FORMAT_B8G8R8A8_UNORM: return VK_FORMAT_B8G8R8A8_UNORM;
+            case DXGI_FORMAT_R16G16B16A16_FLOAT: return VK_FORMAT_R16G16B16A16_SFLOAT;
+            case DXGI_FORMAT_R10G10B10A2_UNORM: return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+            default: return VK_FORMAT_UNDEFINED;
+            }
+        }
+
+        //
+        // Device creation hook
+        //
+        // It enables the extensions for the interop on the device that Unity
+        // creates. Only the ones that the physical device supports are added,
+        // so that the device creation never fails because of them.
+        //
+
+        struct Hook
+        {
+            PFN_vkGetInstanceProcAddr getInstanceProcAddr;
+            PFN_vkCreateDevice createDevice;
+            PFN_vkEnumerateDeviceExtensionProperties enumerateExtensions;
+        };
+
+        static Hook& hook()
+        {
+            static Hook instance = {};
+            return instance;
+        }
+
+        static PFN_vkGetInstanceProcAddr UNITY_INTERFACE_API onInitialize(PFN_vkGetInstanceProcAddr gipa, void*)
+        {
+            hook().getInstanceProcAddr = gipa;
+            return hookedGetInstanceProcAddr;
+        }
+
+        static PFN_vkVoidFunction VKAPI_PTR hookedGetInstanceProcAddr(VkInstance instance, const char* name)
+        {
+            auto& h = hook();
+            if (!instance || std::strcmp(name, "vkCreateDevice") != 0)
+                return h.getInstanceProcAddr(instance, name);
+
+            h.createDevice = reinterpret_cast<PFN_vkCreateDevice>(h.getInstanceProcAddr(instance, "vkCreateDevice"));
+            h.enumerateExtensions = reinterpret_cast<PFN_vkEnumerateDeviceExtensionProperties>
+                (h.getInstanceProcAddr(instance, "vkEnumerateDeviceExtensionProperties"));
+            return reinterpret_cast<PFN_vkVoidFunction>(hookedCreateDevice);
+        }
+
+        static VkResult VKAPI_PTR hookedCreateDevice(
+            VkPhysicalDevice physical_device, const VkDeviceCreateInfo* info,
+            const VkAllocationCallbacks* allocator, VkDevice* device
+        )
+        {
+            auto& h = hook();
+
+            static const char* const required[] = {
+                VK_KHR_EXTERNAL_MEMORY_EXTENSION_NAME,
+                VK_KHR_EXTERNAL_MEMORY_WIN32_EXTENSION_NAME,
+                VK_KHR_EXTERNAL_SEMAPHORE_EXTENSION_NAME,
+                VK_KHR_EXTERNAL_SEMAPHORE_WIN32_EXTENSION_NAME,
+                VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME,
+                VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME
+            };
+
+            uint32_t count = 0;
+            h.enumerateExtensions(physical_device, nullptr, &count, nullptr);
+            std::vector<VkExtensionProperties> available(count);
+            h.enumerateExtensions(physical_device, nullptr, &count, available.data());
+
+            std::vector<const char*> names(info->ppEnabledExtensionNames,
+                                           info->ppEnabledExtensionNames + info->enabledExtensionCount);
+
+            for (auto name : required)
+            {
+                auto listed = false;
+                for (auto n : names) listed |= std::strcmp(n, name) == 0;
+
+                auto supported = false;
+                for (auto& e : available) supported |= std::strcmp(e.extensionName, name) == 0;
+
+                if (!listed && supported) names.push_back(name);
+            }
+
+            auto modified = *info;
+            modified.enabledExtensionCount = static_cast<uint32_t>(names.size());
+            modified.ppEnabledExtensionNames = names.data();
+            return h.createDevice(physical_device, &modified, allocator, device);
+        }
+
+        //
+        // Single surface binding
+        //
+
+        class Binding final : public InteropBinding
+        {
+        public:
+
+            Binding(InteropVulkan& owner, InteropSurface& surface)
+              : owner_(owner), surface_(surface),
+                shared_image_(VK_NULL_HANDLE), shared_memory_(VK_NULL_HANDLE),
+                local_image_(VK_NULL_HANDLE), local_memory_(VK_NULL_HANDLE),
+                semaphore_(VK_NULL_HANDLE), pool_(VK_NULL_HANDLE), slots_(), next_(0)
+            {
+            }
+
+            ~Binding()
+            {
+                auto& vk = owner_.vk_;
+                auto device = owner_.instance_.device;
+
+                // The surface has waited for the fence, so the command
+                // buffers only have to be retired here.
+                for (auto& s : slots_)
+                {
+                    if (!s.fence) continue;
+                    vk.WaitForFences(device, 1, &s.fence, VK_TRUE, UINT64_MAX);
+                    vk.DestroyFence(device, s.fence, nullptr);
+                }
+
+                if (pool_) vk.DestroyCommandPool(device, pool_, nullptr);
+                if (semaphore_) vk.DestroySemaphore(device, semaphore_, nullptr);
+                if (shared_image_) vk.DestroyImage(device, shared_image_, nullptr);
+                if (shared_memory_) vk.FreeMemory(device, shared_memory_, nullptr);
+
+                // The local image may still be sampled by Unity.
+                if (local_image_ || local_memory_)
+                    owner_.retired_.push_back({ &vk, device, local_image_, local_memory_, owner_.currentFrame() + retire_frames_ });
+            }
+
+            // Prohibit use of copy operators
+            Binding(Binding&) = delete;
+            Binding& operator = (const Binding&) = delete;
+
+            bool open(bool receiver)
+            {
+                auto& vk = owner_.vk_;
+                auto device = owner_.instance_.device;
+
+                format_ = toVkFormat(surface_.format());
+                extent_ = { static_cast<uint32_t>(surface_.width()), static_cast<uint32_t>(surface_.height()), 1 };
+                if (format_ == VK_FORMAT_UNDEFINED) return false;
+
+                if (!importTexture() || !importFence()) return false;
+
+                VkCommandPoolCreateInfo pool_info = {};
+                pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+                pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+                pool_info.queueFamilyIndex = owner_.instance_.queueFamilyIndex;
+                if (vk.CreateCommandPool(device, &pool_info, nullptr, &pool_) != VK_SUCCESS)
+                {
+                    pool_ = VK_NULL_HANDLE;
+                    return false;
+                }
+
+                for (auto& s : slots_)
+                {
+                    VkCommandBufferAllocateInfo alloc_info = {};
+                    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+                    alloc_info.commandPool = pool_;
+                    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+                    alloc_info.commandBufferCount = 1;
+                    if (vk.AllocateCommandBuffers(device, &alloc_info, &s.buffer) != VK_SUCCESS) return false;
+
+                    VkFenceCreateInfo fence_info = {};
+                    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+                    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+                    if (vk.CreateFence(device, &fence_info, nullptr, &s.fence) != VK_SUCCESS)
+                    {
+                        s.fence = VK_NULL_HANDLE;
+                        return false;
+                    }
+                }
+
+                // Local image that Unity samples (receivers)
+                // It's always left in the shader read-only layout.
+                return !receiver || createLocalImage();
+            }
+
+            bool push(void* source) override
+            {
+                if (!source) return false;
+
+                // The source layout is only observed; the barriers are in our
+                // command buffer, which is submitted after Unity's ones.
+                UnityVulkanImage image;
+                if (!owner_.unity_->AccessTexture(
+                        source, UnityVulkanWholeImage, VK_IMAGE_LAYOUT_UNDEFINED, 0, 0,
+                        kUnityVulkanResourceAccess_ObserveOnly, &image)) return false;
+
+                auto buffer = begin();
+                if (!buffer) return false;
+
+                VkImageMemoryBarrier barriers[2];
+                barriers[0] = barrier(image.image, image.layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                      VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+                barriers[1] = acquire(shared_image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT);
+                pipelineBarrier(buffer, barriers, 2);
+
+                copy(buffer, image.image, shared_image_);
+
+                barriers[0] = barrier(image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.layout,
+                                      VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_MEMORY_READ_BIT);
+                barriers[1] = release(shared_image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT);
+                pipelineBarrier(buffer, barriers, 2);
+
+                return submit(buffer);
+            }
+
+            bool pull() override
+            {
+                if (!local_image_) return false;
+
+                auto buffer = begin();
+                if (!buffer) return false;
+
+                VkImageMemoryBarrier barriers[2];
+                barriers[0] = acquire(shared_image_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT);
+                barriers[1] = barrier(local_image_, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                      VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+                pipelineBarrier(buffer, barriers, 2);
+
+                copy(buffer, shared_image_, local_image_);
+
+                barriers[0] = release(shared_image_, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT);
+                barriers[1] = barrier(local_image_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                      VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+                pipelineBarrier(buffer, barriers, 2);
+
+                return submit(buffer);
+            }
+
+            void* texture() const override
+            {
+                // Unity takes a pointer to VkImage as the native texture.
+                return local_image_ ? const_cast<VkImage*>(&local_image_) : nullptr;
+            }
+
+        private:
+
+            struct Slot
+            {
+                VkCommandBuffer buffer = VK_NULL_HANDLE;
+                VkFence fence = VK_NULL_HANDLE;
+            };
+
+            InteropVulkan& owner_;
+            InteropSurface& surface_;
+            VkFormat format_;
+            VkExtent3D extent_;
+            VkImage shared_image_;
+            VkDeviceMemory shared_memory_;
+            VkImage local_image_;
+            VkDeviceMemory local_memory_;
+            VkSemaphore semaphore_;
+            VkCommandPool pool_;
+            Slot slots_[slot_count_];
+            int next_;
+
+            VkImageCreateInfo imageInfo(VkImageUsageFlags usage) const
+            {
+                VkImageCreateInfo info = {};
+                info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+                info.imageType = VK_IMAGE_TYPE_2D;
+                info.format = format_;
+                info.extent = extent_;
+                info.mipLevels = 1;
+                info.arrayLayers = 1;
+                info.samples = VK_SAMPLE_COUNT_1_BIT;
+                info.tiling = VK_IMAGE_TILING_OPTIMAL;
+                info.usage = usage;
+                info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+                info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                return info;
+            }
+
+            // Import the surface texture as a dedicated allocation.
+            bool importTexture()
+            {
+                auto& vk = owner_.vk_;
+                auto device = owner_.instance_.device;
+                const auto type = VK_EXTERNAL_MEMORY_HANDLE_TYPE_D3D11_TEXTURE_BIT;
+
+                VkExternalMemoryImageCreateInfo external = {};
+                external.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO;
+                external.handleTypes = type;
+
+                auto info = imageInfo(VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+                info.pNext = &external;
+
+                if (vk.CreateImage(device, &info, nullptr, &shared_image_) != VK_SUCCESS)
+                {
+                    shared_image_ = VK_NULL_HANDLE;
+                    DEBUG_LOG("Vulkan shared image creation failed (%d)", format_);
+                    return false;
+                }
+
+                VkMemoryWin32HandlePropertiesKHR handle_props = {};
+                handle_props.sType = VK_STRUCTURE_TYPE_MEMORY_WIN32_HANDLE_PROPERTIES_KHR;
+                if (vk.GetMemoryWin32HandlePropertiesKHR(device, type, surface_.textureHandle(), &handle_props) != VK_SUCCESS)
+                    return false;
+
+                VkMemoryRequirements req;
+                vk.GetImageMemoryRequirements(device, shared_image_, &req);
+
+                auto index = owner_.findMemoryType(req.memoryTypeBits & handle_props.memoryTypeBits, 0);
+                if (index < 0) return false;
+
+                VkMemoryDedicatedAllocateInfo dedicated = {};
+                dedicated.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+                dedicated.image = shared_image_;
+
+                VkImportMemoryWin32HandleInfoKHR import = {};
+                import.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_WIN32_HANDLE_INFO_KHR;
+                import.pNext = &dedicated;
+                import.handleType = type;
+                import.handle = surface_.textureHandle();
+
+                VkMemoryAllocateInfo alloc = {};
+                alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+                alloc.pNext = &import;
+                alloc.allocationSize = req.size;
+                alloc.memoryTypeIndex = index;
+
+                if (vk.AllocateMemory(device, &alloc, nullptr, &shared_memory_) != VK_SUCCESS)
+                {
+                    shared_memory_ = VK_NULL_HANDLE;
+                    DEBUG_LOG("Vulkan shared memory import failed (%d)", index);
+                    return false;
+                }
+
+                return vk.BindImageMemory(device, shared_image_, shared_memory_, 0) == VK_SUCCESS;
+            }
+
+            // Import the surface fence as a semaphore. The fence values are
+            // given on every submission.
+            bool importFence()
+            {
+                auto& vk = owner_.vk_;
+                auto device = owner_.instance_.device;
+
+                VkSemaphoreCreateInfo info = {};
+                info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+                if (vk.CreateSemaphore(device, &info, nullptr, &semaphore_) != VK_SUCCESS)
+                {
+                    semaphore_ = VK_NULL_HANDLE;
+                    return false;
+                }
+
+                VkImportSemaphoreWin32HandleInfoKHR import = {};
+                import.sType = VK_STRUCTURE_TYPE_IMPORT_SEMAPHORE_WIN32_HANDLE_INFO_KHR;
+                import.semaphore = semaphore_;
+                import.handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_D3D12_FENCE_BIT;
+                import.handle = surface_.fenceHandle();
+
+                if (vk.ImportSemaphoreWin32HandleKHR(device, &import) != VK_SUCCESS)
+                {
+                    DEBUG_LOG("Vulkan fence import failed (%d)", 0);
+                    return false;
+                }
+
+                return true;
+            }
+
+            bool createLocalImage()
+            {
+                auto& vk = owner_.vk_;
+                auto device = owner_.instance_.device;
+
+                auto info = imageInfo(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+                if (vk.CreateImage(device, &info, nullptr, &local_image_) != VK_SUCCESS)
+                {
+                    local_image_ = VK_NULL_HANDLE;
+                    return false;
+                }
+
+                VkMemoryRequirements req;
+                vk.GetImageMemoryRequirements(device, local_image_, &req);
+
+                auto index = owner_.findMemoryType(req.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+                if (index < 0) return false;
+
+                VkMemoryAllocateInfo alloc = {};
+                alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+                alloc.allocationSize = req.size;
+                alloc.memoryTypeIndex = index;
+
+                if (vk.AllocateMemory(device, &alloc, nullptr, &local_memory_) != VK_SUCCESS)
+                {
+                    local_memory_ = VK_NULL_HANDLE;
+                    return false;
+                }
+
+                if (vk.BindImageMemory(device, local_image_, local_memory_, 0) != VK_SUCCESS) return false;
+
+                // Initial layout transition
+                auto buffer = begin();
+                if (!buffer) return false;
+                auto b = barrier(local_image_, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 0, VK_ACCESS_SHADER_READ_BIT);
+                pipelineBarrier(buffer, &b, 1);
+                return submit(buffer, false);
+            }
+
+            // Start recording into the next command buffer. It gives up
+            // (drops the frame) rather than waiting when it's still in flight.
+            VkCommandBuffer begin()
+            {
+                auto& vk = owner_.vk_;
+                auto& slot = slots_[next_];
+                if (!slot.buffer || vk.GetFenceStatus(owner_.instance_.device, slot.fence) != VK_SUCCESS) return VK_NULL_HANDLE;
+
+                vk.ResetCommandBuffer(slot.buffer, 0);
+
+                VkCommandBufferBeginInfo info = {};
+                info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+                if (vk.BeginCommandBuffer(slot.buffer, &info) != VK_SUCCESS) return VK_NULL_HANDLE;
+
+                return slot.buffer;
+            }
+
+            // Submit the buffer between the waits for the surface fence.
+            bool submit(VkCommandBuffer buffer, bool sync = true)
+            {
+                auto& vk = owner_.vk_;
+                auto& slot = slots_[next_];
+                auto device = owner_.instance_.device;
+
+                if (vk.EndCommandBuffer(buffer) != VK_SUCCESS) return false;
+                vk.ResetFences(device, 1, &slot.fence);
+
+                const uint64_t wait_value = surface_.value();
+                const uint64_t signal_value = wait_value + 1;
+                const VkPipelineStageFlags stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+                VkD3D12FenceSubmitInfoKHR values = {};
+                values.sType = VK_STRUCTURE_TYPE_D3D12_FENCE_SUBMIT_INFO_KHR;
+                values.waitSemaphoreValuesCount = 1;
+                values.pWaitSemaphoreValues = &wait_value;
+                values.signalSemaphoreValuesCount = 1;
+                values.pSignalSemaphoreValues = &signal_value;
+
+                VkSubmitInfo info = {};
+                info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+                info.pNext = sync ? &values : nullptr;
+                info.waitSemaphoreCount = sync ? 1 : 0;
+                info.pWaitSemaphores = &semaphore_;
+                info.pWaitDstStageMask = &stage;
+                info.commandBufferCount = 1;
+                info.pCommandBuffers = &buffer;
+                info.signalSemaphoreCount = sync ? 1 : 0;
+                info.pSignalSemaphores = &semaphore_;
+
+                auto res = vk.QueueSubmit(owner_.instance_.graphicsQueue, 1, &info, slot.fence);
+                next_ = (next_ + 1) % slot_count_;
+
+                if (res != VK_SUCCESS)
+                {
+                    DEBUG_LOG("Vulkan interop submission failed (%d)", res);
+                    return false;
+                }
+
+                if (sync) surface_.next();
+                return true;
+            }
+
+            void copy(VkCommandBuffer buffer, VkImage src, VkImage dst) const
+            {
+                VkImageCopy region = {};
+                region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+                region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+                region.extent = extent_;
+                owner_.vk_.CmdCopyImage(buffer, src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                        dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+            }
+
+            void pipelineBarrier(VkCommandBuffer buffer, const VkImageMemoryBarrier* barriers, uint32_t count) const
+            {
+                owner_.vk_.CmdPipelineBarrier(buffer,
+                    VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                    0, 0, nullptr, 0, nullptr, count, barriers);
+            }
+
+            static VkImageMemoryBarrier barrier(
+                VkImage image, VkImageLayout from, VkImageLayout to,
+                VkAccessFlags src_access, VkAccessFlags dst_access
+            )
+            {
+                VkImageMemoryBarrier b = {};
+                b.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                b.srcAccessMask = src_access;
+                b.dstAccessMask = dst_access;
+                b.oldLayout = from;
+                b.newLayout = to;
+                b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                b.image = image;
+                b.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+                return b;
+            }
+
+            // Acquire the shared image from our D3D11 device.
+            VkImageMemoryBarrier acquire(VkImage image, VkImageLayout to, VkAccessFlags access) const
+            {
+                auto b = barrier(image, VK_IMAGE_LAYOUT_GENERAL, to, 0, access);
+                b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_EXTERNAL;
+                b.dstQueueFamilyIndex = owner_.instance_.queueFamilyIndex;
+                return b;
+            }
+
+            // Release the shared image to our D3D11 device.
+            VkImageMemoryBarrier release(VkImage image, VkImageLayout from, VkAccessFlags access) const
+            {
+                auto b = barrier(image, from, VK_IMAGE_LAYOUT_GENERAL, access, 0);
+                b.srcQueueFamilyIndex = owner_.instance_.queueFamilyIndex;
+                b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_EXTERNAL;
+                return b;
+            }
+        };
+    };
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+namespace klakspout
+{
+    // Pixel row kernels for the CPU paths (readback and the CPU fallback
+    // transport)
+    // The SSE2 versions are the baseline of x86-64. The AVX2 versions are
+    // compiled with the target attribute and selected with CPUID at run time,
+    // so that the DLL still runs on the CPUs without AVX2.
+    class RowKernels final
+    {
+    public:
+
+        RowKernels() = delete;
+
+        // Check if the AVX2 versions are used. It's always true in the AVX2
+        // tier build (build.sh avx2).
+        static bool hasAvx2()
+        {
+        #if defined(__AVX2__)
+            return true;
+        #else
+            static const bool avx2 = []
+            {
+                __builtin_cpu_init();
+                return __builtin_cpu_supports("avx2") != 0;
+            }();
+            return avx2;
+        #endif
+        }
+
+        // Copy rows between buffers with different pitches. The destination
+        // is written with non-temporal stores, as it's only read by another
+        // thread or process later.
+        static void copy(void* dst, std::size_t dst_pitch, const void* src, std::size_t src_pitch, std::size_t row, int height)
+        {
+            auto d = static_cast<char*>(dst);
+            auto s = static_cast<const char*>(src);
+
+            // Small rows don't benefit from the streaming stores.
+            if (row < streaming_min_)
+            {
+                for (auto y = 0; y < height; y++)
+                    std::memcpy(d + y * dst_pitch, s + y * src_pitch, row);
+                return;
+            }
+
+            if (hasAvx2())
+                for (auto y = 0; y < height; y++) copyAvx2(d + y * dst_pitch, s + y * src_pitch, row);
+            else
+                for (auto y = 0; y < height; y++) copySse2(d + y * dst_pitch, s + y * src_pitch, row);
+
+            _mm_sfence();
+        }
+
+        // Convert R10G10B10A2 rows into R8G8B8A8 with the top 8 bits of each
+        // channel (the values stay gamma-encoded). The width is in pixels.
+        static void convertRgb10a2(void* dst, std::size_t dst_pitch, const void* src, std::size_t src_pitch, int width, int height)
+        {
+            auto d = static_cast<char*>(dst);
+            auto s = static_cast<const char*>(src);
+
+            for (auto y = 0; y < height; y++)
+            {
+                auto drow = reinterpret_cast<std::uint32_t*>(d + y * dst_pitch);
+                auto srow = reinterpret_cast<const std::uint32_t*>(s + y * src_pitch);
+                if (hasAvx2())
+                    convertRgb10a2Avx2(drow, srow, width);
+                else
+                    convertRgb10a2Sse2(drow, srow, width);
+            }
+        }
+
+    private:
+
+        static constexpr std::size_t streaming_min_ = 256; // bytes
+
+        //
+        // Row copy
+        //
+
+        // The head is copied with memcpy up to the alignment boundary of the
+        // destination, and the tail as well.
+        static void copySse2(char* dst, const char* src, std::size_t size)
+        {
+            auto head = alignmentGap(dst, 16, size);
+            std::memcpy(dst, src, head);
+            dst += head; src += head; size -= head;
+
+            for (; size >= 64; size -= 64, dst += 64, src += 64)
+            {
+                auto v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+                auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+                auto v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+                auto v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dst), v0);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), v1);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), v2);
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), v3);
+            }
+
+            for (; size >= 16; size -= 16, dst += 16, src += 16)
+                _mm_stream_si128(reinterpret_cast<__m128i*>(dst),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+
+            std::memcpy(dst, src, size);
+        }
+
+        __attribute__((target("avx2")))
+        static void copyAvx2(char* dst, const char* src, std::size_t size)
+        {
+            auto head = alignmentGap(dst, 32, size);
+            std::memcpy(dst, src, head);
+            dst += head; src += head; size -= head;
+
+            for (; size >= 128; size -= 128, dst += 128, src += 128)
+            {
+                auto v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+                auto v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+                auto v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 64));
+                auto v3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 96));
+                _mm256_stream_si256(reinterpret_cast<__m256i*>(dst), v0);
+                _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 32), v1);
+                _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 64), v2);
+                _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 96), v3);
+            }
+
+            for (; size >= 32; size -= 32, dst += 32, src += 32)
+                _mm256_stream_si256(reinterpret_cast<__m256i*>(dst),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+
+            _mm256_zeroupper();
+            std::memcpy(dst, src, size);
+        }
+
+        static std::size_t alignmentGap(const char* dst, std::size_t align, std::size_t size)
+        {
+            auto gap = (align - (reinterpret_cast<std::uintptr_t>(dst) & (align - 1))) & (align - 1);
+            return gap < size ? gap : size;
+        }
+
+        //
+        // R10G10B10A2 to R8G8B8A8 conversion
+        //
+
+        // The 2-bit alpha is expanded by replicating the bits (0, 85, 170,
+        // 255). All the kernels give the same results as this one.
+        static std::uint32_t convertRgb10a2(std::uint32_t p)
+        {
+            auto a = p & 0xc0000000u;
+            a |= a >> 2;
+            a |= a >> 4;
+            return ((p >> 2) & 0xffu) | ((p >> 4) & 0xff00u) | ((p >> 6) & 0xff0000u) | a;
+        }
+
+        static void convertRgb10a2Sse2(std::uint32_t* dst, const std::uint32_t* src, int width)
+        {
+            const auto mr = _mm_set1_epi32(0xff);
+            const auto mg = _mm_set1_epi32(0xff00);
+            const auto mb = _mm_set1_epi32(0xff0000);
+            const auto ma = _mm_set1_epi32(static_cast<int>(0xc0000000u));
+
+            auto x = 0;
+            for (; x + 4 <= width; x += 4)
+            {
+                auto p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+                auto a = _mm_and_si128(p, ma);
+                a = _mm_or_si128(a, _mm_srli_epi32(a, 2));
+                a = _mm_or_si128(a, _mm_srli_epi32(a, 4));
+                auto rg = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 2), mr),
+                                       _mm_and_si128(_mm_srli_epi32(p, 4), mg));
+                auto ba = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 6), mb), a);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_or_si128(rg, ba));
+            }
+
+            for (; x < width; x++) dst[x] = convertRgb10a2(src[x]);
+        }
+
+        __attribute__((target("avx2")))
+        static void convertRgb10a2Avx2(std::uint32_t* dst, const std::uint32_t* src, int width)
+        {
+            const auto mr = _mm256_set1_epi32(0xff);
+            const auto mg = _mm256_set1_epi32(0xff00);
+            const auto mb = _mm256_set1_epi32(0xff0000);
+            const auto ma = _mm256_set1_epi32(static_cast<int>(0xc0000000u));
+
+            auto x = 0;
+            for (; x + 8 <= width; x += 8)
+            {
+                auto p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x));
+                auto a = _mm256_and_si256(p, ma);
+                a = _mm256_or_si256(a, _mm256_srli_epi32(a, 2));
+                a = _mm256_or_si256(a, _mm256_srli_epi32(a, 4));
+                auto rg = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(p, 2), mr),
+                                          _mm256_and_si256(_mm256_srli_epi32(p, 4), mg));
+                auto ba = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(p, 6), mb), a);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_or_si256(rg, ba));
+            }
+
+            _mm256_zeroupper();
+            for (; x < width; x++) dst[x] = convertRgb10a2(src[x]);
+        }
+    };
+}
\ No newline at end of file
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "KlakSpoutReadback.h"
+#include <cstddef>
+
+namespace klakspout
+{
+    // CPU fallback transport: Sender side
+    // Reads the shared texture back with the staging ring and writes the
+    // frames into the pixel map in turn (triple buffering). It runs only while
+    // receivers keep requesting it. Only used from the render thread.
+    class PixelSender final
+    {
+    public:
+
+        PixelSender() : header_(nullptr)
+        {
+        }
+
+        ~PixelSender()
+        {
+            close();
+        }
+
+        // Prohibit use of copy operators
+        PixelSender(PixelSender&) = delete;
+        PixelSender& operator = (const PixelSender&) = delete;
+
+        // Check if any receiver has requested the pixel map recently.
+        static bool isRequested(SharedTextureInfoExt* ext)
+        {
+            if (!ext) return false;
+            auto request = static_cast<DWORD>(InterlockedCompareExchange(&ext->pixelRequest, 0, 0));
+            return request != 0 && GetTickCount() - request < SPOUT_PIXEL_TIMEOUT;
+        }
+
+        // Check if the pixel map is open.
+        bool isOpen() const
+        {
+            return header_;
+        }
+
+        // Write the completed copies into the pixel map, then start copying
+        // the source texture.
+        void feed(
+            ID3D11DeviceContext* context, const std::string& name,
+            ID3D11Resource* source, int width, int height, DXGI_FORMAT format
+        )
+        {
+            ring_.poll(context, [&](const D3D11_MAPPED_SUBRESOURCE& mapped, unsigned int)
+            {
+                if (open(name)) write(mapped);
+                return true;
+            });
+
+            ring_.copy(context, source, width, height, format);
+        }
+
+        // Close the pixel map and release the staging textures.
+        void close()
+        {
+            map_.Close();
+            header_ = nullptr;
+            ring_.release();
+        }
+
+    private:
+
+        SpoutSharedMemory map_;
+        SharedPixelHeader* header_;
+        StagingRing ring_;
+
+        // Open (or reopen) the pixel map for the current frame size.
+        bool open(const std::string& name)
+        {
+            auto row = ring_.width() * StagingRing::bytesPerPixel(ring_.format());
+            auto slot = row * ring_.height();
+            auto size = static_cast<unsigned int>(sizeof(SharedPixelHeader) + slot * SPOUT_PIXEL_SLOTS);
+
+            // Reuse the map if it's large enough.
+            if (header_ && header_->mapSize >= size)
+            {
+                if (header_->width != static_cast<unsigned int>(ring_.width()) ||
+                    header_->height != static_cast<unsigned int>(ring_.height()) ||
+                    header_->format != static_cast<DWORD>(ring_.format()))
+                    initHeader(size, row, slot);
+                return true;
+            }
+
+            map_.Close();
+            header_ = nullptr;
+
+            auto res = map_.Create((name + SPOUT_PIXEL_SUFFIX).c_str(), size);
+            if (res == SPOUT_CREATE_FAILED)
+            {
+                DEBUG_LOG("Pixel map creation failed (%s)", name.c_str());
+                return false;
+            }
+
+            auto header = reinterpret_cast<SharedPixelHeader*>(map_.Buffer());
+
+            // A previous map that is still held by receivers can be too
+            // small. Wait for them to release it.
+            if (res == SPOUT_ALREADY_EXISTS && header->magic == SPOUT_PIXEL_MAGIC && header->mapSize < size)
+            {
+                map_.Close();
+                return false;
+            }
+
+            header_ = header;
+            initHeader(size, row, slot);
+            return true;
+        }
+
+        // Initialize the header. The magic number is written last so that
+        // receivers don't use a half-initialized header.
+        void initHeader(unsigned int size, int row, int slot)
+        {
+            InterlockedExchange(reinterpret_cast<volatile LONG*>(&header_->magic), 0);
+            InterlockedExchange(&header_->latest, -1);
+            header_->mapSize = size;
+            header_->width = ring_.width();
+            header_->height = ring_.height();
+            header_->format = ring_.format();
+            header_->rowPitch = row;
+            header_->slotSize = slot;
+            InterlockedExchange(reinterpret_cast<volatile LONG*>(&header_->magic), SPOUT_PIXEL_MAGIC);
+        }
+
+        // Write the mapped rows into the slot next to the latest one.
+        void write(const D3D11_MAPPED_SUBRESOURCE& mapped)
+        {
+            auto latest = InterlockedCompareExchange(&header_->latest, 0, 0);
+            auto index = (latest + 1) % SPOUT_PIXEL_SLOTS;
+            auto dst = reinterpret_cast<char*>(header_ + 1) + header_->slotSize * index;
+
+            InterlockedIncrement(&header_->sequence[index]); // odd - writing
+            RowKernels::copy(dst, header_->rowPitch, mapped.pData, mapped.RowPitch, header_->rowPitch, header_->height);
+            InterlockedIncrement(&header_->sequence[index]); // even - done
+
+            InterlockedExchange(&header_->latest, index);
+            InterlockedIncrement(&header_->frameCount);
+        }
+    };
+
+    // CPU fallback transport: Receiver side
+    // Requests the pixel map from the sender, and uploads the latest frame in
+    // it to a local texture. Only used from the render thread.
+    class PixelReceiver final
+    {
+    public:
+
+        PixelReceiver() : header_(nullptr), frame_count_(0)
+        {
+        }
+
+        // Prohibit use of copy operators
+        PixelReceiver(PixelReceiver&) = delete;
+        PixelReceiver& operator = (const PixelReceiver&) = delete;
+
+        // Upload the latest frame to the texture if it's new. Returns false
+        // when there is nothing uploaded.
+        bool update(
+            ID3D11DeviceContext* context, const std::string& name, SharedTextureInfoExt* ext,
+            ID3D11Texture2D* texture, int width, int height, DXGI_FORMAT format
+        )
+        {
+            // Keep the sender feeding the map. Zero means no request.
+            if (ext) InterlockedExchange(&ext->pixelRequest, static_cast<LONG>(GetTickCount() | 1));
+
+            if (!header_)
+            {
+                if (!map_.Open((name + SPOUT_PIXEL_SUFFIX).c_str())) return false;
+                header_ = reinterpret_cast<SharedPixelHeader*>(map_.Buffer());
+            }
+
+            // The sender may be switching the frame size.
+            if (InterlockedCompareExchange(reinterpret_cast<volatile LONG*>(&header_->magic), 0, 0) != SPOUT_PIXEL_MAGIC) return false;
+            if (header_->width != static_cast<unsigned int>(width) ||
+                header_->height != static_cast<unsigned int>(height) ||
+                header_->format != static_cast<DWORD>(format)) return false;
+
+            auto frame = InterlockedCompareExchange(&header_->frameCount, 0, 0);
+            auto index = InterlockedCompareExchange(&header_->latest, 0, 0);
+            if (frame == frame_count_ || index < 0 || index >= SPOUT_PIXEL_SLOTS) return false;
+
+            auto seq = InterlockedCompareExchange(&header_->sequence[index], 0, 0);
+            if (seq & 1) return false;
+
+            // UpdateSubresource copies the data before returning, so the
+            // sequence check after it tells whether the copy was torn.
+            auto src = reinterpret_cast<const char*>(header_ + 1) + header_->slotSize * index;
+            context->UpdateSubresource(texture, 0, nullptr, src, header_->rowPitch, 0);
+
+            if (InterlockedCompareExchange(&header_->sequence[index], 0, 0) != seq) return false;
+
+            frame_count_ = frame;
+            return true;
+        }
+
+        // Close the pixel map.
+        void close()
+        {
+            map_.Close();
+            header_ = nullptr;
+            frame_count_ = 0;
+        }
+
+    private:
+
+        SpoutSharedMemory map_;
+        SharedPixelHeader* header_;
+        LONG frame_count_;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,281 @@
+#pragma once
+
+#include "KlakSpoutGlobals.h"
+#include "KlakSpoutKernels.h"
+#include <atomic>
+#include <vector>
+
+namespace klakspout
+{
+    // Staging texture ring for asynchronous GPU-to-CPU copies
+    // Copies a texture into one of the staging textures, and maps them with
+    // D3D11_MAP_FLAG_DO_NOT_WAIT on later calls, so that the render thread
+    // never waits for the GPU. Only used from the render thread.
+    class StagingRing final
+    {
+    public:
+
+        StagingRing()
+            : width_(0), height_(0), format_(DXGI_FORMAT_UNKNOWN),
+              serial_(0), staging_()
+        {
+        }
+
+        ~StagingRing()
+        {
+            release();
+        }
+
+        // Prohibit use of copy operators
+        StagingRing(StagingRing&) = delete;
+        StagingRing& operator = (const StagingRing&) = delete;
+
+        // Bytes per pixel of the formats used in the shared textures
+        static int bytesPerPixel(DXGI_FORMAT format)
+        {
+            return format == DXGI_FORMAT_R16G16B16A16_FLOAT ? 8 : 4;
+        }
+
+        int width() const { return width_; }
+        int height() const { return height_; }
+        DXGI_FORMAT format() const { return format_; }
+
+        // Copy the source texture into a free staging texture. It drops the
+        // frame when all of them are still in flight.
+        void copy(ID3D11DeviceContext* context, ID3D11Resource* source, int width, int height, DXGI_FORMAT format)
+        {
+            if (width != width_ || height != height_ || format != format_)
+            {
+                release();
+                width_ = width;
+                height_ = height;
+                format_ = format;
+            }
+
+            for (auto& s : staging_)
+            {
+                if (s.pending) continue;
+
+                if (!s.texture)
+                {
+                    auto& g = Globals::get();
+                    if (!g.spout_->CreateDX11StagingTexture(g.d3d11_, width, height, format, &s.texture))
+                    {
+                        s.texture = nullptr;
+                        return;
+                    }
+                }
+
+                context->CopyResource(s.texture, source);
+                s.pending = true;
+                s.serial = ++serial_;
+                return;
+            }
+        }
+
+        // Retrieve the completed copies in order without waiting. The sink is
+        // called with the mapped data and the serial number of the copy, and
+        // returns false to retry it on the next poll.
+        template <typename Sink> void poll(ID3D11DeviceContext* context, Sink sink)
+        {
+            for (;;)
+            {
+                // Oldest pending copy
+                Staging* oldest = nullptr;
+                for (auto& s : staging_)
+                    if (s.pending && (!oldest || s.serial < oldest->serial)) oldest = &s;
+                if (!oldest) return;
+
+                D3D11_MAPPED_SUBRESOURCE mapped;
+                auto res = context->Map(oldest->texture, 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mapped);
+
+                // Not ready yet: The later ones aren't ready either.
+                if (res == DXGI_ERROR_WAS_STILL_DRAWING) return;
+
+                if (FAILED(res))
+                {
+                    oldest->pending = false;
+                    continue;
+                }
+
+                auto done = sink(mapped, oldest->serial);
+                context->Unmap(oldest->texture, 0);
+                if (!done) return;
+
+                oldest->pending = false;
+            }
+        }
+
+        // Release the staging textures.
+        void release()
+        {
+            for (auto& s : staging_)
+            {
+                if (s.texture) s.texture->Release();
+                s = Staging();
+            }
+        }
+
+    private:
+
+        struct Staging
+        {
+            ID3D11Texture2D* texture;
+            bool pending;
+            unsigned int serial;
+        };
+
+        static constexpr int staging_count_ = 3;
+
+        int width_, height_;
+        DXGI_FORMAT format_;
+        unsigned int serial_;
+        Staging staging_[staging_count_];
+    };
+
+    // Asynchronous GPU-to-CPU readback
+    // Reads the shared texture back with the staging ring, and copies the
+    // pixels into a buffer given (and pinned) by the main thread, which is
+    // guarded by a try-lock flag instead of a mutex.
+    class Readback final
+    {
+    public:
+
+        Readback()
+            : buffer_(nullptr), buffer_size_(0), buffer_lock_(false), frame_(0)
+        {
+        }
+
+        // Prohibit use of copy operators
+        Readback(Readback&) = delete;
+        Readback& operator = (const Readback&) = delete;
+
+        //
+        // Main thread functions
+        //
+
+        // Set the destination buffer; Null disables the readback. The
+        // previous buffer is never accessed after this returns.
+        void setBuffer(void* buffer, int size)
+        {
+            while (buffer_lock_.exchange(true, std::memory_order_acquire)) YieldProcessor();
+            buffer_ = buffer;
+            buffer_size_ = size;
+            frame_.store(0, std::memory_order_relaxed);
+            buffer_lock_.store(false, std::memory_order_release);
+        }
+
+        // Try locking the buffer for reading. Returns the serial number of
+        // the frame in the buffer (zero if none yet), or -1 when it's being
+        // written by the render thread.
+        int lockBuffer()
+        {
+            if (buffer_lock_.exchange(true, std::memory_order_acquire)) return -1;
+            return frame_.load(std::memory_order_relaxed);
+        }
+
+        // Unlock the buffer locked with lockBuffer.
+        void unlockBuffer()
+        {
+            buffer_lock_.store(false, std::memory_order_release);
+        }
+
+        //
+        // Render thread functions
+        //
+
+        // Check if a destination buffer is given.
+        bool isEnabled() const
+        {
+            return buffer_.load(std::memory_order_relaxed);
+        }
+
+        // Start copying the source texture.
+        void copy(ID3D11DeviceContext* context, ID3D11Resource* source, int width, int height, DXGI_FORMAT format)
+        {
+            ring_.copy(context, source, width, height, format);
+        }
+
+        // Retrieve the completed copies. The newest one remains in the
+        // buffer. It retries later if the main thread is reading.
+        void poll(ID3D11DeviceContext* context)
+        {
+            ring_.poll(context, [this](const D3D11_MAPPED_SUBRESOURCE& mapped, unsigned int serial)
+            {
+                if (buffer_lock_.exchange(true, std::memory_order_acquire)) return false;
+                writeBuffer(mapped, serial);
+                buffer_lock_.store(false, std::memory_order_release);
+                return true;
+            });
+        }
+
+    private:
+
+        // Destination buffer (guarded by buffer_lock_)
+        std::atomic<void*> buffer_;
+        int buffer_size_;
+        std::atomic<bool> buffer_lock_;
+        std::atomic<int> frame_;
+
+        StagingRing ring_;
+
+        // Copy the mapped rows into the buffer tightly packed.
+        void writeBuffer(const D3D11_MAPPED_SUBRESOURCE& mapped, unsigned int serial)
+        {
+            auto buffer = buffer_.load(std::memory_order_relaxed);
+            auto row = ring_.width() * StagingRing::bytesPerPixel(ring_.format());
+            if (!buffer || buffer_size_ < row * ring_.height()) return;
+
+            RowKernels::copy(buffer, row, mapped.pData, mapped.RowPitch, row, ring_.height());
+
+            frame_.store(static_cast<int>(serial & 0x7fffffff), std::memory_order_relaxed);
+        }
+    };
+    // CPU-to-GPU upload
+    // Used in the bridge mode, where the sender's source texture lives in
+    // another graphics API. The main thread gives the pixels read back from
+    // it, and the render thread uploads them into the shared texture.
+    class Upload final
+    {
+    public:
+
+        Upload() : lock_(false), pending_(false)
+        {
+        }
+
+        // Prohibit use of copy operators
+        Upload(Upload&) = delete;
+        Upload& operator = (const Upload&) = delete;
+
+        // Store the pixels (main thread). The render thread only holds the
+        // lock while uploading, so the wait is short.
+        void write(const void* data, int size)
+        {
+            while (lock_.exchange(true, std::memory_order_acquire)) YieldProcessor();
+            auto src = static_cast<const char*>(data);
+            buffer_.assign(src, src + size);
+            pending_ = true;
+            lock_.store(false, std::memory_order_release);
+        }
+
+        // Upload the pending pixels into the texture (render thread). It
+        // skips when the main thread is writing them.
+        void apply(ID3D11DeviceContext* context, ID3D11Resource* texture, int width, int height, DXGI_FORMAT format)
+        {
+            if (lock_.exchange(true, std::memory_order_acquire)) return;
+
+            auto pitch = width * StagingRing::bytesPerPixel(format);
+            if (pending_ && buffer_.size() >= static_cast<size_t>(pitch * height))
+                context->UpdateSubresource(texture, 0, nullptr, buffer_.data(), pitch, 0);
+            pending_ = false;
+
+            lock_.store(false, std::memory_order_release);
+        }
+
+    private:
+
+        std::atomic<bool> lock_;
+        std::vector<char> buffer_; // guarded by lock_
+        bool pending_;
+    };
+}
\ No newline at end of file
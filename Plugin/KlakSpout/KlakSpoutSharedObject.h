@@ -1,11 +1,24 @@
 #pragma once
 
 #include "KlakSpoutGlobals.h"
+#include "KlakSpoutBlitter.h"
+#include "KlakSpoutTexturePool.h"
+#include "KlakSpoutDiscovery.h"
+#include "KlakSpoutReadback.h"
+#include "KlakSpoutPixelTransport.h"
+#include "KlakSpoutAtlas.h"
+#include "KlakSpoutStats.h"
+#include "KlakSpoutTextureSlot.h"
+#include "KlakSpoutInterop.h"
+#include <atomic>
+#include <mutex>
 
 namespace klakspout
 {
     // Shared Spout object handler class
-    // Not thread safe. The owner should care about it.
+    // The object is owned by the render thread. The main thread only reads
+    // the published state (atomics) and sets the source texture (and the
+    // atlas regions).
     class SharedObject final
     {
     public:
@@ -16,16 +29,94 @@ namespace klakspout
         // Object attributes
         const std::string name_;
         int width_, height_;
+        DXGI_FORMAT format_;
+
+        // Synchronization option (only used in senders; receivers follow
+        // the texture that the sender created)
+        const bool keyed_mutex_option_;
+
+        // Number of the ring buffers (only used in senders; receivers follow
+        // the sender). The ring buffer mode can't be used with keyed mutexes.
+        const int buffer_count_option_;
 
         // D3D11 objects
         ID3D11Resource* d3d11_resource_;
         ID3D11ShaderResourceView* d3d11_resource_view_;
+        ID3D11ShaderResourceView* d3d11_srgb_view_; // receivers only, optional
+        ID3D11RenderTargetView* d3d11_target_view_;
+        IDXGIKeyedMutex* keyed_mutex_;
+
+        // State published to the main thread
+        // It's updated on the render thread and read without locking. The
+        // view is stored last, so that the attributes read after it are never
+        // older than it.
+        struct PublishedState
+        {
+            std::atomic<ID3D11ShaderResourceView*> resource_view;
+            std::atomic<ID3D11ShaderResourceView*> srgb_view; // receivers only
+            std::atomic<int> width, height, format;
+            std::atomic<bool> keyed_mutex;
+            std::atomic<bool> valid;
+            std::atomic<bool> cpu_transport;
+            std::atomic<bool> interop;
+            std::atomic<void*> native_texture; // receivers with the interop
+        } published_;
+
+        // CPU readback (only used in receivers)
+        // The buffer functions can be called from the main thread.
+        Readback readback_;
+
+        // CPU upload (only used in senders in the bridge mode without the
+        // interop surface)
+        // The write function can be called from the main thread.
+        Upload upload_;
+
+        // Statistics (updated on the render thread, readable from any
+        // thread)
+        Stats stats_;
 
         // Constructor
-        SharedObject(Type type, const string& name, int width = -1, int height = -1)
+        SharedObject(
+            Type type, const string& name, int width = -1, int height = -1,
+            DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN, bool keyed_mutex = false,
+            int buffer_count = 1, bool atlas = false
+        )
             : type_(type), name_(name), width_(width), height_(height),
-              d3d11_resource_(nullptr), d3d11_resource_view_(nullptr)
+              format_(format), keyed_mutex_option_(keyed_mutex),
+              buffer_count_option_(buffer_count),
+              d3d11_resource_(nullptr), d3d11_resource_view_(nullptr), d3d11_srgb_view_(nullptr),
+              d3d11_target_view_(nullptr), keyed_mutex_(nullptr),
+              discovery_version_(0), received_frame_(0), latency_frame_(0), timestamps_(false),
+              mirror_interval_(1), mirror_frames_(0),
+              locked_(false), retired_(false),
+              source_view_(nullptr), source_view_texture_(nullptr),
+              target_view_(nullptr), target_view_texture_(nullptr),
+              info_open_(false), share_handle_(nullptr),
+              ring_count_(0), ring_latest_(-1), ring_advertised_(0),
+              sender_textures_(), receiver_textures_(), ring_handles_(),
+              readback_frame_(0), snapshot_texture_(nullptr), snapshot_view_(nullptr), snapshot_frame_(0),
+              pixel_texture_(nullptr), pixel_uploads_(0), interop_source_(nullptr),
+              source_rect_(0), atlas_dirty_(false), atlas_names_(), atlas_rects_(), atlas_count_(0)
         {
+            // Atlas senders allocate all the slots up front, so that the main
+            // thread can access them without synchronization.
+            if (atlas && type_ == Type::sender)
+            {
+                atlas_slots_ = std::make_unique<AtlasSlot[]>(SPOUT_ATLAS_MAX);
+                atlas_regions_.reserve(SPOUT_ATLAS_MAX);
+            }
+
+            published_.resource_view = nullptr;
+            published_.srgb_view = nullptr;
+            published_.width = width;
+            published_.height = height;
+            published_.format = format;
+            published_.keyed_mutex = false;
+            published_.valid = true;
+            published_.cpu_transport = false;
+            published_.interop = false;
+            published_.native_texture = nullptr;
+
             if (type_ == Type::sender)
                 DEBUG_LOG("Sender created (%s)", name_.c_str());
             else
@@ -36,6 +127,9 @@ namespace klakspout
         ~SharedObject()
         {
             releaseInternals();
+            releaseSourceView();
+            releaseTargetView();
+            releaseAtlasViews();
 
             if (type_ == Type::sender)
                 DEBUG_LOG("Sender disposed (%s)", name_.c_str());
@@ -54,62 +148,1245 @@ namespace klakspout
             return d3d11_resource_;
         }
 
-        // Validate the internal resources.
+        // Validate the internal resources. The connection of a receiver is
+        // validated on the discovery thread, so this only loads the result.
         bool isValid() const
         {
-            // Nothing to validate for senders.
-            if (type_ == Type::sender) return true;
-
-            // Non-active objects have nothing to validate.
-            if (!isActive()) return true;
-
-            auto& g = Globals::get();
-
-            // This must be an active receiver, so check if the connection to
-            // the sender is still valid.
-            unsigned int width, height;
-            HANDLE handle;
-            DWORD format;
-            auto found = g.sender_names_->CheckSender(name_.c_str(), width, height, handle, format);
-            return found && width_ == width && height_ == height;
+            return !connection_ || connection_->isValid();
         }
 
         // Try activating the object. Returns false when failed.
         bool activate()
         {
             assert(d3d11_resource_ == nullptr && d3d11_resource_view_ == nullptr);
-            return type_ == Type::sender ? setupSender() : setupReceiver();
+            auto res = type_ == Type::sender ? setupSender() : setupReceiver();
+            if (res) watchConnection();
+            publishState();
+            stats_.countActivation(res);
+            return res;
         }
 
         // Deactivate the object and release its internal resources.
         void deactivate()
         {
             releaseInternals();
+            publishState();
+        }
+
+        // Prepare for deferred destruction: Give up the sender name (it's
+        // appended to the list to be released in a batch) and the sender
+        // info map, so that a new sender can take over the name before this
+        // object is destroyed. No other call is allowed after this.
+        void retire(std::vector<std::string>& names)
+        {
+            if (type_ != Type::sender || retired_) return;
+            retired_ = true;
+
+            if (!d3d11_resource_) return;
+            names.push_back(name_);
+
+            // Stop advertising the ring buffers and the heartbeat.
+            auto ext = spoutSenderNames::getSharedInfoExt(sender_info_);
+            if (ext) InterlockedExchange(&ext->ringCount, 0);
+            unwatchConnection();
+            sender_info_.Close();
+        }
+
+        // Per-frame update on the render thread: Try activating if not yet
+        // active, otherwise validate the connection.
+        void update()
+        {
+            CpuTimer timer;
+            updateState();
+            stats_.countUpdate(timer.elapsed());
+
+            // Count the new frames from the sender.
+            auto frame = getFrameCount();
+            if (frame != 0 && frame != received_frame_) stats_.countFrameReceived();
+            received_frame_ = frame;
+        }
+
+        // Notify receivers that the sender has updated the shared texture.
+        void present()
+        {
+            if (type_ != Type::sender || !isActive()) return;
+            auto ext = spoutSenderNames::getSharedInfoExt(sender_info_);
+            if (Globals::get().bridge_ && !interop_) applyUpload();
+            feedPixelSender(ext);
+            if (ext && timestamps_.load(std::memory_order_relaxed)) writeTimestamp(ext);
+            if (ext) InterlockedIncrement(&ext->frameCount);
+            stats_.countFrameSent();
+        }
+
+        // Enable/disable the timestamp mode of the sender. It embeds the time
+        // of the copy in the sender info, so that receivers can measure the
+        // latency. This can be called from the main thread.
+        void setTimestampMode(bool enable)
+        {
+            timestamps_.store(enable, std::memory_order_relaxed);
+        }
+
+        // Set the interval (in frames) of the copies into the primary
+        // texture in the ring buffer mode. Zero disables them, which is only
+        // fine when all the receivers read the ring buffers. This can be
+        // called from the main thread.
+        void setMirrorInterval(int interval)
+        {
+            mirror_interval_.store(interval > 0 ? interval : 0, std::memory_order_relaxed);
+        }
+
+        // Set the source texture of the sender. It's used in the next send().
+        // This can be called from the main thread.
+        void setSourceTexture(ID3D11Texture2D* texture, int flags)
+        {
+            source_texture_.set(texture, flags);
+        }
+
+        // Set the source texture for the interop surface (Unity's native
+        // texture in the bridge mode). The caller keeps it alive until the
+        // next send event has been processed. This can be called from the
+        // main thread.
+        void setInteropSource(void* texture)
+        {
+            interop_source_.store(texture, std::memory_order_release);
+        }
+
+        // Copy the source texture into the shared texture on the render
+        // thread, then notify receivers of the new frame.
+        void send(ID3D11DeviceContext* context, Blitter& blitter)
+        {
+            if (type_ != Type::sender || !isActive() || !d3d11_target_view_) return;
+            if (!blitter.isAvailable() || !updateSourceView()) return;
+
+            auto flags = source_texture_.flags();
+
+            if (ring_count_ > 0)
+            {
+                // Ring buffer mode: Draw into the back buffer next to the
+                // latest one, then publish its index. It's also copied into
+                // the primary texture at the mirror interval for the
+                // receivers that don't know the ring. The commands are
+                // flushed to submit them early. Note that it doesn't tell
+                // that they've been completed when a receiver in another
+                // process reads the buffer, and the buffer is redrawn after
+                // ring_count_ frames whether or not a receiver is still
+                // reading it (one frame later with two buffers).
+                auto index = (ring_latest_ + 1) % ring_count_;
+                auto& back = sender_textures_[1 + index];
+                auto interval = mirror_interval_.load(std::memory_order_relaxed);
+                auto mirror = interval > 0 && ++mirror_frames_ >= interval;
+                if (mirror) mirror_frames_ = 0;
+                measureGpu(context, [&]
+                {
+                    blitter.draw(context, source_view_, back.target_view, width_, height_, flags);
+                    if (mirror) context->CopyResource(d3d11_resource_, back.texture);
+                });
+                context->Flush();
+                ring_latest_ = index;
+                auto ext = spoutSenderNames::getSharedInfoExt(sender_info_);
+                if (ext) InterlockedExchange(&ext->ringLatest, index);
+                present();
+                return;
+            }
+
+            // Drop the frame on lock timeout, so that the frame count is only
+            // incremented when the shared texture has actually been updated.
+            lock();
+            if (keyed_mutex_ && !locked_) return;
+
+            measureGpu(context, [&]
+            {
+                blitter.draw(context, source_view_, d3d11_target_view_, width_, height_, flags);
+            });
+            unlock();
+
+            present();
+        }
+
+        // Copy the source texture into the shared texture as it is (the
+        // fallback path without the blitter; the source has the same size
+        // and layout), then notify receivers of the new frame. The frame is
+        // dropped on lock timeout as in send().
+        // With the interop surface (bridge mode), Unity's device copies the
+        // interop source into the surface, then our device copies it into
+        // the shared texture.
+        void sendCopy(ID3D11DeviceContext* context)
+        {
+            if (type_ != Type::sender || !isActive() || ring_count_ > 0) return;
+
+            if (interop_)
+            {
+                auto source = interop_source_.load(std::memory_order_acquire);
+                if (!interop_->binding_->push(source)) return;
+
+                lock();
+                if (keyed_mutex_ && !locked_) return;
+
+                interop_->access(context, [&]
+                {
+                    measureGpu(context, [&]
+                    {
+                        context->CopyResource(d3d11_resource_, interop_->texture());
+                    });
+                });
+                unlock();
+
+                present();
+                return;
+            }
+
+            source_texture_.update();
+            auto source = source_texture_.texture();
+            if (!source) return;
+
+            lock();
+            if (keyed_mutex_ && !locked_) return;
+
+            measureGpu(context, [&]
+            {
+                context->CopyResource(d3d11_resource_, source);
+            });
+            unlock();
+
+            present();
+        }
+
+        // Copy the received frame into the readback buffer on the render
+        // thread. It never waits for the GPU; the copy is retrieved in one of
+        // the later calls.
+        void readback(ID3D11DeviceContext* context)
+        {
+            if (type_ != Type::receiver) return;
+
+            readback_.poll(context);
+            if (!isActive() || !readback_.isEnabled()) return;
+
+            // Skip when the sender hasn't updated the frame. Senders without
+            // the frame count are copied every time.
+            auto frame = getFrameCount();
+            if (frame != 0 && frame == readback_frame_) return;
+
+            // Don't touch the keyed mutex if already locked by the caller.
+            auto was_locked = locked_;
+            lock();
+            if (keyed_mutex_ && !locked_) return; // Retry on the next call
+
+            measureGpu(context, [&]
+            {
+                readback_.copy(context, d3d11_resource_, width_, height_, format_);
+            });
+            readback_frame_ = frame;
+            countLatency(frame);
+
+            if (!was_locked) unlock();
+        }
+
+        // Set the target texture of the receiver. It's used in the next
+        // receive(). This can be called from the main thread.
+        void setTargetTexture(ID3D11Texture2D* texture, int flags)
+        {
+            target_texture_.set(texture, flags);
+        }
+
+        // Convert the received frame into the target texture with the
+        // compute shader on the render thread.
+        void receive(ID3D11DeviceContext* context, Blitter& blitter)
+        {
+            if (type_ != Type::receiver || !isActive()) return;
+            if (!blitter.isComputeAvailable() || !updateTargetView()) return;
+
+            auto flags = target_texture_.flags();
+
+            D3D11_TEXTURE2D_DESC td;
+            target_view_texture_->GetDesc(&td);
+
+            // Source region in UV
+            auto packed = source_rect_.load(std::memory_order_relaxed);
+            auto rect = AtlasRect::unpack(packed);
+            const float uv_rect[] = {
+                static_cast<float>(rect.x) / width_, static_cast<float>(rect.y) / height_,
+                static_cast<float>(rect.width) / width_, static_cast<float>(rect.height) / height_
+            };
+
+            auto was_locked = locked_;
+            lock();
+            if (!keyed_mutex_ || locked_)
+            {
+                measureGpu(context, [&]
+                {
+                    blitter.dispatch(context, d3d11_resource_view_, target_view_,
+                                     td.Width, td.Height, flags, packed != 0 ? uv_rect : nullptr);
+                });
+                countLatency(getFrameCount());
+            }
+            if (!was_locked) unlock();
+        }
+
+        // Copy the shared texture into the snapshot texture on the render
+        // thread (receivers with the keyed mutex). The snapshot is the one
+        // that the main thread samples, so the copy is skipped on lock
+        // timeout, keeping the last complete frame instead of reading the
+        // shared texture without the lock.
+        // Without the keyed mutex, the main thread samples the shared
+        // texture itself, so this only records the frame as consumed.
+        // With the interop surface (bridge mode), the local texture of
+        // Unity's device is the snapshot, which is updated via the surface.
+        void takeSnapshot(ID3D11DeviceContext* context)
+        {
+            if (type_ != Type::receiver || !isActive()) return;
+
+            auto frame = getFrameCount();
+
+            if (interop_)
+            {
+                if (frame != 0 && frame == snapshot_frame_) return;
+
+                auto was_locked = locked_;
+                lock();
+                if (keyed_mutex_ && !locked_) return; // Retry on the next call
+
+                interop_->access(context, [&]
+                {
+                    measureGpu(context, [&]
+                    {
+                        context->CopyResource(interop_->texture(), d3d11_resource_);
+                    });
+                });
+
+                if (!was_locked) unlock();
+
+                if (!interop_->binding_->pull()) return;
+                snapshot_frame_ = frame;
+                countLatency(frame);
+                return;
+            }
+
+            if (!snapshot_texture_)
+            {
+                countLatency(frame);
+                return;
+            }
+
+            // Skip when the sender hasn't updated the frame.
+            if (frame != 0 && frame == snapshot_frame_) return;
+
+            auto was_locked = locked_;
+            lock();
+            if (!locked_) return; // Retry on the next call
+
+            measureGpu(context, [&]
+            {
+                context->CopyResource(snapshot_texture_, d3d11_resource_);
+            });
+            snapshot_frame_ = frame;
+            countLatency(frame);
+
+            if (!was_locked) unlock();
+        }
+
+        // Set the source region of the receiver in texels. It's applied in
+        // the next receive(). An empty rectangle means the whole texture.
+        // This can be called from the main thread.
+        void setSourceRect(const AtlasRect& rect)
+        {
+            source_rect_.store(rect.isEmpty() ? 0 : rect.pack(), std::memory_order_relaxed);
+        }
+
+        // Find a region in the atlas map of the sender. Returns false when
+        // it's not found. This can only be called from the main thread.
+        bool findAtlasRegion(const char* region, AtlasRect& rect)
+        {
+            if (type_ != Type::receiver) return false;
+            return atlas_lookup_.find(name_, region, rect);
+        }
+
+        // Check if it's an atlas sender.
+        bool isAtlas() const
+        {
+            return static_cast<bool>(atlas_slots_);
+        }
+
+        // Set the name and the rectangle of an atlas region. An empty name or
+        // rectangle removes the region. The table is republished in the next
+        // sendAtlas(). This can be called from the main thread.
+        void setAtlasRegion(int index, const char* name, const AtlasRect& rect)
+        {
+            if (!isAtlas() || index < 0 || index >= SPOUT_ATLAS_MAX) return;
+
+            std::lock_guard<std::mutex> lock(atlas_mutex_);
+
+            auto& dst = atlas_names_[index];
+            std::memset(dst, 0, SPOUT_ATLAS_NAME_LEN);
+            if (name) std::strncpy(dst, name, SPOUT_ATLAS_NAME_LEN - 1);
+            atlas_rects_[index] = rect;
+
+            // The table has to cover the highest index in use.
+            atlas_count_ = 0;
+            for (auto i = 0; i < SPOUT_ATLAS_MAX; i++)
+                if (atlas_names_[i][0] && !atlas_rects_[i].isEmpty()) atlas_count_ = i + 1;
+
+            atlas_dirty_.store(true, std::memory_order_release);
+        }
+
+        // Set the source texture of an atlas region. It's used in the next
+        // sendAtlas(). This can be called from the main thread.
+        void setAtlasSource(int index, ID3D11Texture2D* texture, int flags)
+        {
+            if (!isAtlas() || index < 0 || index >= SPOUT_ATLAS_MAX) return;
+            atlas_slots_[index].texture.set(texture, flags);
+        }
+
+        // Draw the source textures into their regions of the shared texture
+        // in a single batch on the render thread, then notify receivers of
+        // the new frame.
+        void sendAtlas(ID3D11DeviceContext* context, Blitter& blitter)
+        {
+            if (!isAtlas() || !isActive() || !d3d11_target_view_) return;
+            if (!blitter.isAvailable()) return;
+
+            applyAtlasRegions();
+
+            // Collect the regions that have their source textures.
+            atlas_regions_.clear();
+            for (auto i = 0; i < static_cast<int>(atlas_layout_.size()); i++)
+            {
+                auto& rect = atlas_layout_[i];
+                auto& slot = atlas_slots_[i];
+                if (rect.isEmpty()) continue;
+                slot.texture.update();
+                if (!updateView(slot.texture.texture(), slot.view, slot.view_texture)) continue;
+                auto flags = slot.texture.flags();
+                atlas_regions_.push_back({ slot.view, rect.x, rect.y, rect.width, rect.height, flags });
+            }
+
+            if (atlas_regions_.empty()) return;
+
+            lock();
+            measureGpu(context, [&]
+            {
+                blitter.drawRegions(context, d3d11_target_view_, atlas_regions_.data(), static_cast<int>(atlas_regions_.size()));
+            });
+            unlock();
+
+            present();
+        }
+
+        // Acquire the keyed mutex of the shared texture before accessing it.
+        // It does nothing when the texture has no keyed mutex.
+        void lock()
+        {
+            if (!keyed_mutex_ || locked_) return;
+            // Give up on timeout rather than stalling the render thread.
+            CpuTimer timer;
+            locked_ = keyed_mutex_->AcquireSync(0, lock_timeout_) == S_OK;
+            stats_.countLock(timer.elapsed(), locked_);
+            if (!locked_) DEBUG_LOG("AcquireSync failed (%s)", name_.c_str());
+        }
+
+        // Release the keyed mutex acquired with lock().
+        void unlock()
+        {
+            if (!locked_) return;
+            keyed_mutex_->ReleaseSync(0);
+            locked_ = false;
+        }
+
+        // Check if the shared texture has a keyed mutex.
+        // This can be called from the main thread.
+        bool hasKeyedMutex() const
+        {
+            return published_.keyed_mutex.load(std::memory_order_acquire);
+        }
+
+        // Get the frame count of the sender. Returns zero when unknown
+        // (not connected yet or the sender doesn't support it).
+        // This can be called from the main thread. It's only available in
+        // receivers, as they keep the sender info map open until destruction.
+        long getFrameCount() const
+        {
+            if (type_ != Type::receiver || !info_open_.load(std::memory_order_acquire)) return 0;
+            // The CPU transport counts its own uploads, as they lag behind.
+            auto uploads = pixel_uploads_.load(std::memory_order_relaxed);
+            if (uploads != 0) return uploads;
+            auto ext = spoutSenderNames::getSharedInfoExt(sender_info_);
+            return ext ? InterlockedCompareExchange(&ext->frameCount, 0, 0) : 0;
         }
 
     private:
 
+        // Version of the discovery watcher at the last activation attempt
+        std::uint32_t discovery_version_;
+
+        // GPU timer for the copy commands, the sender frame count at the
+        // last update, and the last frame whose latency has been counted
+        // (only used for the statistics)
+        GpuTimer gpu_timer_;
+        long received_frame_, latency_frame_;
+
+        // Timestamp mode (only used in senders)
+        std::atomic<bool> timestamps_;
+
+        // Primary texture mirror interval in the ring buffer mode, and the
+        // frames since the last mirror copy (only used in senders)
+        std::atomic<int> mirror_interval_;
+        int mirror_frames_;
+
+        // Keyed mutex state
+        static constexpr DWORD lock_timeout_ = 16; // msec
+        bool locked_;
+
+        // The sender name has been handed over by retire().
+        bool retired_;
+
+        // Source texture (only used in senders)
+        // The texture is given from the main thread, and the view is lazily
+        // created on the render thread. The slot holds a reference to the
+        // texture, so the view texture is never a dangling (or reused)
+        // address.
+        TextureSlot source_texture_;
+        ID3D11ShaderResourceView* source_view_;
+        ID3D11Texture2D* source_view_texture_;
+
+        // Target texture (only used in receivers)
+        // Same as the source texture but with a UAV.
+        TextureSlot target_texture_;
+        ID3D11UnorderedAccessView* target_view_;
+        ID3D11Texture2D* target_view_texture_;
+
+        // Memory map of the sender info
+        // Receivers keep it open once opened, as the main thread reads the
+        // frame count from it. It's only kept with the senders that have the
+        // extension block, as their heartbeat tells when the map outlives the
+        // sender; info_open_ is false with the other senders.
+        mutable SpoutSharedMemory sender_info_;
+        std::atomic<bool> info_open_;
+        HANDLE share_handle_;
+
+        // Connection served on the discovery thread (the heartbeat of the
+        // sender or the validation of the receiver)
+        std::shared_ptr<Connection> connection_;
+
+        // Ring buffers
+        // The first element of the texture arrays is the primary texture
+        // that is registered in the sender info, and the ring buffers follow
+        // it (ring buffer i is at i + 1). ring_count_ is zero in the single
+        // buffer mode. ring_latest_ is the index of the latest ring buffer,
+        // and ring_advertised_ is the ring count that the receiver has seen
+        // in the sender info.
+        int ring_count_, ring_latest_, ring_advertised_;
+        TexturePool::SenderTexture sender_textures_[SPOUT_RING_MAX + 1];
+        TexturePool::ReceiverTexture receiver_textures_[SPOUT_RING_MAX + 1];
+        HANDLE ring_handles_[SPOUT_RING_MAX];
+
+        // Sender frame count at the last readback copy
+        long readback_frame_;
+
+        // Snapshot of the shared texture (only used in receivers with the
+        // keyed mutex)
+        // It's published instead of the shared texture, as the main thread
+        // can't hold the keyed mutex while Unity samples the texture.
+        ID3D11Texture2D* snapshot_texture_;
+        ID3D11ShaderResourceView* snapshot_view_;
+        long snapshot_frame_;
+
+        // CPU fallback transport
+        // Receivers use it when they can't open the shared texture. The
+        // local texture is uploaded from the pixel map that the sender feeds.
+        PixelSender pixel_sender_;
+        PixelReceiver pixel_receiver_;
+        ID3D11Texture2D* pixel_texture_;
+        std::atomic<long> pixel_uploads_;
+
+        // GPU interop (bridge mode)
+        // The frames are exchanged with Unity's device via the surface. The
+        // source of the sender is given from the main thread.
+        std::unique_ptr<InteropSurface> interop_;
+        std::atomic<void*> interop_source_;
+
+        // Source region (only used in receivers, packed AtlasRect)
+        std::atomic<std::uint64_t> source_rect_;
+
+        // Atlas map lookup (only used in receivers on the main thread)
+        AtlasLookup atlas_lookup_;
+
+        // Atlas slots (only used in atlas senders)
+        // The source texture of each slot is given from the main thread in
+        // the same way as the one of the plain sender.
+        struct AtlasSlot
+        {
+            TextureSlot texture;
+            ID3D11ShaderResourceView* view = nullptr;
+            ID3D11Texture2D* view_texture = nullptr;
+        };
+
+        std::unique_ptr<AtlasSlot[]> atlas_slots_;
+
+        // Atlas region settings given from the main thread
+        // They're guarded by the mutex, and the render thread only tries
+        // locking it when they've been changed, so that it never waits.
+        std::mutex atlas_mutex_;
+        std::atomic<bool> atlas_dirty_;
+        char atlas_names_[SPOUT_ATLAS_MAX][SPOUT_ATLAS_NAME_LEN];
+        AtlasRect atlas_rects_[SPOUT_ATLAS_MAX];
+        int atlas_count_;
+
+        // Render thread copy of the region settings and the draw list
+        std::vector<AtlasRect> atlas_layout_;
+        std::vector<Blitter::Region> atlas_regions_;
+        AtlasTable atlas_table_;
+
+        // Measure the GPU time of the commands issued in the function. The
+        // results of the previous measurements are retrieved first.
+        template <typename Commands>
+        void measureGpu(ID3D11DeviceContext* context, Commands commands)
+        {
+            gpu_timer_.poll(context, [this](std::int64_t time) { stats_.countGpu(time); });
+            gpu_timer_.begin(context);
+            commands();
+            gpu_timer_.end(context);
+        }
+
+        // Store the copy time of the frame that is about to be presented.
+        // See SharedTextureInfoExt for the protocol.
+        void writeTimestamp(SharedTextureInfoExt* ext)
+        {
+            auto frame = InterlockedCompareExchange(&ext->frameCount, 0, 0) + 1;
+            InterlockedExchange(&ext->timedFrame, 0);
+            InterlockedExchange64(&ext->frameTime, CpuTimer::ticks());
+            InterlockedExchange(&ext->timedFrame, frame);
+        }
+
+        // Count the latency of a consumed frame (converted, copied for the
+        // readback or sampled by the main thread) when the sender has
+        // embedded its timestamp. Each frame is only counted at its first
+        // consumption. The frames from the CPU transport are numbered
+        // differently, so they're not counted.
+        void countLatency(long frame)
+        {
+            if (frame == 0 || frame == latency_frame_) return;
+            latency_frame_ = frame;
+            if (pixel_uploads_.load(std::memory_order_relaxed) != 0) return;
+
+            auto ext = spoutSenderNames::getSharedInfoExt(sender_info_);
+            if (!ext) return;
+
+            auto timed = InterlockedCompareExchange(&ext->timedFrame, 0, 0);
+            auto time = InterlockedCompareExchange64(&ext->frameTime, 0, 0);
+            if (timed == 0 || timed != frame) return;
+            if (InterlockedCompareExchange(&ext->timedFrame, 0, 0) != timed) return;
+
+            auto now = CpuTimer::ticks();
+            if (now >= time) stats_.countLatency(CpuTimer::toMicroseconds(now - time));
+        }
+
+        // Activation and validation (the body of update())
+        void updateState()
+        {
+            if (isActive())
+            {
+                if (!isValid()) published_.valid.store(false, std::memory_order_release);
+                if (connection_) stats_.countInfoTimeouts(connection_->takeInfoTimeouts());
+                if (pixel_texture_) updatePixelReceiver();
+                else if (type_ == Type::receiver && !keyed_mutex_) updateReceiverRing();
+                return;
+            }
+
+            // Only retry activation when the sender list has been changed.
+            auto& g = Globals::get();
+            if (g.discovery_)
+            {
+                auto version = g.discovery_->version();
+                if (version == discovery_version_) return;
+                discovery_version_ = version;
+            }
+
+            activate();
+        }
+
+        // Upload the pixels given from the main thread (bridge mode).
+        void applyUpload()
+        {
+            auto& g = Globals::get();
+            ID3D11DeviceContext* context;
+            g.d3d11_->GetImmediateContext(&context);
+
+            auto was_locked = locked_;
+            lock();
+            if (!keyed_mutex_ || locked_)
+                upload_.apply(context, d3d11_resource_, width_, height_, format_);
+            if (!was_locked) unlock();
+
+            context->Release();
+        }
+
+        // Feed the latest frame to the pixel map while requested.
+        void feedPixelSender(SharedTextureInfoExt* ext)
+        {
+            if (!PixelSender::isRequested(ext))
+            {
+                if (pixel_sender_.isOpen()) pixel_sender_.close();
+                return;
+            }
+
+            auto& g = Globals::get();
+            ID3D11DeviceContext* context;
+            g.d3d11_->GetImmediateContext(&context);
+
+            auto was_locked = locked_;
+            lock();
+            if (!keyed_mutex_ || locked_)
+            {
+                // The primary texture may not be mirrored in the ring mode.
+                auto& latest = ring_count_ > 0 ? sender_textures_[1 + ring_latest_] : sender_textures_[0];
+                pixel_sender_.feed(context, name_, latest.texture, width_, height_, format_);
+            }
+            if (!was_locked) unlock();
+
+            context->Release();
+        }
+
+        // Upload the latest frame from the pixel map.
+        void updatePixelReceiver()
+        {
+            auto& g = Globals::get();
+            ID3D11DeviceContext* context;
+            g.d3d11_->GetImmediateContext(&context);
+            auto ext = spoutSenderNames::getSharedInfoExt(sender_info_);
+            if (pixel_receiver_.update(context, name_, ext, pixel_texture_, width_, height_, format_))
+                pixel_uploads_.store(pixel_uploads_.load(std::memory_order_relaxed) % 0x7fffffff + 1, std::memory_order_relaxed);
+            context->Release();
+        }
+
+        // Set up the local texture for the CPU fallback transport.
+        bool setupPixelReceiver()
+        {
+            auto& g = Globals::get();
+
+            D3D11_TEXTURE2D_DESC td = {};
+            td.Width = width_;
+            td.Height = height_;
+            td.MipLevels = 1;
+            td.ArraySize = 1;
+            td.Format = format_;
+            td.SampleDesc.Count = 1;
+            td.Usage = D3D11_USAGE_DEFAULT;
+            td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+            auto res = g.d3d11_->CreateTexture2D(&td, nullptr, &pixel_texture_);
+            if (FAILED(res))
+            {
+                pixel_texture_ = nullptr;
+                DEBUG_LOG("Pixel texture creation failed (%s:%x)", name_.c_str(), res);
+                return false;
+            }
+
+            res = g.d3d11_->CreateShaderResourceView(pixel_texture_, nullptr, &d3d11_resource_view_);
+            if (FAILED(res))
+            {
+                d3d11_resource_view_ = nullptr;
+                releasePixelReceiver();
+                DEBUG_LOG("Pixel texture view creation failed (%s:%x)", name_.c_str(), res);
+                return false;
+            }
+
+            d3d11_resource_ = pixel_texture_;
+            return true;
+        }
+
+        // Release the CPU fallback resources of the receiver.
+        void releasePixelReceiver()
+        {
+            pixel_receiver_.close();
+
+            if (d3d11_resource_view_)
+            {
+                d3d11_resource_view_->Release();
+                d3d11_resource_view_ = nullptr;
+            }
+
+            pixel_texture_->Release();
+            pixel_texture_ = nullptr;
+            d3d11_resource_ = nullptr;
+            pixel_uploads_.store(0, std::memory_order_relaxed);
+        }
+
+        // Set up the interop surface with Unity's device (bridge mode). The
+        // object uses the CPU path without it.
+        bool setupInterop()
+        {
+            auto& g = Globals::get();
+            if (!g.interop_) return false;
+
+            auto surface = std::make_unique<InteropSurface>();
+            if (!surface->create(width_, height_, format_)) return false;
+
+            surface->binding_ = g.interop_->bind(*surface, type_ == Type::receiver);
+            if (!surface->binding_) return false;
+
+            interop_ = std::move(surface);
+            snapshot_frame_ = 0;
+            return true;
+        }
+
+        // Set up the snapshot texture with the same format as the shared one.
+        bool setupSnapshot()
+        {
+            auto& g = Globals::get();
+
+            ID3D11Texture2D* shared;
+            if (FAILED(d3d11_resource_->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&shared))))
+                return false;
+
+            D3D11_TEXTURE2D_DESC td;
+            shared->GetDesc(&td);
+            shared->Release();
+
+            td.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+            td.CPUAccessFlags = 0;
+            td.MiscFlags = 0;
+
+            auto res = g.d3d11_->CreateTexture2D(&td, nullptr, &snapshot_texture_);
+            if (FAILED(res))
+            {
+                snapshot_texture_ = nullptr;
+                DEBUG_LOG("Snapshot texture creation failed (%s:%x)", name_.c_str(), res);
+                return false;
+            }
+
+            D3D11_SHADER_RESOURCE_VIEW_DESC vd;
+            d3d11_resource_view_->GetDesc(&vd);
+
+            res = g.d3d11_->CreateShaderResourceView(snapshot_texture_, &vd, &snapshot_view_);
+            if (FAILED(res))
+            {
+                snapshot_view_ = nullptr;
+                releaseSnapshot();
+                DEBUG_LOG("Snapshot view creation failed (%s:%x)", name_.c_str(), res);
+                return false;
+            }
+
+            snapshot_frame_ = 0;
+            return true;
+        }
+
+        // Release the snapshot texture and its view.
+        void releaseSnapshot()
+        {
+            if (snapshot_view_)
+            {
+                snapshot_view_->Release();
+                snapshot_view_ = nullptr;
+            }
+
+            if (snapshot_texture_)
+            {
+                snapshot_texture_->Release();
+                snapshot_texture_ = nullptr;
+            }
+        }
+
+        // Receiver ring buffer update: Switch to the latest buffer that the
+        // sender has published. The ring buffers are only (re)opened when the
+        // sender has changed the advertisement, e.g. after our connection.
+        void updateReceiverRing()
+        {
+            auto ext = spoutSenderNames::getSharedInfoExt(sender_info_);
+            if (!ext) return;
+
+            auto count = InterlockedCompareExchange(&ext->ringCount, 0, 0);
+            if (count != ring_advertised_)
+            {
+                ring_advertised_ = count;
+                releaseRing();
+                useReceiverTexture(receiver_textures_[0]);
+                setupReceiverRing(ext, count);
+                publishState();
+            }
+
+            if (ring_count_ == 0) return;
+
+            auto index = InterlockedCompareExchange(&ext->ringLatest, 0, 0);
+            if (index < 0 || index >= ring_count_ || index == ring_latest_) return;
+
+            ring_latest_ = index;
+            useReceiverTexture(receiver_textures_[1 + index]);
+            publishState();
+        }
+
+        // Switch the receiver to one of the opened textures.
+        void useReceiverTexture(const TexturePool::ReceiverTexture& texture)
+        {
+            d3d11_resource_ = texture.resource;
+            d3d11_resource_view_ = texture.resource_view;
+            d3d11_srgb_view_ = texture.srgb_view;
+        }
+
+        // Allocate the ring (back) buffers for the sender.
+        void setupSenderRing()
+        {
+            auto& g = Globals::get();
+
+            auto count = buffer_count_option_ < SPOUT_RING_MAX ? buffer_count_option_ : SPOUT_RING_MAX;
+            if (count < 2 || keyed_mutex_option_) return;
+
+            for (ring_count_ = 0; ring_count_ < count; ring_count_++)
+            {
+                auto& t = sender_textures_[1 + ring_count_];
+                if (!g.texture_pool_->acquireSender(width_, height_, format_, false, t)) break;
+            }
+
+            // A single back buffer would only add a copy.
+            if (ring_count_ < 2) releaseRing();
+        }
+
+        // Advertise the ring buffers in the sender info. It resets the
+        // previous ones in case the map is reused from another sender.
+        void advertiseRing()
+        {
+            auto ext = spoutSenderNames::getSharedInfoExt(sender_info_);
+
+            if (!ext)
+            {
+                // Receivers can't find the ring buffers without the block.
+                releaseRing();
+                return;
+            }
+
+            InterlockedExchange(&ext->ringCount, 0);
+            for (auto i = 0; i < ring_count_; i++)
+                ext->ringHandles[i] = static_cast<unsigned __int32>(HandleToLong(sender_textures_[1 + i].handle));
+            InterlockedExchange(&ext->ringLatest, 0);
+            InterlockedExchange(&ext->ringCount, ring_count_);
+        }
+
+        // Advertise the adapter of our device in the sender info.
+        void advertiseAdapter()
+        {
+            auto ext = spoutSenderNames::getSharedInfoExt(sender_info_);
+            if (!ext) return;
+            auto& luid = Globals::get().adapter_luid_;
+            ext->adapterLuidLow = luid.LowPart;
+            ext->adapterLuidHigh = luid.HighPart;
+        }
+
+        // Check if the sender advertises an adapter other than ours.
+        bool isOnOtherAdapter() const
+        {
+            auto ext = spoutSenderNames::getSharedInfoExt(sender_info_);
+            if (!ext || (ext->adapterLuidLow == 0 && ext->adapterLuidHigh == 0)) return false;
+            auto& luid = Globals::get().adapter_luid_;
+            if (luid.LowPart == 0 && luid.HighPart == 0) return false;
+            return ext->adapterLuidLow != luid.LowPart || ext->adapterLuidHigh != luid.HighPart;
+        }
+
+        // Open the ring buffers that the sender advertises.
+        void setupReceiverRing(SharedTextureInfoExt* ext, LONG count)
+        {
+            auto& g = Globals::get();
+
+            if (count < 2 || count > SPOUT_RING_MAX) return;
+
+            for (ring_count_ = 0; ring_count_ < count; ring_count_++)
+            {
+                auto handle = LongToHandle(static_cast<long>(ext->ringHandles[ring_count_]));
+                if (!g.texture_pool_->acquireReceiver(handle, receiver_textures_[1 + ring_count_])) break;
+                ring_handles_[ring_count_] = handle;
+            }
+
+            // Use only the primary texture if some of them are unavailable.
+            if (ring_count_ < count) releaseRing();
+        }
+
+        // Release the ring buffers.
+        void releaseRing()
+        {
+            auto& g = Globals::get();
+
+            for (auto i = 0; i < ring_count_; i++)
+            {
+                if (!g.texture_pool_) break;
+                if (type_ == Type::sender)
+                    g.texture_pool_->releaseSender(sender_textures_[1 + i]);
+                else
+                    g.texture_pool_->releaseReceiver(ring_handles_[i]);
+            }
+
+            ring_count_ = 0;
+            ring_latest_ = -1;
+        }
+
+        // Check if the format is supported as a shared texture format.
+        static bool isSupportedFormat(DXGI_FORMAT format)
+        {
+            return format == DXGI_FORMAT_R8G8B8A8_UNORM ||
+                   format == DXGI_FORMAT_B8G8R8A8_UNORM ||
+                   format == DXGI_FORMAT_R16G16B16A16_FLOAT ||
+                   format == DXGI_FORMAT_R10G10B10A2_UNORM;
+        }
+
+        // Determine the view format for a texture. Typeless and sRGB formats
+        // are viewed as UNORM, so the texel values are copied as they are.
+        static DXGI_FORMAT getRawViewFormat(DXGI_FORMAT format)
+        {
+            switch (format)
+            {
+            case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+            case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+                return DXGI_FORMAT_R8G8B8A8_UNORM;
+            case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+            case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+                return DXGI_FORMAT_B8G8R8A8_UNORM;
+            case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+                return DXGI_FORMAT_R10G10B10A2_UNORM;
+            case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+                return DXGI_FORMAT_R16G16B16A16_FLOAT;
+            case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+                return DXGI_FORMAT_R32G32B32A32_FLOAT;
+            default:
+                return format;
+            }
+        }
+
+        // Update the source view if the source texture has been changed.
+        bool updateSourceView()
+        {
+            source_texture_.update();
+            return updateView(source_texture_.texture(), source_view_, source_view_texture_);
+        }
+
+        // Update a shader resource view if the given texture has been changed.
+        bool updateView(
+            ID3D11Texture2D* source,
+            ID3D11ShaderResourceView*& view, ID3D11Texture2D*& view_texture
+        )
+        {
+            if (source == view_texture) return view;
+
+            releaseView(view, view_texture);
+            if (!source) return false;
+
+            D3D11_TEXTURE2D_DESC td;
+            source->GetDesc(&td);
+
+            D3D11_SHADER_RESOURCE_VIEW_DESC vd = {};
+            vd.Format = getRawViewFormat(td.Format);
+            vd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+            vd.Texture2D.MipLevels = 1;
+
+            auto& g = Globals::get();
+            auto res = g.d3d11_->CreateShaderResourceView(source, &vd, &view);
+
+            // Remember the texture even on failure to avoid retrying.
+            view_texture = source;
+
+            if (FAILED(res))
+            {
+                view = nullptr;
+                DEBUG_LOG("Source view creation failed (%s:%x)", name_.c_str(), res);
+                return false;
+            }
+
+            return true;
+        }
+
+        // Release a shader resource view created with updateView().
+        static void releaseView(ID3D11ShaderResourceView*& view, ID3D11Texture2D*& view_texture)
+        {
+            if (view)
+            {
+                view->Release();
+                view = nullptr;
+            }
+            view_texture = nullptr;
+        }
+
+        // Release the views of the atlas slots.
+        void releaseAtlasViews()
+        {
+            if (!isAtlas()) return;
+            for (auto i = 0; i < SPOUT_ATLAS_MAX; i++)
+                releaseView(atlas_slots_[i].view, atlas_slots_[i].view_texture);
+        }
+
+        // Apply the region settings given from the main thread, and publish
+        // them in the atlas map. It's retried in the next call when the main
+        // thread is holding the mutex.
+        void applyAtlasRegions()
+        {
+            if (!atlas_dirty_.load(std::memory_order_acquire)) return;
+
+            std::unique_lock<std::mutex> lock(atlas_mutex_, std::try_to_lock);
+            if (!lock.owns_lock()) return;
+
+            if (!atlas_table_.publish(name_, atlas_names_, atlas_rects_, atlas_count_)) return;
+
+            atlas_layout_.assign(atlas_rects_, atlas_rects_ + atlas_count_);
+            atlas_dirty_.store(false, std::memory_order_relaxed);
+        }
+
+        // Update the target view if the target texture has been changed.
+        // Typeless and sRGB textures are viewed as UNORM, as sRGB UAVs are
+        // not allowed. The flags tell the conversion needed for them.
+        bool updateTargetView()
+        {
+            target_texture_.update();
+            auto target = target_texture_.texture();
+            if (target == target_view_texture_) return target_view_;
+
+            releaseTargetView();
+            if (!target) return false;
+
+            D3D11_TEXTURE2D_DESC td;
+            target->GetDesc(&td);
+
+            // Remember the texture even on failure to avoid retrying.
+            target_view_texture_ = target;
+
+            if (!(td.BindFlags & D3D11_BIND_UNORDERED_ACCESS)) return false;
+
+            D3D11_UNORDERED_ACCESS_VIEW_DESC vd = {};
+            vd.Format = getRawViewFormat(td.Format);
+            vd.ViewDimension = D3D11_UAV_DIMENSION_TEXTURE2D;
+
+            auto& g = Globals::get();
+            auto res = g.d3d11_->CreateUnorderedAccessView(target, &vd, &target_view_);
+
+            if (FAILED(res))
+            {
+                target_view_ = nullptr;
+                DEBUG_LOG("Target view creation failed (%s:%x)", name_.c_str(), res);
+                return false;
+            }
+
+            return true;
+        }
+
+        // Release the target view.
+        void releaseTargetView()
+        {
+            if (target_view_)
+            {
+                target_view_->Release();
+                target_view_ = nullptr;
+            }
+            target_view_texture_ = nullptr;
+        }
+
+        // Release the source view.
+        void releaseSourceView()
+        {
+            releaseView(source_view_, source_view_texture_);
+        }
+
+        // Let the discovery thread serve the connection.
+        void watchConnection()
+        {
+            auto& g = Globals::get();
+            if (!g.discovery_) return;
+            auto role = type_ == Type::sender ? Connection::Role::sender : Connection::Role::receiver;
+            connection_ = std::make_shared<Connection>(role, name_, width_, height_, share_handle_);
+            g.discovery_->watch(connection_);
+        }
+
+        // Stop serving the connection. Senders stop the heartbeat with it.
+        void unwatchConnection()
+        {
+            if (!connection_) return;
+            auto& g = Globals::get();
+            if (g.discovery_) g.discovery_->unwatch(connection_);
+            connection_->close();
+            connection_.reset();
+        }
+
+        // Retrieve the keyed mutex from the shared texture if it has one.
+        void retrieveKeyedMutex()
+        {
+            void** ptr = reinterpret_cast<void**>(&keyed_mutex_);
+            if (FAILED(d3d11_resource_->QueryInterface(__uuidof(IDXGIKeyedMutex), ptr)))
+                keyed_mutex_ = nullptr;
+        }
+
         // Release internal objects.
         void releaseInternals()
         {
             auto& g = Globals::get();
 
             // Senders should unregister their own name on destruction.
-            if (type_ == Type::sender && d3d11_resource_)
+            if (type_ == Type::sender && d3d11_resource_ && !retired_)
                 g.sender_names_->ReleaseSenderName(name_.c_str());
 
-            // Release D3D11 objects.
-            if (d3d11_resource_)
+            releaseResources();
+        }
+
+        // Release D3D11 objects and the sender info map. The textures are
+        // returned to the pool rather than released.
+        void releaseResources()
+        {
+            auto& g = Globals::get();
+
+            unlock();
+
+            if (keyed_mutex_)
             {
-                d3d11_resource_->Release();
-                d3d11_resource_ = nullptr;
+                keyed_mutex_->Release();
+                keyed_mutex_ = nullptr;
             }
 
-            if (d3d11_resource_view_)
+            if (pixel_texture_) releasePixelReceiver();
+            pixel_sender_.close();
+            releaseSnapshot();
+            interop_.reset();
+
+            if (d3d11_resource_ && g.texture_pool_)
             {
-                d3d11_resource_view_->Release();
-                d3d11_resource_view_ = nullptr;
+                releaseRing();
+
+                if (type_ == Type::sender)
+                    g.texture_pool_->releaseSender(sender_textures_[0]);
+                else
+                    g.texture_pool_->releaseReceiver(share_handle_);
             }
+
+            d3d11_resource_ = nullptr;
+            d3d11_resource_view_ = nullptr;
+            d3d11_srgb_view_ = nullptr;
+            d3d11_target_view_ = nullptr;
+
+            unwatchConnection();
+
+            if (type_ == Type::sender)
+            {
+                // Stop advertising the ring buffers.
+                auto ext = spoutSenderNames::getSharedInfoExt(sender_info_);
+                if (ext) InterlockedExchange(&ext->ringCount, 0);
+                sender_info_.Close();
+
+                // The atlas table is republished after reactivation.
+                if (isAtlas())
+                {
+                    atlas_table_.close();
+                    atlas_dirty_.store(true, std::memory_order_relaxed);
+                }
+            }
+
+            share_handle_ = nullptr;
+        }
+
+        // Publish the current state to the main thread.
+        void publishState()
+        {
+            published_.width.store(width_, std::memory_order_relaxed);
+            published_.height.store(height_, std::memory_order_relaxed);
+            published_.format.store(format_, std::memory_order_relaxed);
+            published_.keyed_mutex.store(keyed_mutex_ != nullptr, std::memory_order_relaxed);
+            published_.cpu_transport.store(pixel_texture_ != nullptr, std::memory_order_relaxed);
+            published_.interop.store(interop_ != nullptr, std::memory_order_relaxed);
+            published_.native_texture.store(interop_ ? interop_->binding_->texture() : nullptr, std::memory_order_relaxed);
+            // The snapshot replaces the shared texture (no sRGB view, as it's
+            // never bound directly).
+            auto view = snapshot_view_ ? snapshot_view_ : d3d11_resource_view_;
+            published_.srgb_view.store(snapshot_view_ ? nullptr : d3d11_srgb_view_, std::memory_order_relaxed);
+            published_.resource_view.store(view, std::memory_order_release);
         }
 
         // Set up as a sender.
@@ -123,46 +1400,46 @@ namespace klakspout
                 if (g.sender_names_->CheckSender(name_.c_str(), width, height, handle, format)) return false;
             }
 
-            // Currently we only support RGBA32.
-            const auto format = DXGI_FORMAT_R8G8B8A8_UNORM;
-
-            // Create a shared texture.
-            ID3D11Texture2D* texture;
-            HANDLE handle;
-            auto res_spout = g.spout_->CreateSharedDX11Texture(g.d3d11_, width_, height_, format, &texture, handle);
+            // Fall back to RGBA32 when the format is not supported.
+            if (!isSupportedFormat(format_)) format_ = DXGI_FORMAT_R8G8B8A8_UNORM;
+            const auto format = format_;
 
-            if (!res_spout)
+            // Get a shared texture with the views from the pool.
+            auto& primary = sender_textures_[0];
+            if (!g.texture_pool_->acquireSender(width_, height_, format, keyed_mutex_option_, primary))
             {
-                DEBUG_LOG("CreateSharedDX11Texture failed (%s)", name_.c_str());
+                DEBUG_LOG("Shared texture allocation failed (%s)", name_.c_str());
                 return false;
             }
 
-            d3d11_resource_ = texture;
+            d3d11_resource_ = primary.texture;
+            d3d11_resource_view_ = primary.resource_view;
+            d3d11_target_view_ = primary.target_view;
+            if (keyed_mutex_option_) retrieveKeyedMutex();
 
-            // Create a resource view for the shared texture.
-            auto res_d3d = g.d3d11_->CreateShaderResourceView(d3d11_resource_, nullptr, &d3d11_resource_view_);
-
-            if (FAILED(res_d3d))
-            {
-                d3d11_resource_->Release();
-                d3d11_resource_ = nullptr;
-                DEBUG_LOG("CreateShaderResourceView failed (%s:%x)", name_.c_str(), res_d3d);
-                return false;
-            }
+            // Back buffers for the ring buffer mode
+            setupSenderRing();
 
             // Create a Spout sender object for the shared texture.
-            res_spout = g.sender_names_->CreateSender(name_.c_str(), width_, height_, handle, format);
+            auto res_spout = g.sender_names_->CreateSender(name_.c_str(), width_, height_, primary.handle, format);
 
             if (!res_spout)
             {
-                d3d11_resource_view_->Release();
-                d3d11_resource_view_ = nullptr;
-                d3d11_resource_->Release();
-                d3d11_resource_ = nullptr;
+                releaseResources();
                 DEBUG_LOG("CreateSender failed (%s)", name_.c_str());
                 return false;
             }
 
+            // Open our own sender info map for the frame count updates.
+            // Failure only disables the frame count, so it's not fatal.
+            sender_info_.Open(name_.c_str());
+            advertiseAdapter();
+            advertiseRing();
+
+            // GPU interop with Unity's device in the bridge mode
+            if (g.bridge_ && setupInterop())
+                DEBUG_LOG("Sender interop enabled (%s)", name_.c_str());
+
             DEBUG_LOG("Sender activated (%s)", name_.c_str());
             return true;
         }
@@ -188,27 +1465,73 @@ namespace klakspout
             width_ = w;
             height_ = h;
 
-            // Start sharing the texture.
-            void** ptr = reinterpret_cast<void**>(&d3d11_resource_);
-            auto res_d3d = g.d3d11_->OpenSharedResource(handle, __uuidof(ID3D11Resource), ptr);
+            // DX9 senders set zero to the format field. Their texture format
+            // is always D3DFMT_A8R8G8B8, which matches BGRA32 in DXGI.
+            format_ = format != 0 ? static_cast<DXGI_FORMAT>(format) : DXGI_FORMAT_B8G8R8A8_UNORM;
 
-            if (FAILED(res_d3d))
+            // Keep the sender info map open for the later validity checks.
+            // The map of a sender without the extension block is closed
+            // again, as we couldn't tell that it outlives the sender.
+            if (!info_open_.load(std::memory_order_relaxed))
             {
-                DEBUG_LOG("OpenSharedResource failed (%s:%x)", name_.c_str(), res_d3d);
+                if (!sender_info_.Open(name_.c_str()))
+                {
+                    DEBUG_LOG("Sender info map open failed (%s)", name_.c_str());
+                    return false;
+                }
+
+                if (spoutSenderNames::getSharedInfoExt(sender_info_))
+                    info_open_.store(true, std::memory_order_release);
+                else
+                    sender_info_.Close();
+            }
+
+            // Start sharing the texture. The pool returns the cached one if
+            // the handle has been opened before.
+            // The texture can't be opened on another adapter, so go to the
+            // CPU transport without trying then.
+            TexturePool::ReceiverTexture texture;
+            if (isOnOtherAdapter() || !g.texture_pool_->acquireReceiver(handle, texture))
+            {
+                // Fall back to the CPU transport if the format is known to
+                // the sender side.
+                if (isSupportedFormat(format_) && setupPixelReceiver())
+                {
+                    share_handle_ = handle;
+                    DEBUG_LOG("Receiver activated with the CPU transport (%s)", name_.c_str());
+                    return true;
+                }
+
+                releaseResources();
+                DEBUG_LOG("Shared texture open failed (%s)", name_.c_str());
                 return false;
             }
 
-            // Create a resource view for the shared texture.
-            res_d3d = g.d3d11_->CreateShaderResourceView(d3d11_resource_, nullptr, &d3d11_resource_view_);
+            share_handle_ = handle;
+            receiver_textures_[0] = texture;
+            useReceiverTexture(texture);
 
-            if (FAILED(res_d3d))
+            // Use the keyed mutex if the sender created the texture with it.
+            // The main thread gets the snapshot of the texture then. In the
+            // bridge mode, the interop texture or the readback is the one.
+            retrieveKeyedMutex();
+            if (keyed_mutex_ && !g.bridge_ && !setupSnapshot())
             {
-                d3d11_resource_->Release();
-                d3d11_resource_ = nullptr;
-                DEBUG_LOG("CreateShaderResourceView failed (%s:%x)", name_.c_str(), res_d3d);
+                releaseResources();
                 return false;
             }
 
+            // GPU interop with Unity's device in the bridge mode
+            // RGB10A2 has no texture format to wrap it on Unity's device, so
+            // it's left to the CPU path.
+            if (g.bridge_ && isSupportedFormat(format_) &&
+                format_ != DXGI_FORMAT_R10G10B10A2_UNORM && setupInterop())
+                DEBUG_LOG("Receiver interop enabled (%s)", name_.c_str());
+
+            // Open the ring buffers if the sender uses them.
+            ring_advertised_ = 0;
+            if (!keyed_mutex_) updateReceiverRing();
+
             DEBUG_LOG("Receiver activated (%s)", name_.c_str());
             return true;
         }
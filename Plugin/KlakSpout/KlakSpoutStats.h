@@ -0,0 +1,309 @@
+#pragma once
+
+#include "KlakSpoutGlobals.h"
+#include <atomic>
+#include <cstdint>
+
+namespace klakspout
+{
+    // QPC-based CPU time measurement in microseconds
+    class CpuTimer final
+    {
+    public:
+
+        CpuTimer() : start_(ticks())
+        {
+        }
+
+        std::int64_t elapsed() const
+        {
+            return toMicroseconds(ticks() - start_);
+        }
+
+        // Raw QPC value. It's system-wide, so it can be compared with the
+        // ones taken in other processes.
+        static std::int64_t ticks()
+        {
+            LARGE_INTEGER now;
+            QueryPerformanceCounter(&now);
+            return now.QuadPart;
+        }
+
+        static std::int64_t toMicroseconds(std::int64_t ticks)
+        {
+            return ticks * 1000000 / frequency();
+        }
+
+    private:
+
+        std::int64_t start_;
+
+        static std::int64_t frequency()
+        {
+            static const std::int64_t freq = []
+            {
+                LARGE_INTEGER f;
+                QueryPerformanceFrequency(&f);
+                return f.QuadPart;
+            }();
+            return freq;
+        }
+    };
+
+    // GPU time measurement with timestamp queries
+    // The results are retrieved a few frames later without waiting for the
+    // GPU; measurements are dropped while all the query sets are in flight.
+    // Only used from the render thread.
+    class GpuTimer final
+    {
+    public:
+
+        GpuTimer() : sets_(), next_(0), active_(-1)
+        {
+        }
+
+        ~GpuTimer()
+        {
+            release();
+        }
+
+        // Prohibit use of copy operators
+        GpuTimer(GpuTimer&) = delete;
+        GpuTimer& operator = (const GpuTimer&) = delete;
+
+        // Start measuring the commands issued until end().
+        void begin(ID3D11DeviceContext* context)
+        {
+            active_ = -1;
+
+            auto& set = sets_[next_];
+            if (set.pending || (!set.disjoint && !createSet(set))) return;
+
+            context->Begin(set.disjoint);
+            context->End(set.begin);
+            active_ = next_;
+        }
+
+        // Stop measuring.
+        void end(ID3D11DeviceContext* context)
+        {
+            if (active_ < 0) return;
+
+            auto& set = sets_[active_];
+            context->End(set.end);
+            context->End(set.disjoint);
+            set.pending = true;
+
+            next_ = (next_ + 1) % set_count_;
+            active_ = -1;
+        }
+
+        // Retrieve the completed measurements. The sink is called with the
+        // elapsed time in microseconds for each of them.
+        template <typename Sink>
+        void poll(ID3D11DeviceContext* context, Sink sink)
+        {
+            for (auto& set : sets_)
+            {
+                if (!set.pending) continue;
+
+                D3D11_QUERY_DATA_TIMESTAMP_DISJOINT dj;
+                UINT64 t0, t1;
+                const auto flags = D3D11_ASYNC_GETDATA_DONOTFLUSH;
+                if (context->GetData(set.disjoint, &dj, sizeof(dj), flags) != S_OK ||
+                    context->GetData(set.begin, &t0, sizeof(t0), flags) != S_OK ||
+                    context->GetData(set.end, &t1, sizeof(t1), flags) != S_OK) continue;
+
+                set.pending = false;
+                if (!dj.Disjoint && dj.Frequency > 0 && t1 >= t0)
+                    sink(static_cast<std::int64_t>((t1 - t0) * 1000000 / dj.Frequency));
+            }
+        }
+
+        // Release the queries.
+        void release()
+        {
+            for (auto& set : sets_)
+            {
+                if (set.disjoint) set.disjoint->Release();
+                if (set.begin) set.begin->Release();
+                if (set.end) set.end->Release();
+                set = {};
+            }
+            active_ = -1;
+        }
+
+    private:
+
+        struct QuerySet
+        {
+            ID3D11Query* disjoint;
+            ID3D11Query* begin;
+            ID3D11Query* end;
+            bool pending;
+        };
+
+        static constexpr int set_count_ = 4;
+        QuerySet sets_[set_count_];
+        int next_, active_;
+
+        bool createSet(QuerySet& set)
+        {
+            auto device = Globals::get().d3d11_;
+
+            D3D11_QUERY_DESC dj = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+            D3D11_QUERY_DESC ts = { D3D11_QUERY_TIMESTAMP, 0 };
+
+            if (SUCCEEDED(device->CreateQuery(&dj, &set.disjoint)) &&
+                SUCCEEDED(device->CreateQuery(&ts, &set.begin)) &&
+                SUCCEEDED(device->CreateQuery(&ts, &set.end))) return true;
+
+            if (set.disjoint) set.disjoint->Release();
+            if (set.begin) set.begin->Release();
+            set = {};
+            DEBUG_LOG("Query creation failed (%s)", "GpuTimer");
+            return false;
+        }
+    };
+
+    // Per-object statistics
+    // The counters are updated on the render thread and can be read from any
+    // thread. They're always available (also in the release build).
+    class Stats final
+    {
+    public:
+
+        // Snapshot of the counters
+        // The layout is shared with the C# side (SpoutStats), so only append
+        // new fields to the end. Times are in microseconds.
+        struct Snapshot
+        {
+            std::int64_t activation_attempts;
+            std::int64_t activations;
+            std::int64_t lock_count;      // keyed mutex acquisitions
+            std::int64_t lock_timeouts;
+            std::int64_t lock_wait_time;  // total
+            std::int64_t info_timeouts;   // sender info map lock timeouts
+            std::int64_t frames_sent;
+            std::int64_t frames_received;
+            std::int64_t update_count;
+            std::int64_t update_time;     // total
+            std::int64_t update_time_max;
+            std::int64_t gpu_count;
+            std::int64_t gpu_time;        // total
+            std::int64_t gpu_time_last;
+            std::int64_t latency_count;   // timestamped frames consumed
+            std::int64_t latency_time;    // total (sender copy to receiver use)
+            std::int64_t latency_last;
+            std::int64_t latency_max;
+        };
+
+        Stats()
+            : activation_attempts_(0), activations_(0),
+              lock_count_(0), lock_timeouts_(0), lock_wait_time_(0),
+              info_timeouts_(0), frames_sent_(0), frames_received_(0),
+              update_count_(0), update_time_(0), update_time_max_(0),
+              gpu_count_(0), gpu_time_(0), gpu_time_last_(0),
+              latency_count_(0), latency_time_(0), latency_last_(0), latency_max_(0)
+        {
+        }
+
+        // Prohibit use of copy operators
+        Stats(Stats&) = delete;
+        Stats& operator = (const Stats&) = delete;
+
+        void countActivation(bool success)
+        {
+            add(activation_attempts_, 1);
+            if (success) add(activations_, 1);
+        }
+
+        void countLock(std::int64_t wait, bool success)
+        {
+            add(lock_count_, 1);
+            add(lock_wait_time_, wait);
+            if (!success) add(lock_timeouts_, 1);
+        }
+
+        void countInfoTimeouts(std::int64_t count)
+        {
+            if (count != 0) add(info_timeouts_, count);
+        }
+
+        void countFrameSent()
+        {
+            add(frames_sent_, 1);
+        }
+
+        void countFrameReceived()
+        {
+            add(frames_received_, 1);
+        }
+
+        void countUpdate(std::int64_t time)
+        {
+            add(update_count_, 1);
+            add(update_time_, time);
+            if (time > update_time_max_.load(std::memory_order_relaxed))
+                update_time_max_.store(time, std::memory_order_relaxed);
+        }
+
+        void countGpu(std::int64_t time)
+        {
+            add(gpu_count_, 1);
+            add(gpu_time_, time);
+            gpu_time_last_.store(time, std::memory_order_relaxed);
+        }
+
+        void countLatency(std::int64_t time)
+        {
+            add(latency_count_, 1);
+            add(latency_time_, time);
+            latency_last_.store(time, std::memory_order_relaxed);
+            if (time > latency_max_.load(std::memory_order_relaxed))
+                latency_max_.store(time, std::memory_order_relaxed);
+        }
+
+        // Take a snapshot. The counters are read individually, so they can be
+        // slightly inconsistent with each other.
+        void snapshot(Snapshot& out) const
+        {
+            const auto o = std::memory_order_relaxed;
+            out.activation_attempts = activation_attempts_.load(o);
+            out.activations = activations_.load(o);
+            out.lock_count = lock_count_.load(o);
+            out.lock_timeouts = lock_timeouts_.load(o);
+            out.lock_wait_time = lock_wait_time_.load(o);
+            out.info_timeouts = info_timeouts_.load(o);
+            out.frames_sent = frames_sent_.load(o);
+            out.frames_received = frames_received_.load(o);
+            out.update_count = update_count_.load(o);
+            out.update_time = update_time_.load(o);
+            out.update_time_max = update_time_max_.load(o);
+            out.gpu_count = gpu_count_.load(o);
+            out.gpu_time = gpu_time_.load(o);
+            out.gpu_time_last = gpu_time_last_.load(o);
+            out.latency_count = latency_count_.load(o);
+            out.latency_time = latency_time_.load(o);
+            out.latency_last = latency_last_.load(o);
+            out.latency_max = latency_max_.load(o);
+        }
+
+    private:
+
+        using Counter = std::atomic<std::int64_t>;
+
+        Counter activation_attempts_, activations_;
+        Counter lock_count_, lock_timeouts_, lock_wait_time_;
+        Counter info_timeouts_;
+        Counter frames_sent_, frames_received_;
+        Counter update_count_, update_time_, update_time_max_;
+        Counter gpu_count_, gpu_time_, gpu_time_last_;
+        Counter latency_count_, latency_time_, latency_last_, latency_max_;
+
+        static void add(Counter& counter, std::int64_t value)
+        {
+            counter.fetch_add(value, std::memory_order_relaxed);
+        }
+    };
+}
\ No newline at end of file
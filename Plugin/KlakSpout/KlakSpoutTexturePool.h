@@ -0,0 +1,289 @@
+#pragma once
+
+#include "KlakSpoutGlobals.h"
+#include <vector>
+#include <unordered_map>
+
+namespace klakspout
+{
+    // Shared texture pool
+    // Recycles sender textures with their views, and caches the receiver
+    // textures opened from share handles, so that reconnections and cyclic
+    // enable/disable don't reallocate GPU resources. Only used from the
+    // render thread.
+    class TexturePool final
+    {
+    public:
+
+        // Sender texture set
+        struct SenderTexture
+        {
+            ID3D11Texture2D* texture;
+            HANDLE handle;
+            ID3D11ShaderResourceView* resource_view;
+            ID3D11RenderTargetView* target_view;
+            int width, height;
+            DXGI_FORMAT format;
+            bool keyed_mutex;
+        };
+
+        // Receiver texture set
+        // The sRGB view is only available when the sender has created the
+        // texture with a typeless format; it's null otherwise.
+        struct ReceiverTexture
+        {
+            ID3D11Resource* resource;
+            ID3D11ShaderResourceView* resource_view;
+            ID3D11ShaderResourceView* srgb_view;
+        };
+
+        TexturePool(ID3D11Device* device, spoutDirectX& spout)
+            : device_(device), spout_(spout), clock_(0)
+        {
+        }
+
+        ~TexturePool()
+        {
+            clear();
+        }
+
+        // Prohibit use of default constructor and copy operators
+        TexturePool() = delete;
+        TexturePool(TexturePool&) = delete;
+        TexturePool& operator = (const TexturePool&) = delete;
+
+        // Get a sender texture with the given specs. It reuses an idle one
+        // if available, otherwise creates a new one.
+        bool acquireSender(int width, int height, DXGI_FORMAT format, bool keyed_mutex, SenderTexture& out)
+        {
+            for (auto it = idle_senders_.begin(); it != idle_senders_.end(); ++it)
+            {
+                if (it->width == width && it->height == height &&
+                    it->format == format && it->keyed_mutex == keyed_mutex)
+                {
+                    out = *it;
+                    idle_senders_.erase(it);
+                    DEBUG_LOG("Sender texture reused (%dx%d)", width, height);
+                    return true;
+                }
+            }
+            return createSender(width, height, format, keyed_mutex, out);
+        }
+
+        // Return a sender texture to the pool.
+        void releaseSender(const SenderTexture& texture)
+        {
+            idle_senders_.push_back(texture);
+
+            // Evict the oldest ones when exceeding the limit.
+            while (idle_senders_.size() > max_idle_)
+            {
+                destroySender(idle_senders_.front());
+                idle_senders_.erase(idle_senders_.begin());
+            }
+        }
+
+        // Open a shared texture with the share handle. Returns a cached one
+        // if the handle has been opened before.
+        bool acquireReceiver(HANDLE handle, ReceiverTexture& out)
+        {
+            auto it = receivers_.find(handle);
+
+            if (it == receivers_.end())
+            {
+                ReceiverEntry entry = {};
+                if (!openReceiver(handle, entry.texture)) return false;
+                it = receivers_.emplace(handle, entry).first;
+            }
+
+            it->second.references++;
+            out = it->second.texture;
+            return true;
+        }
+
+        // Release a reference to a receiver texture. The texture is kept
+        // open for a while to be reused on reconnection.
+        void releaseReceiver(HANDLE handle)
+        {
+            auto it = receivers_.find(handle);
+            if (it == receivers_.end()) return;
+
+            if (--it->second.references > 0) return;
+            it->second.last_used = ++clock_;
+
+            trimReceivers();
+        }
+
+        // Release all the pooled/cached textures. Textures that are still in
+        // use are released too, so it should only be used on shutdown.
+        void clear()
+        {
+            for (auto& t : idle_senders_) destroySender(t);
+            idle_senders_.clear();
+
+            for (auto& pair : receivers_) destroyReceiver(pair.second.texture);
+            receivers_.clear();
+        }
+
+    private:
+
+        // Maximum number of idle textures kept in each pool
+        static constexpr size_t max_idle_ = 4;
+
+        struct ReceiverEntry
+        {
+            ReceiverTexture texture;
+            int references;
+            unsigned int last_used;
+        };
+
+        ID3D11Device* device_;
+        spoutDirectX& spout_;
+        std::vector<SenderTexture> idle_senders_; // oldest first
+        std::unordered_map<HANDLE, ReceiverEntry> receivers_;
+        unsigned int clock_;
+
+        bool createSender(int width, int height, DXGI_FORMAT format, bool keyed_mutex, SenderTexture& out)
+        {
+            out = {};
+            out.width = width;
+            out.height = height;
+            out.format = format;
+            out.keyed_mutex = keyed_mutex;
+
+            if (!spout_.CreateSharedDX11Texture(device_, width, height, format, &out.texture, out.handle, keyed_mutex))
+            {
+                DEBUG_LOG("CreateSharedDX11Texture failed (%dx%d)", width, height);
+                return false;
+            }
+
+            auto res = device_->CreateShaderResourceView(out.texture, nullptr, &out.resource_view);
+
+            if (FAILED(res))
+            {
+                destroySender(out);
+                DEBUG_LOG("CreateShaderResourceView failed (%x)", res);
+                return false;
+            }
+
+            // Render target view for the native send
+            res = device_->CreateRenderTargetView(out.texture, nullptr, &out.target_view);
+
+            if (FAILED(res))
+            {
+                destroySender(out);
+                DEBUG_LOG("CreateRenderTargetView failed (%x)", res);
+                return false;
+            }
+
+            return true;
+        }
+
+        static void destroySender(SenderTexture& t)
+        {
+            if (t.target_view) { t.target_view->Release(); t.target_view = nullptr; }
+            if (t.resource_view) { t.resource_view->Release(); t.resource_view = nullptr; }
+            if (t.texture) { t.texture->Release(); t.texture = nullptr; }
+        }
+
+        bool openReceiver(HANDLE handle, ReceiverTexture& out)
+        {
+            out = {};
+
+            void** ptr = reinterpret_cast<void**>(&out.resource);
+            auto res = device_->OpenSharedResource(handle, __uuidof(ID3D11Resource), ptr);
+
+            if (FAILED(res))
+            {
+                out.resource = nullptr;
+                DEBUG_LOG("OpenSharedResource failed (%x)", res);
+                return false;
+            }
+
+            // Typeless textures need explicit view formats.
+            D3D11_TEXTURE2D_DESC td = {};
+            ID3D11Texture2D* texture;
+            if (SUCCEEDED(out.resource->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&texture))))
+            {
+                texture->GetDesc(&td);
+                texture->Release();
+            }
+
+            DXGI_FORMAT unorm, srgb;
+            auto typeless = getTypedFormats(td.Format, unorm, srgb);
+
+            D3D11_SHADER_RESOURCE_VIEW_DESC vd = {};
+            vd.Format = unorm;
+            vd.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+            vd.Texture2D.MipLevels = 1;
+
+            res = device_->CreateShaderResourceView(out.resource, typeless ? &vd : nullptr, &out.resource_view);
+
+            if (FAILED(res))
+            {
+                destroyReceiver(out);
+                DEBUG_LOG("CreateShaderResourceView failed (%x)", res);
+                return false;
+            }
+
+            // The sRGB view is optional.
+            vd.Format = srgb;
+            if (typeless && FAILED(device_->CreateShaderResourceView(out.resource, &vd, &out.srgb_view)))
+                out.srgb_view = nullptr;
+
+            return true;
+        }
+
+        // Get the UNORM/sRGB view formats of a typeless format. Returns false
+        // when it's not a typeless format that has the sRGB variant.
+        static bool getTypedFormats(DXGI_FORMAT format, DXGI_FORMAT& unorm, DXGI_FORMAT& srgb)
+        {
+            switch (format)
+            {
+            case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+                unorm = DXGI_FORMAT_R8G8B8A8_UNORM;
+                srgb = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+                return true;
+            case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+                unorm = DXGI_FORMAT_B8G8R8A8_UNORM;
+                srgb = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+                return true;
+            default:
+                unorm = srgb = DXGI_FORMAT_UNKNOWN;
+                return false;
+            }
+        }
+
+        static void destroyReceiver(ReceiverTexture& t)
+        {
+            if (t.srgb_view) { t.srgb_view->Release(); t.srgb_view = nullptr; }
+            if (t.resource_view) { t.resource_view->Release(); t.resource_view = nullptr; }
+            if (t.resource) { t.resource->Release(); t.resource = nullptr; }
+        }
+
+        // Close the least recently used textures when exceeding the limit.
+        // Note that a cached texture keeps the sender's texture alive, so the
+        // handle value can't be reused by another texture while cached.
+        void trimReceivers()
+        {
+            for (;;)
+            {
+                size_t idle = 0;
+                auto oldest = receivers_.end();
+
+                for (auto it = receivers_.begin(); it != receivers_.end(); ++it)
+                {
+                    if (it->second.references > 0) continue;
+                    idle++;
+                    if (oldest == receivers_.end() || it->second.last_used < oldest->second.last_used)
+                        oldest = it;
+                }
+
+                if (idle <= max_idle_) return;
+
+                destroyReceiver(oldest->second.texture);
+                receivers_.erase(oldest);
+            }
+        }
+    };
+}
\ No newline at end of file
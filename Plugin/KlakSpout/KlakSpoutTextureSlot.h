@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <d3d11.h>
+
+namespace klakspout
+{
+    // Texture handed from the main thread to the render thread
+    // The main thread adds a reference to the texture it gives, so that the
+    // texture stays alive (and its address isn't reused) even when Unity
+    // releases it before the render thread lets go of it. References are
+    // only released on the render thread. The render thread only tries
+    // locking the mutex when the texture has been changed, so that it never
+    // waits.
+    class TextureSlot final
+    {
+    public:
+
+        TextureSlot()
+          : dirty_(false), pending_(nullptr), pending_flags_(0),
+            texture_(nullptr), flags_(0)
+        {
+        }
+
+        // This has to be destroyed on the render thread.
+        ~TextureSlot()
+        {
+            release();
+        }
+
+        // Prohibit use of copy operators
+        TextureSlot(TextureSlot&) = delete;
+        TextureSlot& operator = (const TextureSlot&) = delete;
+
+        // Give a texture (or null) with its flags (main thread).
+        void set(ID3D11Texture2D* texture, int flags)
+        {
+            if (texture) texture->AddRef();
+
+            std::lock_guard<std::mutex> guard(mutex_);
+
+            // The one that hasn't been taken yet is released later.
+            if (pending_) stale_.push_back(pending_);
+
+            pending_ = texture;
+            pending_flags_ = flags;
+            dirty_.store(true, std::memory_order_release);
+        }
+
+        // Take the latest given texture (render thread). It's retried in
+        // the next call when the main thread is holding the mutex.
+        void update()
+        {
+            if (!dirty_.load(std::memory_order_acquire)) return;
+
+            std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+            if (!lock.owns_lock()) return;
+
+            releaseStale();
+            if (texture_) texture_->Release();
+
+            texture_ = pending_;
+            flags_ = pending_flags_;
+            pending_ = nullptr;
+            dirty_.store(false, std::memory_order_relaxed);
+        }
+
+        // Current texture and flags (render thread)
+        ID3D11Texture2D* texture() const { return texture_; }
+        int flags() const { return flags_; }
+
+        // Release all the references (render thread).
+        void release()
+        {
+            std::lock_guard<std::mutex> guard(mutex_);
+
+            releaseStale();
+
+            if (pending_) pending_->Release();
+            if (texture_) texture_->Release();
+
+            pending_ = texture_ = nullptr;
+            dirty_.store(false, std::memory_order_relaxed);
+        }
+
+    private:
+
+        std::mutex mutex_;
+        std::atomic<bool> dirty_;
+        ID3D11Texture2D* pending_;
+        int pending_flags_;
+        std::vector<ID3D11Texture2D*> stale_;
+
+        // Render thread copy
+        ID3D11Texture2D* texture_;
+        int flags_;
+
+        void releaseStale()
+        {
+            for (auto t : stale_) t->Release();
+            stale_.clear();
+        }
+    };
+}
\ No newline at end of file
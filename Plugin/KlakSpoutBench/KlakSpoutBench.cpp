@@ -0,0 +1,628 @@
+// KlakSpout transport benchmark
+//
+// Standalone executable that drives SharedObject, spoutSenderNames and
+// SpoutSharedMemory directly with its own D3D11 device, without Unity. Each
+// measurement is printed to stdout as a line of JSON, so that the results can
+// be compared between builds. Progress and errors go to stderr.
+//
+// Usage: KlakSpoutBench [--quick] [--frames N] [--churn N] [--queries N]
+
+#include "KlakSpoutSharedObject.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using klakspout::Globals;
+    using klakspout::SharedObject;
+
+    //
+    // Options
+    //
+
+    struct Options
+    {
+        int frames = 300;   // frames per matrix configuration
+        int churn = 200;    // connect/disconnect cycles
+        int queries = 2000; // calls per query test
+        bool quick = false; // reduced matrix
+    };
+
+    Options ParseOptions(int argc, char* argv[])
+    {
+        Options opt;
+        for (auto i = 1; i < argc; i++)
+        {
+            auto arg = argv[i];
+            auto next = i + 1 < argc ? std::atoi(argv[i + 1]) : 0;
+            if (std::strcmp(arg, "--quick") == 0) { opt.quick = true; }
+            else if (std::strcmp(arg, "--frames") == 0 && next > 0) { opt.frames = next; i++; }
+            else if (std::strcmp(arg, "--churn") == 0 && next > 0) { opt.churn = next; i++; }
+            else if (std::strcmp(arg, "--queries") == 0 && next > 0) { opt.queries = next; i++; }
+            else std::fprintf(stderr, "Unknown option: %s\n", arg);
+        }
+        return opt;
+    }
+
+    //
+    // Measurement utilities
+    //
+
+    // High resolution timestamp in microseconds
+    double Now()
+    {
+        static const double scale = []
+        {
+            LARGE_INTEGER f;
+            QueryPerformanceFrequency(&f);
+            return 1e6 / static_cast<double>(f.QuadPart);
+        }();
+        LARGE_INTEGER t;
+        QueryPerformanceCounter(&t);
+        return static_cast<double>(t.QuadPart) * scale;
+    }
+
+    // Sample set with summary statistics
+    class Samples final
+    {
+    public:
+
+        void add(double value)
+        {
+            values_.push_back(value);
+        }
+
+        bool empty() const
+        {
+            return values_.empty();
+        }
+
+        double mean() const
+        {
+            if (values_.empty()) return 0;
+            auto sum = 0.0;
+            for (auto v : values_) sum += v;
+            return sum / values_.size();
+        }
+
+        double percentile(double p)
+        {
+            if (values_.empty()) return 0;
+            std::sort(values_.begin(), values_.end());
+            auto index = static_cast<size_t>(p * (values_.size() - 1) + 0.5);
+            return values_[index];
+        }
+
+    private:
+
+        std::vector<double> values_;
+    };
+
+    // JSON line builder: The line is printed on destruction.
+    class Result final
+    {
+    public:
+
+        Result(const char* test)
+        {
+            line_ = "{\"test\":\"";
+            line_ += test;
+            line_ += "\"";
+        }
+
+        ~Result()
+        {
+            std::printf("%s}\n", line_.c_str());
+            std::fflush(stdout);
+        }
+
+        Result& add(const char* key, const char* value)
+        {
+            char buffer[256];
+            std::snprintf(buffer, sizeof(buffer), ",\"%s\":\"%s\"", key, value);
+            line_ += buffer;
+            return *this;
+        }
+
+        Result& add(const char* key, double value)
+        {
+            char buffer[256];
+            std::snprintf(buffer, sizeof(buffer), ",\"%s\":%.3f", key, value);
+            line_ += buffer;
+            return *this;
+        }
+
+        Result& add(const char* key, int value)
+        {
+            char buffer[256];
+            std::snprintf(buffer, sizeof(buffer), ",\"%s\":%d", key, value);
+            line_ += buffer;
+            return *this;
+        }
+
+        // Summary of a sample set (mean, median, 99th percentile and max)
+        Result& add(const char* key, Samples& samples)
+        {
+            std::string k = key;
+            add((k + "_mean").c_str(), samples.mean());
+            add((k + "_p50").c_str(), samples.percentile(0.5));
+            add((k + "_p99").c_str(), samples.percentile(0.99));
+            add((k + "_max").c_str(), samples.percentile(1.0));
+            return *this;
+        }
+
+    private:
+
+        std::string line_;
+    };
+
+    //
+    // Plugin environment
+    //
+
+    std::unique_ptr<klakspout::Blitter> blitter_;
+    ID3D11DeviceContext* context_;
+    ID3D11Query* fence_;
+
+    // Global object initialization with our own device. It mirrors
+    // InitializeGlobals in KlakSpout.cpp. The discovery watcher is needed as
+    // well: It stamps the sender heartbeats, without which receivers regard
+    // the senders as gone after SPOUT_HEARTBEAT_TIMEOUT.
+    bool Initialize()
+    {
+        auto& g = Globals::get();
+
+        g.spout_ = std::make_unique<spoutDirectX>();
+        g.d3d11_ = g.spout_->CreateDX11device();
+        if (!g.d3d11_) return false;
+
+        g.bridge_ = false;
+        g.adapter_luid_ = {};
+        g.spout_->GetDeviceAdapterLuid(g.d3d11_, g.adapter_luid_);
+
+        g.sender_names_ = std::make_unique<spoutSenderNames>();
+
+        DWORD max_senders;
+        if (g.spout_->ReadDwordFromRegistry(&max_senders, "Software\\Leading Edge\\Spout", "MaxSenders"))
+            g.sender_names_->SetMaxSenders(max_senders);
+
+        g.sender_names_->SetVersionedDirectory(true);
+        g.discovery_ = std::make_unique<klakspout::DiscoveryWatcher>(g.sender_names_->GetMaxSenders());
+        g.texture_pool_ = std::make_unique<klakspout::TexturePool>(g.d3d11_, *g.spout_);
+
+        blitter_ = std::make_unique<klakspout::Blitter>(g.d3d11_);
+
+        g.d3d11_->GetImmediateContext(&context_);
+
+        D3D11_QUERY_DESC qd = { D3D11_QUERY_EVENT, 0 };
+        if (FAILED(g.d3d11_->CreateQuery(&qd, &fence_))) fence_ = nullptr;
+
+        return true;
+    }
+
+    void Finalize()
+    {
+        auto& g = Globals::get();
+
+        if (fence_) fence_->Release();
+        if (context_) context_->Release();
+
+        blitter_.reset();
+        g.texture_pool_.reset();
+        g.discovery_.reset();
+
+        if (g.d3d11_) g.d3d11_->Release();
+        g.d3d11_ = nullptr;
+
+        g.spout_.reset();
+        g.sender_names_.reset();
+    }
+
+    // Wait for the GPU to finish the submitted commands.
+    void WaitGpu()
+    {
+        if (!fence_) { context_->Flush(); return; }
+        context_->End(fence_);
+        BOOL done = FALSE;
+        while (context_->GetData(fence_, &done, sizeof(done), 0) != S_OK || !done)
+            YieldProcessor();
+    }
+
+    // Object name unique to this process, so that it doesn't collide with
+    // other Spout applications and the other instances of the benchmark.
+    std::string MakeName(const char* kind, int index)
+    {
+        char buffer[64];
+        std::snprintf(buffer, sizeof(buffer), "KlakSpoutBench_%lu_%s%d",
+                      GetCurrentProcessId(), kind, index);
+        return buffer;
+    }
+
+    // Create a texture with the given bind flags.
+    ID3D11Texture2D* CreateTexture(int width, int height, DXGI_FORMAT format, UINT bind)
+    {
+        D3D11_TEXTURE2D_DESC td = {};
+        td.Width = width;
+        td.Height = height;
+        td.MipLevels = 1;
+        td.ArraySize = 1;
+        td.Format = format;
+        td.SampleDesc.Count = 1;
+        td.Usage = D3D11_USAGE_DEFAULT;
+        td.BindFlags = bind;
+
+        ID3D11Texture2D* texture;
+        if (FAILED(Globals::get().d3d11_->CreateTexture2D(&td, nullptr, &texture))) return nullptr;
+        return texture;
+    }
+
+    // Update the objects until all of them get activated. Returns false on
+    // timeout.
+    bool ActivateAll(const std::vector<SharedObject*>& objects, DWORD timeout = 2000)
+    {
+        auto start = GetTickCount();
+        for (;;)
+        {
+            auto all = true;
+            for (auto obj : objects)
+            {
+                obj->update();
+                all &= obj->isActive();
+            }
+            if (all) return true;
+            if (GetTickCount() - start > timeout) return false;
+            Sleep(1);
+        }
+    }
+
+    // Number of the senders that can be added to the sender list
+    int AvailableSenderSlots()
+    {
+        auto& g = Globals::get();
+        return g.sender_names_->GetMaxSenders() - g.sender_names_->GetSenderCount();
+    }
+
+    const char* FormatName(DXGI_FORMAT format)
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM: return "RGBA32";
+        case DXGI_FORMAT_B8G8R8A8_UNORM: return "BGRA32";
+        case DXGI_FORMAT_R16G16B16A16_FLOAT: return "RGBAHalf";
+        case DXGI_FORMAT_R10G10B10A2_UNORM: return "RGB10A2";
+        default: return "Unknown";
+        }
+    }
+
+    //
+    // Benchmarks
+    //
+
+    // N senders x M receivers per sender: Senders draw a source texture into
+    // their shared textures with the blitter, and receivers copy the shared
+    // textures into local ones under the keyed mutex (if any).
+    void BenchMatrix(const Options& opt)
+    {
+        struct Resolution { int width, height; };
+
+        std::vector<Resolution> resolutions = { { 256, 256 }, { 1920, 1080 }, { 3840, 2160 } };
+        std::vector<DXGI_FORMAT> formats = { DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_R16G16B16A16_FLOAT };
+        std::vector<int> sender_counts = { 1, 4, 8 };
+        std::vector<int> receiver_counts = { 1, 4 };
+
+        if (opt.quick)
+        {
+            resolutions = { { 1920, 1080 } };
+            formats = { DXGI_FORMAT_R8G8B8A8_UNORM };
+            sender_counts = { 1, 4 };
+            receiver_counts = { 1 };
+        }
+
+        for (auto res : resolutions)
+        for (auto format : formats)
+        for (auto senders : sender_counts)
+        for (auto receivers : receiver_counts)
+        {
+            if (senders > AvailableSenderSlots())
+            {
+                Result("matrix").add("skipped", "sender limit")
+                                .add("senders", senders).add("receivers", receivers);
+                continue;
+            }
+
+            auto source = CreateTexture(res.width, res.height, format, D3D11_BIND_SHADER_RESOURCE);
+            if (!source) continue;
+
+            std::vector<SharedObject*> tx, rx;
+            std::vector<ID3D11Texture2D*> copies;
+
+            for (auto i = 0; i < senders; i++)
+            {
+                auto obj = new SharedObject(SharedObject::Type::sender, MakeName("matrix", i),
+                                            res.width, res.height, format);
+                obj->setSourceTexture(source, 0);
+                tx.push_back(obj);
+            }
+
+            auto ok = ActivateAll(tx);
+
+            for (auto i = 0; ok && i < senders * receivers; i++)
+                rx.push_back(new SharedObject(SharedObject::Type::receiver, tx[i % senders]->name_));
+
+            ok = ok && ActivateAll(rx);
+
+            for (auto i = 0; ok && i < static_cast<int>(rx.size()); i++)
+            {
+                D3D11_TEXTURE2D_DESC td;
+                static_cast<ID3D11Texture2D*>(rx[i]->d3d11_resource_)->GetDesc(&td);
+                copies.push_back(CreateTexture(td.Width, td.Height, td.Format, 0));
+            }
+
+            if (ok)
+            {
+                Samples submit, frame;
+
+                for (auto f = 0; f < opt.frames; f++)
+                {
+                    auto t0 = Now();
+
+                    for (auto obj : tx)
+                    {
+                        obj->update();
+                        obj->send(context_, *blitter_);
+                    }
+
+                    for (auto i = 0; i < static_cast<int>(rx.size()); i++)
+                    {
+                        auto obj = rx[i];
+                        obj->update();
+                        obj->lock();
+                        if (copies[i]) context_->CopyResource(copies[i], obj->d3d11_resource_);
+                        obj->unlock();
+                    }
+
+                    auto t1 = Now();
+                    WaitGpu();
+                    auto t2 = Now();
+
+                    submit.add(t1 - t0);
+                    frame.add(t2 - t0);
+                }
+
+                Result("matrix")
+                    .add("width", res.width).add("height", res.height)
+                    .add("format", FormatName(format))
+                    .add("senders", senders).add("receivers", receivers)
+                    .add("frames", opt.frames)
+                    .add("submit_us", submit).add("frame_us", frame);
+            }
+            else
+            {
+                Result("matrix").add("skipped", "activation failed")
+                                .add("senders", senders).add("receivers", receivers);
+            }
+
+            for (auto obj : rx) delete obj;
+            for (auto obj : tx) delete obj;
+            for (auto tex : copies) if (tex) tex->Release();
+            source->Release();
+        }
+    }
+
+    // Connect/disconnect churn: A sender and a receiver are created,
+    // activated and destroyed repeatedly. Sender textures are recycled by the
+    // texture pool as in the plugin.
+    void BenchChurn(const Options& opt)
+    {
+        if (AvailableSenderSlots() < 1)
+        {
+            Result("churn").add("skipped", "sender limit");
+            return;
+        }
+
+        Samples sender_connect, receiver_connect, disconnect;
+        auto failures = 0;
+        auto t_start = Now();
+
+        for (auto i = 0; i < opt.churn; i++)
+        {
+            auto name = MakeName("churn", 0);
+
+            auto t0 = Now();
+            auto tx = new SharedObject(SharedObject::Type::sender, name, 1280, 720, DXGI_FORMAT_R8G8B8A8_UNORM);
+            tx->update();
+            auto t1 = Now();
+            auto rx = new SharedObject(SharedObject::Type::receiver, name);
+            rx->update();
+            auto t2 = Now();
+
+            if (tx->isActive() && rx->isActive())
+            {
+                sender_connect.add(t1 - t0);
+                receiver_connect.add(t2 - t1);
+            }
+            else
+            {
+                failures++;
+            }
+
+            auto t3 = Now();
+            delete rx;
+            delete tx;
+            disconnect.add(Now() - t3);
+        }
+
+        auto elapsed = Now() - t_start;
+
+        Result("churn")
+            .add("cycles", opt.churn).add("failures", failures)
+            .add("cycles_per_sec", opt.churn * 1e6 / elapsed)
+            .add("sender_connect_us", sender_connect)
+            .add("receiver_connect_us", receiver_connect)
+            .add("disconnect_us", disconnect);
+    }
+
+    // Sender list query latency with the given number of registered senders
+    void BenchQueries(const Options& opt)
+    {
+        auto& g = Globals::get();
+
+        for (auto count : { 1, 4, 8 })
+        {
+            if (count > AvailableSenderSlots())
+            {
+                Result("queries").add("skipped", "sender limit").add("senders", count);
+                continue;
+            }
+
+            std::vector<SharedObject*> tx;
+            for (auto i = 0; i < count; i++)
+                tx.push_back(new SharedObject(SharedObject::Type::sender, MakeName("query", i),
+                                              64, 64, DXGI_FORMAT_R8G8B8A8_UNORM));
+
+            if (ActivateAll(tx))
+            {
+                Samples check_hit, check_miss, get_names, name_list;
+                auto missing = MakeName("missing", 0);
+                std::vector<char> buffer(SpoutMaxSenderNameLen * g.sender_names_->GetMaxSenders());
+
+                for (auto i = 0; i < opt.queries; i++)
+                {
+                    unsigned int w, h; HANDLE handle; DWORD format;
+
+                    auto t0 = Now();
+                    g.sender_names_->CheckSender(tx[i % count]->name_.c_str(), w, h, handle, format);
+                    auto t1 = Now();
+                    g.sender_names_->CheckSender(missing.c_str(), w, h, handle, format);
+                    auto t2 = Now();
+                    std::set<std::string> names;
+                    g.sender_names_->GetSenderNames(&names);
+                    auto t3 = Now();
+                    g.sender_names_->GetSenderNameList(buffer.data(), g.sender_names_->GetMaxSenders());
+                    auto t4 = Now();
+
+                    check_hit.add(t1 - t0);
+                    check_miss.add(t2 - t1);
+                    get_names.add(t3 - t2);
+                    name_list.add(t4 - t3);
+                }
+
+                Result("queries")
+                    .add("senders", count).add("calls", opt.queries)
+                    .add("check_sender_us", check_hit)
+                    .add("check_missing_us", check_miss)
+                    .add("get_sender_names_us", get_names)
+                    .add("get_sender_name_list_us", name_list);
+            }
+            else
+            {
+                Result("queries").add("skipped", "activation failed").add("senders", count);
+            }
+
+            for (auto obj : tx) delete obj;
+        }
+    }
+
+    // Frame-to-frame latency: The sender sends frames at 60 Hz, and a
+    // polling thread (like Unity's main thread) watches the frame count of
+    // the receiver. It measures the delay between the send and the
+    // observation, and the interval between the observed frames.
+    void BenchLatency(const Options& opt)
+    {
+        if (AvailableSenderSlots() < 1)
+        {
+            Result("latency").add("skipped", "sender limit");
+            return;
+        }
+
+        auto name = MakeName("latency", 0);
+        auto source = CreateTexture(1920, 1080, DXGI_FORMAT_R8G8B8A8_UNORM, D3D11_BIND_SHADER_RESOURCE);
+        auto tx = new SharedObject(SharedObject::Type::sender, name, 1920, 1080, DXGI_FORMAT_R8G8B8A8_UNORM);
+        auto rx = new SharedObject(SharedObject::Type::receiver, name);
+        if (source) tx->setSourceTexture(source, 0);
+
+        if (source && ActivateAll({ tx }) && ActivateAll({ rx }))
+        {
+            const auto frames = std::min(opt.frames, 600);
+
+            std::atomic<double> sent_time(0);
+            std::atomic<bool> running(true);
+            Samples delay, interval;
+
+            std::thread poller([&]
+            {
+                auto last = rx->getFrameCount();
+                auto last_time = 0.0;
+                while (running.load())
+                {
+                    auto count = rx->getFrameCount();
+                    if (count == last) { YieldProcessor(); continue; }
+                    auto now = Now();
+                    delay.add(now - sent_time.load());
+                    if (last_time > 0) interval.add(now - last_time);
+                    last = count;
+                    last_time = now;
+                }
+            });
+
+            for (auto f = 0; f < frames; f++)
+            {
+                auto t0 = Now();
+                sent_time.store(t0);
+                tx->send(context_, *blitter_);
+                context_->Flush();
+                while (Now() - t0 < 1e6 / 60) Sleep(1);
+            }
+
+            running.store(false);
+            poller.join();
+
+            Result("latency")
+                .add("frames", frames)
+                .add("observed", static_cast<int>(!delay.empty()))
+                .add("delay_us", delay).add("interval_us", interval);
+        }
+        else
+        {
+            Result("latency").add("skipped", "activation failed");
+        }
+
+        delete rx;
+        delete tx;
+        if (source) source->Release();
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    auto opt = ParseOptions(argc, argv);
+
+    if (!Initialize())
+    {
+        std::fprintf(stderr, "D3D11 device creation failed\n");
+        return 1;
+    }
+
+    if (!blitter_->isAvailable())
+        std::fprintf(stderr, "Blitter unavailable; the sends are skipped\n");
+
+    std::fprintf(stderr, "Running the matrix benchmark...\n");
+    BenchMatrix(opt);
+
+    std::fprintf(stderr, "Running the churn benchmark...\n");
+    BenchChurn(opt);
+
+    std::fprintf(stderr, "Running the query benchmark...\n");
+    BenchQueries(opt);
+
+    std::fprintf(stderr, "Running the latency benchmark...\n");
+    BenchLatency(opt);
+
+    Finalize();
+    return 0;
+}
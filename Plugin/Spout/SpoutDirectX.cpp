@@ -84,6 +84,9 @@ spoutDirectX::spoutDirectX() {
 
 spoutDirectX::~spoutDirectX() {
 
+	// Release the context retained by CreateDX11device
+	if(g_pImmediateContext) g_pImmediateContext->Release();
+
 }
 
 //
@@ -351,7 +354,8 @@ bool spoutDirectX::CreateSharedDX11Texture(ID3D11Device* pd3dDevice,
 											unsigned int height, 
 											DXGI_FORMAT format, 
 											ID3D11Texture2D** pSharedTexture,
-											HANDLE &dxShareHandle)
+											HANDLE &dxShareHandle,
+											bool bKeyedMutex)
 {
 	ID3D11Texture2D* pTexture;
 	
@@ -390,6 +394,8 @@ bool spoutDirectX::CreateSharedDX11Texture(ID3D11Device* pd3dDevice,
 	desc.MiscFlags			= D3D11_RESOURCE_MISC_SHARED; // This texture will be shared
 	// A DirectX 11 texture with D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX is not compatible with DirectX 9
 	// so a general named mutex is used for all texture types
+	// The keyed mutex can be still requested for DirectX 11 only sharing
+	if(bKeyedMutex) desc.MiscFlags = D3D11_RESOURCE_MISC_SHARED_KEYEDMUTEX;
 	desc.Format				= format;
 	desc.Usage				= D3D11_USAGE_DEFAULT;
 	// Multisampling quality and count
@@ -901,6 +907,62 @@ IDXGIAdapter* spoutDirectX::GetAdapterPointer(int index)
 }
 
 
+// Get the locally unique identifier of an adapter
+// LUIDs identify adapters across processes, unlike the indices.
+bool spoutDirectX::GetAdapterLuid(int index, LUID &luid)
+{
+	IDXGIAdapter* pAdapter = GetAdapterPointer(index);
+	if(!pAdapter) return false;
+
+	DXGI_ADAPTER_DESC desc;
+	bool bRet = SUCCEEDED(pAdapter->GetDesc(&desc));
+	if(bRet) luid = desc.AdapterLuid;
+	pAdapter->Release();
+
+	return bRet;
+}
+
+
+// Get the adapter LUID of a device created by someone else
+bool spoutDirectX::GetDeviceAdapterLuid(ID3D11Device* pDevice, LUID &luid)
+{
+	IDXGIDevice* pDXGIDevice = nullptr;
+	IDXGIAdapter* pAdapter = nullptr;
+	DXGI_ADAPTER_DESC desc;
+	bool bRet = false;
+
+	if(!pDevice) return false;
+
+	if(SUCCEEDED(pDevice->QueryInterface(__uuidof(IDXGIDevice), (void**)&pDXGIDevice))) {
+		if(SUCCEEDED(pDXGIDevice->GetAdapter(&pAdapter))) {
+			if(SUCCEEDED(pAdapter->GetDesc(&desc))) {
+				luid = desc.AdapterLuid;
+				bRet = true;
+			}
+			pAdapter->Release();
+		}
+		pDXGIDevice->Release();
+	}
+
+	return bRet;
+}
+
+
+// Find the index of the adapter with a LUID
+int spoutDirectX::FindAdapter(const LUID &luid)
+{
+	LUID adapterLuid;
+	int nAdapters = GetNumAdapters();
+
+	for(int i = 0; i < nAdapters; i++) {
+		if(GetAdapterLuid(i, adapterLuid) &&
+			adapterLuid.LowPart == luid.LowPart && adapterLuid.HighPart == luid.HighPart)
+			return i;
+	}
+
+	return -1;
+}
+
 bool spoutDirectX::GetAdapterInfo(char *adapter, char *display, int maxchars)
 {
 	IDXGIFactory1* _dxgi_factory1;
@@ -61,7 +61,7 @@ class SPOUT_DLLEXP spoutDirectX {
 
 		// DX11
 		ID3D11Device* CreateDX11device(); // Create a DX11 device
-		bool CreateSharedDX11Texture(ID3D11Device* pDevice, unsigned int width, unsigned int height, DXGI_FORMAT format, ID3D11Texture2D** pSharedTexture, HANDLE &dxShareHandle);
+		bool CreateSharedDX11Texture(ID3D11Device* pDevice, unsigned int width, unsigned int height, DXGI_FORMAT format, ID3D11Texture2D** pSharedTexture, HANDLE &dxShareHandle, bool bKeyedMutex = false);
 		bool CreateDX11StagingTexture(ID3D11Device* pDevice, unsigned int width, unsigned int height, DXGI_FORMAT format, ID3D11Texture2D** pStagingTexture);
 		bool OpenDX11shareHandle(ID3D11Device* pDevice, ID3D11Texture2D** ppSharedTexture, HANDLE dxShareHandle);
 
@@ -72,6 +72,9 @@ class SPOUT_DLLEXP spoutDirectX {
 		int GetAdapter(); // Get the current adapter index
 		bool GetAdapterInfo(char *renderdescription, char *displaydescription, int maxchars);
 		bool FindNVIDIA(int &nAdapter); // Find the index of the NVIDIA adapter in a multi-adapter system
+		bool GetAdapterLuid(int index, LUID &luid); // Get the locally unique identifier of an adapter
+		bool GetDeviceAdapterLuid(ID3D11Device* pDevice, LUID &luid); // Get the adapter LUID of a device
+		int FindAdapter(const LUID &luid); // Find the index of the adapter with a LUID (-1 if not found)
 
 		// Registry read/write - 20.11.15 - moved from interop class
 		bool ReadDwordFromRegistry(DWORD *pValue, const char *subkey, const char *valuename);
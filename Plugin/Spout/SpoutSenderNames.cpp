@@ -75,6 +75,12 @@
 spoutSenderNames::spoutSenderNames() {
 	m_senders = new std::unordered_map<std::string, SpoutSharedMemory*>();
 	m_MaxSenders = 10; // default maximum number of senders
+	m_senderNameIndex = new std::unordered_map<std::string, int>();
+	m_senderNameKey = new std::string();
+	m_bVersionedDirectory = false;
+	m_bSenderNameIndexValid = false;
+	m_senderNameIndexGeneration = 0;
+	m_senderNameIndexTime = 0;
 }
 
 spoutSenderNames::~spoutSenderNames() {
@@ -86,6 +92,8 @@ spoutSenderNames::~spoutSenderNames() {
 		delete itr->second;
 	}
 	delete m_senders;
+	delete m_senderNameIndex;
+	delete m_senderNameKey;
 	
 }
 
@@ -98,32 +106,31 @@ spoutSenderNames::~spoutSenderNames() {
 //
 bool spoutSenderNames::RegisterSenderName(const char* Sendername) {
 
-	std::pair<std::set<std::string>::iterator, bool> ret;
-	std::set<std::string> SenderNames; // set of names
-
 	// Create the shared memory for the sender name set if it does not exist
 	if(!CreateSenderSet())	return false;
 
 	char *pBuf = m_senderNames.Lock();
 	if (!pBuf) return false;
 
-	// Register the sender name in the list of spout senders
-	readSenderSetFromBuffer(pBuf, SenderNames, m_MaxSenders);
-
-	//
-	// Add the Sender name to the set of names
-	//
-	ret = SenderNames.insert(Sendername);
-	if(!ret.second) {
+	// The name is appended to the end of the list in place, so that only a
+	// single slot is written under the mutex.
+	int count;
+	int index = findSenderSlot(pBuf, Sendername, count, m_MaxSenders);
+	if(index >= 0) {
 		// See if there are any dangling entries that aren't valid anymore
 		cleanSenderSet();
-		readSenderSetFromBuffer(pBuf, SenderNames, m_MaxSenders);
-		ret = SenderNames.insert(Sendername);
+		index = findSenderSlot(pBuf, Sendername, count, m_MaxSenders);
 	}
 
-	if(ret.second) {
-		// write the new map to shared memory
-		writeBufferFromSenderSet(SenderNames, pBuf, m_MaxSenders);
+	bool bAdded = index < 0 && count < m_MaxSenders;
+
+	if(bAdded) {
+		// write the new name to shared memory
+		char *slot = pBuf + count * SpoutMaxSenderNameLen;
+		strncpy_s(slot, SpoutMaxSenderNameLen, Sendername, _TRUNCATE);
+		// Terminate the list (the slot may contain a stale name)
+		if(count + 1 < m_MaxSenders) slot[SpoutMaxSenderNameLen] = '\0';
+		bumpSenderSetGeneration();
 		// Set as the active Sender if it is the first one registered
 		// Thereafter the user can select an active Sender using SpoutPanel or SpoutSenders
 		m_activeSender.Create("ActiveSenderName", SpoutMaxSenderNameLen);
@@ -135,7 +142,7 @@ bool spoutSenderNames::RegisterSenderName(const char* Sendername) {
 
 	m_senderNames.Unlock();
 
-	return ret.second;
+	return bAdded;
 }
 
 //
@@ -143,58 +150,75 @@ bool spoutSenderNames::RegisterSenderName(const char* Sendername) {
 //
 bool spoutSenderNames::ReleaseSenderName(const char* Sendername) 
 {
-	std::set<std::string> SenderNames;
-	std::string namestring;
+	return ReleaseSenderNames(std::vector<std::string>(1, Sendername)) > 0;
+
+} // end RemoveSender
+
+
+//
+// Removes multiple Senders from the set of Sender names under a single lock
+// Returns the number of the names removed.
+//
+int spoutSenderNames::ReleaseSenderNames(const std::vector<std::string>& Sendernames)
+{
 	char name[SpoutMaxSenderNameLen];
+	bool bActiveReleased = false;
+	int released = 0;
 
 	// Create the shared memory for the sender name set if it does not exist
-	if(!CreateSenderSet())	return false;
+	if(!CreateSenderSet())	return 0;
 
 	char *pBuf = m_senderNames.Lock();
-	if (!pBuf) return false;
+	if (!pBuf) return 0;
 
-	namestring = Sendername;
-	auto foundSender = m_senders->find(namestring);
-	if (foundSender != m_senders->end()) {
-		delete foundSender->second;
-		m_senders->erase(namestring);
-	}
+	bool bActive = getActiveSenderName(name);
 
-	readSenderSetFromBuffer(pBuf, SenderNames, m_MaxSenders);
+	int count = 0;
+	for(const auto& namestring : Sendernames) {
 
-	// Discovered that the project properties had been set to CLI
-	// Properties -> General -> Common Language Runtime Support
-	// and this caused the set "find" function not to work.
-	// It also disabled intellisense.
+		auto foundSender = m_senders->find(namestring);
+		if (foundSender != m_senders->end()) {
+			delete foundSender->second;
+			m_senders->erase(foundSender);
+		}
 
-	// Get the current map to update the list
-	if(SenderNames.find(Sendername) != SenderNames.end() ) {
+		// Remove the name in place: The last name is moved into the slot, and
+		// the list is terminated at the former last slot.
+		int index = findSenderSlot(pBuf, namestring.c_str(), count, m_MaxSenders);
+		if(index < 0) continue;
 
-		SenderNames.erase(Sendername); // erase the matching Sender
+		char *last = pBuf + (count - 1) * SpoutMaxSenderNameLen;
+		if(index != count - 1) {
+			memcpy(pBuf + index * SpoutMaxSenderNameLen, last, SpoutMaxSenderNameLen);
+		}
+		*last = '\0';
+		count--;
+		released++;
 
-		writeBufferFromSenderSet(SenderNames, pBuf, m_MaxSenders);
+		if(bActive && namestring == name) bActiveReleased = true;
+	}
+
+	if(released > 0) {
+
+		bumpSenderSetGeneration();
 
 		// Is there a set left ?
-		if(SenderNames.size() > 0) {
+		if(count > 0) {
 			// This should be OK because the user selects the active sender
 			// Was it the active sender ?
-			if( (getActiveSenderName(name) && strcmp(name, Sendername) == 0) || SenderNames.size() == 1) { 
+			if(bActiveReleased || count == 1) { 
 				// It was, so choose the first in the list
-				std::set<std::string>::iterator iter = SenderNames.begin();
-				namestring = *iter;
-				strcpy_s(name, namestring.c_str());
+				strncpy_s(name, SpoutMaxSenderNameLen, pBuf, _TRUNCATE);
 				// Set it as the active sender
 				setActiveSenderName(name);
 			}
 		}
-		m_senderNames.Unlock();
-		return true;
 	}
 
 	m_senderNames.Unlock();
-	return false; // Sender name not in the set or no set in shared mempry
+	return released;
 
-} // end RemoveSender
+} // end ReleaseSenderNames
 
 
 
@@ -205,6 +229,10 @@ bool spoutSenderNames::FindSenderName(const char* Sendername)
 	std::set<std::string> SenderNames;
 	
 	if(Sendername[0]) { // was a valid name passed
+		// Use the local index if the versioned directory mode is enabled
+		if(m_bVersionedDirectory) {
+			return findSenderNameIndexed(Sendername);
+		}
 		// Get the current list to update the passed list
 		if(GetSenderSet(SenderNames)) {
 			// Does the name exist
@@ -243,8 +271,8 @@ void spoutSenderNames::cleanSenderSet()
 			continue;
 		}
 		SpoutSharedMemory mem;
-		// This isn't found, we clean it up
-		if (!mem.Open((*itr).c_str()))
+		// This isn't found (or its sender has stopped beating), we clean it up
+		if (!mem.Open((*itr).c_str()) || !isSenderAlive(mem))
 		{
 			changed = true;
 			SenderNames.erase(itr++);
@@ -259,6 +287,7 @@ void spoutSenderNames::cleanSenderSet()
 	if (changed)
 	{
 		writeBufferFromSenderSet(SenderNames, pBuf, m_MaxSenders);
+		bumpSenderSetGeneration();
 	}
 
 	m_senderNames.Unlock();
@@ -278,6 +307,39 @@ bool spoutSenderNames::GetSenderNames(std::set<std::string> *Sendernames)
 }
 
 
+// Copy the sender names into the buffer in one go.
+int spoutSenderNames::GetSenderNameList(char* buffer, int maxNames)
+{
+	if (!CreateSenderSet()) {
+		return 0;
+	}
+
+	const char *pBuf = m_senderNames.Lock();
+	if (!pBuf) {
+		return 0;
+	}
+
+	int count = 0;
+	for (int i = 0; i < m_MaxSenders && pBuf[0]; i++) {
+		if (count < maxNames) {
+			strncpy_s(buffer + count * SpoutMaxSenderNameLen, SpoutMaxSenderNameLen, pBuf, _TRUNCATE);
+		}
+		count++;
+		pBuf += SpoutMaxSenderNameLen;
+	}
+
+	m_senderNames.Unlock();
+
+	return count;
+}
+
+
+bool spoutSenderNames::GetSenderSetGeneration(LONG &generation)
+{
+	return getSenderSetGeneration(generation);
+}
+
+
 int spoutSenderNames::GetSenderCount() {
 
 	std::set<std::string> SenderSet;
@@ -393,6 +455,29 @@ int spoutSenderNames::GetMaxSenders()
 }
 
 
+//
+// Versioned directory mode
+//
+// The existence check is answered from a local index of the sender name list.
+// The index is rebuilt only when the generation counter has been changed by a
+// writer. Apps that don't know the counter can still modify the list, so
+// positive results are verified against the slot in shared memory, and
+// negative results are rechecked every SPOUT_DIRECTORY_REFRESH msec.
+//
+void spoutSenderNames::SetVersionedDirectory(bool bVersioned)
+{
+	m_bVersionedDirectory = bVersioned;
+	m_bSenderNameIndexValid = false;
+	m_senderNameIndex->clear();
+}
+
+
+bool spoutSenderNames::GetVersionedDirectory()
+{
+	return m_bVersionedDirectory;
+}
+
+
 // This retrieves the info from the requested sender and fails if the sender does not exist
 // For external access to getSharedInfo - redundancy
 bool spoutSenderNames::GetSenderInfo(const char* sendername, unsigned int &width, unsigned int &height, HANDLE &dxShareHandle, DWORD &dwFormat)
@@ -434,13 +519,6 @@ bool spoutSenderNames::SetSenderInfo(const char* sendername, unsigned int width,
 
 	auto senderInfoMap = foundSender->second;
 
-	char *pBuf = senderInfoMap->Lock();
-
-	if (!pBuf)
-	{
-		return false;
-	}
-	
 	info.width       = (unsigned __int32)width;
 	info.height      = (unsigned __int32)height;
 #ifdef _M_X64
@@ -452,11 +530,8 @@ bool spoutSenderNames::SetSenderInfo(const char* sendername, unsigned int width,
 	info.format      = (unsigned __int32)dwFormat;
 	// Usage not used
 
-	memcpy((void *)pBuf, (void *)&info, sizeof(SharedTextureInfo) );
-
-	senderInfoMap->Unlock();
-	
-	return true;
+	// This is our own map, so advertise the lock-free read protocol
+	return writeSharedInfo(*senderInfoMap, &info, true);
 
 } // end SetSenderInfo
 
@@ -604,7 +679,7 @@ bool spoutSenderNames::UpdateSender(const char *sendername, unsigned int width,
 	if (m_senders->find(namestring) == m_senders->end()) {
 		// Create or open a shared memory map for this sender - allocate enough for the texture info
 		SpoutSharedMemory *senderInfoMem = new SpoutSharedMemory();
-		SpoutCreateResult result = senderInfoMem->Create(sendername, sizeof(SharedTextureInfo));
+		SpoutCreateResult result = senderInfoMem->Create(sendername, sizeof(SharedTextureInfo) + sizeof(SharedTextureInfoExt));
 		if(result == SPOUT_CREATE_FAILED) {
 			delete senderInfoMem;
 			m_senderNames.Unlock();
@@ -730,6 +805,110 @@ bool spoutSenderNames::CheckSender(const char *sendername, unsigned int &theWidt
 // Private functions for multiple Sender support //
 ///////////////////////////////////////////////////
 
+// Generation counter retrieval - no lock as the counter is accessed atomically
+bool spoutSenderNames::getSenderSetGeneration(LONG &generation)
+{
+	// Open or create the counter with the sender name list
+	if (!CreateSenderSet()) {
+		return false;
+	}
+
+	volatile LONG *pCounter = (volatile LONG *)m_senderNamesGeneration.Buffer();
+	if (!pCounter) {
+		return false;
+	}
+
+	generation = InterlockedCompareExchange(pCounter, 0, 0);
+	return true;
+}
+
+
+// Notify the change of the sender name list to the versioned directory readers
+void spoutSenderNames::bumpSenderSetGeneration()
+{
+	volatile LONG *pCounter = (volatile LONG *)m_senderNamesGeneration.Buffer();
+	if (pCounter) {
+		InterlockedIncrement(pCounter);
+	}
+}
+
+
+bool spoutSenderNames::findSenderNameIndexed(const char* Sendername)
+{
+	LONG generation;
+
+	// Fall back to the full scan when the counter is not available
+	if (!getSenderSetGeneration(generation)) {
+		std::set<std::string> SenderNames;
+		return GetSenderSet(SenderNames) && SenderNames.find(Sendername) != SenderNames.end();
+	}
+
+	bool bCurrent = m_bSenderNameIndexValid && generation == m_senderNameIndexGeneration;
+
+	if (bCurrent) {
+		m_senderNameKey->assign(Sendername);
+		auto found = m_senderNameIndex->find(*m_senderNameKey);
+		if (found != m_senderNameIndex->end()) {
+			// Verify the slot in case of a writer that doesn't bump the counter
+			const char *pBuf = m_senderNames.Buffer();
+			if (pBuf && found->second < m_MaxSenders &&
+				strncmp(pBuf + found->second * SpoutMaxSenderNameLen, Sendername, SpoutMaxSenderNameLen) == 0) {
+				return true;
+			}
+		}
+		else if (GetTickCount() - m_senderNameIndexTime < SPOUT_DIRECTORY_REFRESH) {
+			return false;
+		}
+	}
+
+	rebuildSenderNameIndex(generation);
+
+	m_senderNameKey->assign(Sendername);
+	return m_senderNameIndex->find(*m_senderNameKey) != m_senderNameIndex->end();
+}
+
+
+// Rebuild the local index from the legacy name slots
+void spoutSenderNames::rebuildSenderNameIndex(LONG generation)
+{
+	char *pBuf = m_senderNames.Lock();
+	if (!pBuf) {
+		// Keep the current index. It will be retried on the next call.
+		return;
+	}
+
+	m_senderNameIndex->clear();
+
+	const char *buf = pBuf;
+	for (int i = 0; i < m_MaxSenders && buf[0]; i++) {
+		m_senderNameIndex->emplace(std::string(buf, strnlen(buf, SpoutMaxSenderNameLen)), i);
+		buf += SpoutMaxSenderNameLen;
+	}
+
+	m_senderNames.Unlock();
+
+	m_bSenderNameIndexValid = true;
+	m_senderNameIndexGeneration = generation;
+	m_senderNameIndexTime = GetTickCount();
+}
+
+
+// Find the slot of the name in the list. It also counts the used slots.
+// Returns -1 when the name is not found.
+int spoutSenderNames::findSenderSlot(const char* buffer, const char* Sendername, int &count, int maxSenders)
+{
+	int index = -1;
+	const char *buf = buffer;
+	for(count = 0; count < maxSenders && buf[0]; count++) {
+		if(index < 0 && strncmp(buf, Sendername, SpoutMaxSenderNameLen) == 0) {
+			index = count;
+		}
+		buf += SpoutMaxSenderNameLen;
+	}
+	return index;
+}
+
+
 void spoutSenderNames::readSenderSetFromBuffer(const char* buffer, std::set<std::string>& SenderNames, int maxSenders)
 {
 	// first empty the set
@@ -803,6 +982,10 @@ bool spoutSenderNames::CreateSenderSet()
 		return false;
 	}
 
+	// The generation counter of the list. Failure is not fatal because only
+	// the versioned directory mode depends on it.
+	m_senderNamesGeneration.Create("SpoutSenderNamesGeneration", sizeof(LONG));
+
 	return true;
 
 } // end CreateSenderSet
@@ -903,12 +1086,11 @@ bool spoutSenderNames::getSharedInfo(const char* sharedMemoryName, SharedTexture
 
 	// Possibly faster because the functon is called all the time
 	if(mem.Open(sharedMemoryName)) {
-		char *pBuf = mem.Lock();
-		if(pBuf) {
-			memcpy((void *)info, (void *)pBuf, sizeof(SharedTextureInfo) );
-			mem.Unlock();
-			return true;
+		// The map can be kept open by the receivers of a crashed sender
+		if(!isSenderAlive(mem)) {
+			return false;
 		}
+		return readSharedInfo(mem, info);
 	}
 
 	return false;
@@ -916,28 +1098,149 @@ bool spoutSenderNames::getSharedInfo(const char* sharedMemoryName, SharedTexture
 } // end getSharedInfo
 
 
-// 12.06.15 - Added to allow direct modification of a sender's information in shared memory
-bool spoutSenderNames::setSharedInfo(const char* sharedMemoryName, SharedTextureInfo* info) 
+// Copy the texture info out of a sender memory map opened by the caller
+// Uses the seqlock when the sender supports it, so it never blocks on the
+// mutex held by a stalled sender. Falls back to the mutex otherwise.
+bool spoutSenderNames::readSharedInfo(SpoutSharedMemory& mem, SharedTextureInfo* info)
 {
-	SpoutSharedMemory mem;
-	bool result = mem.Open(sharedMemoryName);
+	if(tryReadSharedInfo(mem, info)) {
+		return true;
+	}
 
-	if (!result) {
+	// Too busy or not supported - take the mutex path instead
+	char *pBuf = mem.Lock();
+
+	if(!pBuf) {
 		return false;
 	}
 
+	memcpy((void *)info, (void *)pBuf, sizeof(SharedTextureInfo) );
+
+	mem.Unlock();
+
+	return true;
+
+} // end readSharedInfo
+
+
+// Seqlock-only version of readSharedInfo
+// It only reads the memory, so it can be used in the places where waiting
+// on the mutex isn't allowed.
+bool spoutSenderNames::tryReadSharedInfo(SpoutSharedMemory& mem, SharedTextureInfo* info)
+{
+	SharedTextureInfoExt *pExt = getSharedInfoExt(mem);
+
+	if(!pExt) {
+		return false;
+	}
+
+	const char *pSrc = mem.Buffer();
+	for(int i = 0; i < SPOUT_SEQLOCK_RETRIES; i++) {
+		LONG seq = InterlockedCompareExchange(&pExt->sequence, 0, 0);
+		if(seq & 1) {
+			// The sender is in the middle of writing
+			YieldProcessor();
+			continue;
+		}
+		memcpy((void *)info, (const void *)pSrc, sizeof(SharedTextureInfo) );
+		MemoryBarrier();
+		if(InterlockedCompareExchange(&pExt->sequence, 0, 0) == seq) {
+			return true;
+		}
+	}
+
+	return false;
+
+} // end tryReadSharedInfo
+
+
+// Write the texture info to a sender memory map opened by the caller
+// The mutex is still taken for the apps that only know the mutex protocol.
+// bAdvertise must be true only if the map was created with the extension block.
+bool spoutSenderNames::writeSharedInfo(SpoutSharedMemory& mem, const SharedTextureInfo* info, bool bAdvertise)
+{
 	char *pBuf = mem.Lock();
 
-	if (!pBuf)	{
+	if(!pBuf) {
 		return false;
 	}
 
-	memcpy((void *)pBuf, (void *)info, sizeof(SharedTextureInfo) );
+	SharedTextureInfoExt *pExt = (SharedTextureInfoExt *)(pBuf + sizeof(SharedTextureInfo));
+	if(!bAdvertise && pExt->magic != SPOUT_INFO_EXT_MAGIC) {
+		pExt = NULL;
+	}
+
+	if(pExt) InterlockedIncrement(&pExt->sequence); // odd - write in progress
+
+	memcpy((void *)pBuf, (const void *)info, sizeof(SharedTextureInfo) );
+
+	if(pExt) {
+		// Start the heartbeat before the block is visible to readers
+		InterlockedExchange(&pExt->heartbeat, (LONG)(GetTickCount() | 1));
+		pExt->magic = SPOUT_INFO_EXT_MAGIC;
+		InterlockedIncrement(&pExt->sequence); // even - done
+	}
 
 	mem.Unlock();
-	
+
 	return true;
 
+} // end writeSharedInfo
+
+
+SharedTextureInfoExt* spoutSenderNames::getSharedInfoExt(SpoutSharedMemory& mem)
+{
+	char *pBuf = mem.Buffer();
+
+	if(!pBuf) {
+		return NULL;
+	}
+
+	SharedTextureInfoExt *pExt = (SharedTextureInfoExt *)(pBuf + sizeof(SharedTextureInfo));
+	return pExt->magic == SPOUT_INFO_EXT_MAGIC ? pExt : NULL;
+
+} // end getSharedInfoExt
+
+
+bool spoutSenderNames::isSenderAlive(SpoutSharedMemory& mem)
+{
+	SharedTextureInfoExt *pExt = getSharedInfoExt(mem);
+
+	if(!pExt) {
+		return true;
+	}
+
+	DWORD beat = (DWORD)InterlockedCompareExchange(&pExt->heartbeat, 0, 0);
+	return beat != 0 && (LONG)(GetTickCount() - beat) < SPOUT_HEARTBEAT_TIMEOUT;
+
+} // end isSenderAlive
+
+
+// The tick count is made odd, so that a live heartbeat is never zero.
+void spoutSenderNames::writeHeartbeat(SpoutSharedMemory& mem, bool bAlive)
+{
+	SharedTextureInfoExt *pExt = getSharedInfoExt(mem);
+
+	if(pExt) {
+		InterlockedExchange(&pExt->heartbeat, bAlive ? (LONG)(GetTickCount() | 1) : 0);
+	}
+
+} // end writeHeartbeat
+
+
+// 12.06.15 - Added to allow direct modification of a sender's information in shared memory
+bool spoutSenderNames::setSharedInfo(const char* sharedMemoryName, SharedTextureInfo* info) 
+{
+	SpoutSharedMemory mem;
+	bool result = mem.Open(sharedMemoryName);
+
+	if (!result) {
+		return false;
+	}
+
+	// Keep the seqlock consistent if the sender uses it
+	return writeSharedInfo(mem, info, false);
+
 } // end getSharedInfo
 
 
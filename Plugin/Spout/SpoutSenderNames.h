@@ -52,6 +52,7 @@
 #define SPOUT_WAIT_TIMEOUT 100 // 100 msec wait for events
 // Now replaced by a global class variable // #define MaxSenders 10 // Max for list of Sender names
 #define SpoutMaxSenderNameLen 256
+#define SPOUT_DIRECTORY_REFRESH 500 // 500 msec interval for rechecking missing names
 
 // The texture information structure that is saved to shared memory
 // and used for communication between senders and receivers
@@ -75,6 +76,118 @@ struct SharedTextureInfo {
 	unsigned __int32 partnerId; // Wyphon id of partner that shared it with us (not unused)
 };
 
+// Extension block placed right after SharedTextureInfo in a sender memory map
+// Senders that know it create the map large enough to contain the block and
+// put the magic number in it. Other apps create the map with the size of
+// SharedTextureInfo, but as a mapped view is page granular, the block is still
+// readable and contains zero, which is how a legacy sender is detected.
+//
+// The sequence number is a seqlock counter. It's odd while the sender is
+// writing the info, so readers can take a consistent copy without the mutex.
+//
+// The frame count is incremented by the sender every time it has finished
+// updating the shared texture. Receivers can skip their work while it stays
+// unchanged. It's not covered by the seqlock; access it atomically.
+//
+// In the ring buffer mode, the sender draws the frames into ringCount back
+// buffers (shared textures listed in ringHandles) in turn, and stores the
+// index of the latest one in ringLatest. Each frame is also copied into the
+// texture in SharedTextureInfo, so legacy receivers still get every frame.
+// The handles are written before ringCount, and ringCount is zero in the
+// single buffer mode. ringLatest is published after the commands have been
+// flushed, but nothing tells that the GPU has completed them.
+//
+// Receivers that can't open the shared texture (e.g. on another adapter)
+// store GetTickCount() in pixelRequest periodically. While it's recent, the
+// sender copies the frames into the pixel map described below.
+//
+// The adapter LUID is the one of the device that created the shared texture.
+// Both parts are zero when unknown. Receivers on another adapter can't open
+// the texture, so they can go to the pixel map without trying.
+//
+// Senders in the timestamp mode store the QPC value at the time of the copy
+// in frameTime, and the number of the frame (the frame count after the
+// increment) in timedFrame. timedFrame is cleared before and set after
+// writing frameTime, so a reader that sees the same nonzero value on both
+// sides of reading frameTime has a consistent pair. QPC is system-wide, so
+// receivers can subtract it from their own QPC value to get the latency.
+//
+// Senders store GetTickCount() (never zero) in heartbeat when they start and
+// periodically while they're alive, from a thread that doesn't depend on
+// their frame rate, and clear it when they stop. The map outlives a crashed
+// sender while other apps keep it open, so being able to open it doesn't
+// tell that the sender is alive. A sender with the block is regarded as gone
+// when the heartbeat is zero or older than SPOUT_HEARTBEAT_TIMEOUT.
+#define SPOUT_INFO_EXT_MAGIC 0x4B535058 // "XPSK"
+#define SPOUT_SEQLOCK_RETRIES 64 // tries before falling back to the mutex
+#define SPOUT_RING_MAX 3 // maximum number of the ring (back) buffers
+#define SPOUT_HEARTBEAT_INTERVAL 250 // msec between heartbeats
+#define SPOUT_HEARTBEAT_TIMEOUT 2000 // msec without heartbeats before a sender is regarded as gone
+struct SharedTextureInfoExt {
+	unsigned __int32 magic;
+	volatile LONG sequence;
+	volatile LONG frameCount;
+	volatile LONG ringCount;
+	volatile LONG ringLatest;
+	unsigned __int32 ringHandles[SPOUT_RING_MAX];
+	volatile LONG pixelRequest;
+	unsigned __int32 adapterLuidLow;
+	__int32 adapterLuidHigh;
+	volatile LONGLONG frameTime;
+	volatile LONG timedFrame;
+	volatile LONG heartbeat;
+};
+
+// Pixel map: CPU fallback transport
+// A memory map named "<sender name>_pixels", which contains this header and
+// SPOUT_PIXEL_SLOTS frame slots (slotSize bytes each) right after it. The
+// sender writes the frames into the slots in turn and stores the index of the
+// latest completed one in latest (-1 until the first frame). Each slot has a
+// seqlock counter that is odd while the slot is being written, so receivers
+// can detect a torn copy without taking the mutex.
+#define SPOUT_PIXEL_MAGIC 0x4B535850 // "PXSK"
+#define SPOUT_PIXEL_SLOTS 3
+#define SPOUT_PIXEL_SUFFIX "_pixels"
+#define SPOUT_PIXEL_TIMEOUT 1000 // msec without requests before stopping
+struct SharedPixelHeader {
+	unsigned __int32 magic;
+	unsigned __int32 mapSize; // total size of the map
+	unsigned __int32 width;
+	unsigned __int32 height;
+	DWORD format;
+	unsigned __int32 rowPitch;
+	unsigned __int32 slotSize;
+	volatile LONG latest;
+	volatile LONG frameCount;
+	volatile LONG sequence[SPOUT_PIXEL_SLOTS];
+};
+
+// Atlas map: Sub-rect table of an atlas sender
+// An atlas sender packs many small frames into its shared texture. The map
+// named "<sender name>_atlas" contains this header and SPOUT_ATLAS_MAX region
+// entries right after it. A region is a named rectangle in the shared texture
+// (in texels, the top-left origin); entries with zero width are unused. The
+// sequence number is a seqlock counter that is odd while the sender is
+// rewriting the entries. The generation is incremented on every rewrite, so
+// receivers can cache their lookups while it stays the same.
+#define SPOUT_ATLAS_MAGIC 0x4B535441 // "ATSK"
+#define SPOUT_ATLAS_MAX 128
+#define SPOUT_ATLAS_NAME_LEN 64
+#define SPOUT_ATLAS_SUFFIX "_atlas"
+struct SharedAtlasRegion {
+	char name[SPOUT_ATLAS_NAME_LEN];
+	unsigned __int32 x;
+	unsigned __int32 y;
+	unsigned __int32 width;
+	unsigned __int32 height;
+};
+struct SharedAtlasHeader {
+	unsigned __int32 magic;
+	volatile LONG sequence;
+	volatile LONG generation;
+	unsigned __int32 count; // number of the entries in use (including holes)
+};
+
 
 class SPOUT_DLLEXP spoutSenderNames {
 
@@ -89,6 +202,7 @@ class SPOUT_DLLEXP spoutSenderNames {
 		// You must first register a sender name being using
 		bool RegisterSenderName(const char* senderName);
 		bool ReleaseSenderName(const char* senderName);
+		int  ReleaseSenderNames(const std::vector<std::string>& senderNames); // batched release
 		bool FindSenderName     (const char* Sendername);
 
 		// ------------------------------------------------------------
@@ -97,11 +211,28 @@ class SPOUT_DLLEXP spoutSenderNames {
 		int  GetSenderCount();
 		bool GetSenderNameInfo (int index, char* sendername, int sendernameMaxSize, unsigned int &width, unsigned int &height, HANDLE &dxShareHandle);
 
+		// Bulk retrieval of the sender names without allocation
+		// Copies the names into the caller's buffer (SpoutMaxSenderNameLen
+		// bytes for each) and returns the total number of the senders, which
+		// can be larger than maxNames.
+		int  GetSenderNameList (char* buffer, int maxNames);
+
+		// Generation counter of the sender name list. Returns false when the
+		// counter is not available.
+		bool GetSenderSetGeneration (LONG &generation);
+
 		// ------------------------------------------------------------
 		// New for 2.005
 		int GetMaxSenders();
 		void SetMaxSenders(int maxSenders); // Set the maximum number of senders in a new sender map
 
+		// ------------------------------------------------------------
+		// Versioned directory mode
+		// FindSenderName uses a local name index that is only rebuilt when
+		// the generation counter of the sender name list has changed.
+		void SetVersionedDirectory(bool bVersioned);
+		bool GetVersionedDirectory();
+
 		// ------------------------------------------------------------
 		// Functions to read and write info to a sender memory map
 		bool GetSenderInfo (const char* sendername, unsigned int &width, unsigned int &height, HANDLE &dxShareHandle, DWORD &dwFormat);
@@ -111,6 +242,24 @@ class SPOUT_DLLEXP spoutSenderNames {
 		bool getSharedInfo (const char* SenderName, SharedTextureInfo* info);
 		bool setSharedInfo (const char* SenderName, SharedTextureInfo* info);
 
+		// Sender map info retrieval from a memory map that is already open.
+		// Lets a receiver keep the map of its sender open for the lifetime
+		// of the connection instead of reopening it on every check.
+		static bool readSharedInfo (SpoutSharedMemory& mem, SharedTextureInfo* info);
+		// Same as above without the mutex fallback. Returns false when the
+		// seqlock read doesn't succeed or the sender doesn't support it.
+		static bool tryReadSharedInfo (SpoutSharedMemory& mem, SharedTextureInfo* info);
+		static bool writeSharedInfo (SpoutSharedMemory& mem, const SharedTextureInfo* info, bool bAdvertise);
+
+		// Returns the extension block of an open sender memory map, or NULL
+		// when the sender doesn't support it.
+		static SharedTextureInfoExt* getSharedInfoExt (SpoutSharedMemory& mem);
+
+		// Heartbeat of the sender in an open sender memory map
+		// A sender without the extension block is always regarded as alive.
+		static bool isSenderAlive (SpoutSharedMemory& mem);
+		static void writeHeartbeat (SpoutSharedMemory& mem, bool bAlive);
+
 		// ------------------------------------------------------------
 		// Functions to maintain the active sender
 		bool SetActiveSender     (const char* Sendername);
@@ -144,13 +293,29 @@ protected:
 		// any that shouldn't still be around
 		void cleanSenderSet();
 
+		// Generation counter of the sender name list
+		bool getSenderSetGeneration(LONG &generation);
+		void bumpSenderSetGeneration();
+
+		// Versioned directory mode functions
+		bool findSenderNameIndexed(const char* Sendername);
+		void rebuildSenderNameIndex(LONG generation);
+
 		// Functions to manage shared memory map access
+		// The list is a sequence of SpoutMaxSenderNameLen slots terminated by
+		// an empty one. Registration and release update it slot by slot.
+		static int  findSenderSlot(const char* buffer, const char* Sendername, int &count, int maxSenders);
 		static void readSenderSetFromBuffer(const char* buffer, std::set<std::string>& SenderNames, int maxSenders);
 		static void	writeBufferFromSenderSet(const std::set<std::string>& SenderNames, char *buffer, int maxSenders);
 
 		SpoutSharedMemory	m_senderNames;
 		SpoutSharedMemory	m_activeSender;
 
+		// Generation counter bumped by every writer of the sender name list.
+		// It lives in a separate map so the name slot layout read by other
+		// Spout apps is left untouched.
+		SpoutSharedMemory	m_senderNamesGeneration;
+
 		// This should be a unordered_map of sender names ->SharedMemory
 		// to handle multiple inputs and outputs all going through the
 		// same spoutSenderNames class
@@ -159,6 +324,15 @@ protected:
 		std::unordered_map<std::string, SpoutSharedMemory*>*	m_senders;
 		int m_MaxSenders; // user defined maximum for the number of senders - development testing only
 
+		// Local index of the sender name list (name -> slot) for the versioned
+		// directory mode. Pointers for the same reason as above.
+		std::unordered_map<std::string, int>*	m_senderNameIndex;
+		std::string*	m_senderNameKey; // reused lookup key to avoid allocations
+		bool	m_bVersionedDirectory;
+		bool	m_bSenderNameIndexValid;
+		LONG	m_senderNameIndexGeneration;
+		DWORD	m_senderNameIndexTime;
+
 };
 
 #endif
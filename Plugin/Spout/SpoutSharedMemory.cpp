@@ -37,10 +37,42 @@ http://www.codeproject.com/Articles/835818/Ultimate-Shared-Memory-A-flexible-cla
 
 #include "SpoutSharedMemory.h"
 #include <assert.h>
+#include <mutex>
 #include <string>
+#include <unordered_map>
+
+// Process-wide mapping cache
+// Maps opened with the same name in the process (senders, receivers, the
+// sender list and temporary opens by the info queries) share a single view
+// and mutex handle, which are reference counted. The handles are closed when
+// the last reference is released. They're never kept beyond it, as the
+// existence of a map tells other processes that the sender is alive.
+struct SpoutSharedMemory::Mapping
+{
+	std::string name;
+	HANDLE hMap;
+	HANDLE hMutex;
+	char* pBuffer;
+	int refCount;
+
+	// They're never destroyed, so that maps can be closed while the process
+	// is exiting.
+	static std::mutex& CacheLock()
+	{
+		static std::mutex* lock = new std::mutex();
+		return *lock;
+	}
+
+	static std::unordered_map<std::string, Mapping*>& Cache()
+	{
+		static std::unordered_map<std::string, Mapping*>* cache = new std::unordered_map<std::string, Mapping*>();
+		return *cache;
+	}
+};
 
 SpoutSharedMemory::SpoutSharedMemory()
 {
+	m_pMapping = NULL;
 	m_pBuffer = NULL;
 	m_hMutex = NULL;
 	m_hMap = NULL;
@@ -54,76 +86,124 @@ SpoutSharedMemory::~SpoutSharedMemory()
 	Close();
 }
 
-// Create a new memory segment, or attach to an existing one
-SpoutCreateResult SpoutSharedMemory::Create(const char* name, int size)
+// Find the mapping in the cache, or create (open) a new one and add it.
+SpoutSharedMemory::Mapping* SpoutSharedMemory::AcquireMapping(const char* name, int size, bool create, SpoutCreateResult& result)
 {
-	DWORD err;
-
-	// Don't call open twice on the same object without a Close()
-	assert(name);
-	assert(size);
-
-	if (m_hMap != NULL)	{
-		assert(strcmp(name, m_pName) == 0);
-		assert(m_pBuffer && m_hMutex);
-		return SPOUT_ALREADY_CREATED;
+	std::lock_guard<std::mutex> guard(Mapping::CacheLock());
+	std::unordered_map<std::string, Mapping*>& cache = Mapping::Cache();
+
+	std::unordered_map<std::string, Mapping*>::iterator found = cache.find(name);
+	if (found != cache.end()) {
+		found->second->refCount++;
+		result = SPOUT_ALREADY_EXISTS;
+		return found->second;
 	}
 
+	result = SPOUT_CREATE_FAILED;
+
 	// https://msdn.microsoft.com/en-us/library/windows/desktop/aa366537%28v=vs.85%29.aspx
 	// Creates or opens a named or unnamed file mapping object for a specified file.
 	// If hFile is INVALID_HANDLE_VALUE, the calling process must also specify a size
 	// for the file mapping object in the dwMaximumSizeHigh and dwMaximumSizeLow parameters.
 	// In this scenario, CreateFileMapping creates a file mapping object of a specified size
 	// that is backed by the system paging file instead of by a file in the file system.
+	HANDLE hMap = create ?
+		CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, size, (LPCSTR)name) :
+		OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, (LPCSTR)name);
 
-	m_hMap = CreateFileMappingA ( INVALID_HANDLE_VALUE,
-									NULL,
-									PAGE_READWRITE,
-									0,
-									size,
-									(LPCSTR)name);
-
-	if (m_hMap == NULL)	{
-		return SPOUT_CREATE_FAILED;
+	if (hMap == NULL) {
+		return NULL;
 	}
 
 	// If the object exists before the function call, the function returns a handle
 	// to the existing object (with its current size, not the specified size),
 	// and GetLastError returns ERROR_ALREADY_EXISTS.
-	err = GetLastError();
 	bool alreadyExists = false;
-	if (err == ERROR_ALREADY_EXISTS) {
-		alreadyExists = true;
-		// The size of the map will be the same as when it was created.
-		// 2.004 apps will have created a 10 sender map which will not be increased in size thereafter.
-	}
-	else {
-		if(err != 0) printf("SpoutSharedMemory::Create - Error = %ld (0x%x)\n", err, err);
+	if (create) {
+		DWORD err = GetLastError();
+		if (err == ERROR_ALREADY_EXISTS) {
+			alreadyExists = true;
+			// The size of the map will be the same as when it was created.
+			// 2.004 apps will have created a 10 sender map which will not be increased in size thereafter.
+		}
+		else {
+			if(err != 0) printf("SpoutSharedMemory::Create - Error = %ld (0x%x)\n", err, err);
+		}
 	}
 
-	m_pBuffer = (char*)MapViewOfFile(m_hMap, FILE_MAP_ALL_ACCESS, 0, 0, 0);
-
-	if (!m_pBuffer)	{
-		Close();
-		return SPOUT_CREATE_FAILED;
+	char* pBuffer = (char*)MapViewOfFile(hMap, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	if (!pBuffer) {
+		CloseHandle(hMap);
+		return NULL;
 	}
 
 	std::string	mutexName;
 	mutexName = name;
 	mutexName += "_mutex";
 
-	m_hMutex = CreateMutexA(NULL, FALSE, mutexName.c_str());
+	HANDLE hMutex = CreateMutexA(NULL, FALSE, mutexName.c_str());
+	if (!hMutex) {
+		UnmapViewOfFile((LPCVOID)pBuffer);
+		CloseHandle(hMap);
+		return NULL;
+	}
+
+	Mapping* mapping = new Mapping();
+	mapping->name = name;
+	mapping->hMap = hMap;
+	mapping->hMutex = hMutex;
+	mapping->pBuffer = pBuffer;
+	mapping->refCount = 1;
+	cache[mapping->name] = mapping;
+
+	result = alreadyExists ? SPOUT_ALREADY_EXISTS : SPOUT_CREATE_SUCCESS;
+	return mapping;
+}
+
+// Release a reference, and close the mapping with the last one.
+void SpoutSharedMemory::ReleaseMapping(Mapping* mapping)
+{
+	std::lock_guard<std::mutex> guard(Mapping::CacheLock());
+
+	if (--mapping->refCount > 0) return;
+
+	Mapping::Cache().erase(mapping->name);
+	UnmapViewOfFile((LPCVOID)mapping->pBuffer);
+	CloseHandle(mapping->hMap);
+	CloseHandle(mapping->hMutex);
+	delete mapping;
+}
+
+// Create a new memory segment, or attach to an existing one
+// A map that is already open in this process is reused, and reported as
+// SPOUT_ALREADY_EXISTS.
+SpoutCreateResult SpoutSharedMemory::Create(const char* name, int size)
+{
+	// Don't call open twice on the same object without a Close()
+	assert(name);
+	assert(size);
+
+	if (m_hMap != NULL)	{
+		assert(strcmp(name, m_pName) == 0);
+		assert(m_pBuffer && m_hMutex);
+		return SPOUT_ALREADY_CREATED;
+	}
 
-	if (!m_hMutex) {
-		Close();
+	SpoutCreateResult result;
+	m_pMapping = AcquireMapping(name, size, true, result);
+	if (!m_pMapping) {
 		return SPOUT_CREATE_FAILED;
 	}
 
+	m_pBuffer = m_pMapping->pBuffer;
+	m_hMap = m_pMapping->hMap;
+	m_hMutex = m_pMapping->hMutex;
+
 	// Set the name and size
-	m_pName = _strdup(name);
+	m_pName = m_pMapping->name.c_str();
 	m_size = size;
 
-	return alreadyExists ? SPOUT_ALREADY_EXISTS : SPOUT_CREATE_SUCCESS;
+	return result;
 
 }
 
@@ -139,28 +219,17 @@ bool SpoutSharedMemory::Open(const char* name)
 		return true;
 	}
 
-	m_hMap = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, (LPCSTR)name);
-	if (m_hMap == NULL)	{
+	SpoutCreateResult result;
+	m_pMapping = AcquireMapping(name, 0, false, result);
+	if (!m_pMapping) {
 		return false;
 	}
 
-	m_pBuffer = (char*)MapViewOfFile(m_hMap, FILE_MAP_ALL_ACCESS, 0, 0, 0);
-	if (!m_pBuffer)	{
-		Close();
-		return false;
-	}
-
-	std::string	mutexName;
-	mutexName = name;
-	mutexName += "_mutex";
-
-	m_hMutex = CreateMutexA(NULL, FALSE, mutexName.c_str());
-	if (!m_hMutex) {
-		Close();
-		return false;
-	}
+	m_pBuffer = m_pMapping->pBuffer;
+	m_hMap = m_pMapping->hMap;
+	m_hMutex = m_pMapping->hMutex;
 
-	m_pName = _strdup(name);
+	m_pName = m_pMapping->name.c_str();
 	m_size = 0;
 
 	return true;
@@ -169,25 +238,15 @@ bool SpoutSharedMemory::Open(const char* name)
 
 void SpoutSharedMemory::Close()
 {
-	if (m_pBuffer) {
-		UnmapViewOfFile((LPCVOID)m_pBuffer);
-		m_pBuffer = NULL;
-	}
-
-	if (m_hMap) {
-		CloseHandle(m_hMap);
-		m_hMap = NULL;
+	if (m_pMapping) {
+		ReleaseMapping(m_pMapping);
+		m_pMapping = NULL;
 	}
 
-	if (m_hMutex) {
-		CloseHandle(m_hMutex);
-		m_hMutex = NULL;
-	}
-
-	if (m_pName) {
-		free((void*)m_pName);
-		m_pName = NULL;
-	}
+	m_pBuffer = NULL;
+	m_hMap = NULL;
+	m_hMutex = NULL;
+	m_pName = NULL;
 
 }
 
@@ -240,6 +299,12 @@ void SpoutSharedMemory::Unlock()
 }
 
 
+char* SpoutSharedMemory::Buffer() const
+{
+	return m_pBuffer;
+}
+
+
 void SpoutSharedMemory::Debug()
 {
 	/*
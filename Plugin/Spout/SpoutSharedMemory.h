@@ -65,10 +65,22 @@ public:
 	char* Lock();
 	void Unlock();
 
+	// Returns the buffer without locking it. Only for data that is
+	// designed to be accessed without the mutex (atomic counters etc.)
+	char* Buffer() const;
+
 	void Debug();
 
 private:
 
+	// Process-wide mapping cache entry (see SpoutSharedMemory.cpp)
+	struct Mapping;
+	static Mapping* AcquireMapping(const char* name, int size, bool create, SpoutCreateResult& result);
+	static void ReleaseMapping(Mapping* mapping);
+
+	Mapping* m_pMapping;
+
+	// Copies of the shared mapping members
 	char*  m_pBuffer;
 	HANDLE m_hMap;
 	HANDLE m_hMutex;
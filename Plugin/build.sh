@@ -1,22 +1,76 @@
 #!/bin/sh
 
+# Usage: build.sh [release|profile] [baseline|avx2]
+#
+# release  - LTO, stripped (the default, used for the package)
+# profile  - Same optimization with frame pointers and debug symbols, which
+#            are split into KlakSpout.debug
+#
+# baseline - Generic x86-64 (the default). The AVX2 kernels are still used
+#            on the CPUs that support them.
+# avx2     - Haswell or later only. Not for the package.
+
 set -e
 
 GXX="x86_64-w64-mingw32-g++-posix"
+OBJCOPY="x86_64-w64-mingw32-objcopy"
+
+CONFIG="${1:-release}"
+ARCH="${2:-baseline}"
+
+case "$ARCH" in
+    baseline) ARCH_FLAGS="-march=x86-64 -mtune=generic" ;;
+    avx2)     ARCH_FLAGS="-march=haswell -mtune=generic" ;;
+    *)        echo "Unknown architecture: $ARCH" >&2; exit 1 ;;
+esac
+
+case "$CONFIG" in
+    release) OPT_FLAGS="-O2 -flto"; STRIP="-s" ;;
+    profile) OPT_FLAGS="-O2 -flto -g -fno-omit-frame-pointer"; STRIP="" ;;
+    *)       echo "Unknown configuration: $CONFIG" >&2; exit 1 ;;
+esac
+
+CXXFLAGS="$OPT_FLAGS $ARCH_FLAGS"
+
+# Vulkan headers (Vulkan-Headers). MinGW doesn't have them, so the ones on
+# the host are used after MinGW's own headers.
+VULKAN_INCLUDE="${VULKAN_INCLUDE:-/usr/include}"
 
 compile()
 {
     SRC_FILE="$1"
-    OBJ_FILE="build/$(basename -s .cpp $SRC_FILE).o"
-    $GXX -c -Wall -O2 -I. -IKlakSpout $SRC_FILE -o $OBJ_FILE
+    OBJ_DIR="${2:-build}"
+    OBJ_FILE="$OBJ_DIR/$(basename -s .cpp $SRC_FILE).o"
+    $GXX -c -Wall $CXXFLAGS -I. -IKlakSpout -idirafter "$VULKAN_INCLUDE" $SRC_FILE -o $OBJ_FILE
+}
+
+# Split the debug symbols into a separate file (profile build).
+split_symbols()
+{
+    [ -z "$STRIP" ] || return 0
+    $OBJCOPY --only-keep-debug "$1" "${1%.*}.debug"
+    $OBJCOPY --strip-debug --add-gnu-debuglink="${1%.*}.debug" "$1"
 }
 
 [ -d "build" ] || mkdir build
+[ -d "build/bench" ] || mkdir build/bench
 
 compile KlakSpout/KlakSpout.cpp
 compile Spout/SpoutDirectX.cpp
 compile Spout/SpoutSenderNames.cpp
 compile Spout/SpoutSharedMemory.cpp
 
-$GXX -shared -o build/KlakSpout.dll build/*.o -s \
+# The code is generated at link time with LTO, so the flags are given again.
+$GXX $CXXFLAGS -shared -o build/KlakSpout.dll build/*.o $STRIP \
      -Wl,--subsystem,windows -static -ldxgi -ld3d9 -ld3d11
+
+split_symbols build/KlakSpout.dll
+
+# Benchmark executable (not included in the package)
+compile KlakSpoutBench/KlakSpoutBench.cpp build/bench
+
+$GXX $CXXFLAGS -o build/KlakSpoutBench.exe build/bench/KlakSpoutBench.o \
+     build/SpoutDirectX.o build/SpoutSenderNames.o build/SpoutSharedMemory.o \
+     $STRIP -static -ldxgi -ld3d9 -ld3d11
+
+split_symbols build/KlakSpoutBench.exe